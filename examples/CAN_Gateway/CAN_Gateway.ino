@@ -8,7 +8,9 @@
  *  CAN1 <=====> Gateway <=====> CAN2
  *
  * SPECIAL CONSIDERATIONS:
- *  None.
+ *  CAN frames are forwarded both ways by a DLK_CanGateway (non-blocking, queued per
+ *  direction), CAN1 -> CAN2 through the Routes1to2 routing rules. The sketch only
+ *  prints the gateway statistics every STATS_INTERVAL.
  *
  * AUTHOR:
  *  D.L. Karmann
@@ -209,6 +211,7 @@
 */
 
 #include <DLK_MCP2515.h>    // MCP2515 CAN Bus library
+#include <DLK_CanGateway.h> // MCP2515 CAN gateway
 
 // define following to use Rx interrupts for CAN1 Rx
 #define USING_RX1_INTS
@@ -255,12 +258,7 @@
 #define MCP2515_INT1_PIN    21              // GPIO
 #define MCP2515_INT2_PIN    16              // GPIO
 
-#ifdef USING_RX1_INTS
-#undef USING_RX1_INTS                       // CAN interrupts not supported for ESP32
-#endif
-#ifdef USING_RX2_INTS
-#undef USING_RX2_INTS                       // CAN interrupts not supported for ESP32
-#endif
+// (no CAN interrupts for ESP32 - the Int pins are polled by the gateway instead)
 #endif
 
 #define SPI_CLOCK           2000000         // 2 Mbps
@@ -269,6 +267,7 @@
 #define TIMER_EXPIRED(start, interval)  ((millis() - start) >= interval)
 #define HEARTBEAT_OFF_INTERVAL  950     // mS
 #define HEARTBEAT_ON_INTERVAL   50      // mS
+#define STATS_INTERVAL          5000    // mS
 
 #define LED_ON      HIGH
 #define LED_OFF     LOW
@@ -277,16 +276,6 @@
 #define DEBUG_LO()      digitalWrite(DEBUG_PIN, LOW);
 #define DEBUG_TOGL()    digitalWrite(DEBUG_PIN, !digitalRead(DEBUG_PIN));
 
-#ifdef USING_RX1_INTS
-volatile bool Rx1IntFlag = false;
-CAN_FRAME * RxCAN1_Frame;
-#endif
-
-#ifdef USING_RX2_INTS
-volatile bool Rx2IntFlag = false;
-CAN_FRAME * RxCAN2_Frame;
-#endif
-
 // CAN Interrupts and Chip Selects
 #define CAN1_INT    MCP2515_INT1_PIN            // Set CAN1 INT to pin 2
 DLK_MCP2515 CAN1(SPI_CLOCK, MCP2515_CS1_PIN);   // Set CAN1 CS to pin 10
@@ -298,9 +287,18 @@ DLK_MCP2515 CAN2(SPI_CLOCK, MCP2515_CS2_PIN, false, SPI1_NUM);
 DLK_MCP2515 CAN2(SPI_CLOCK, MCP2515_CS2_PIN);   // Set CAN2 CS to pin 9
 #endif
 
-uint8_t Len = 0;       // length of received buffer
-uint8_t Buf[8];        // Buffer to hold up to 8 bytes of data
-uint32_t CanID;        // Can message ID
+DLK_CanGateway Gateway(&CAN1, &CAN2);   // CAN1 <=====> CAN2
+
+// CAN1 -> CAN2 routing rules (CAN IDs without a rule are forwarded unchanged)
+const CAN_ROUTE Routes1to2[] =
+{
+    //  first   last    action          new_id  rate_cnt rate_ms  mask    data
+    {   0x7DF,  0,      ROUTE_BLOCK },                      // OBD-II requests stay on CAN1
+    {   0x100,  0x1FF,  ROUTE_REMAP,    0x500 },            // forwarded as 0x500-0x5FF
+    {   0x300,  0,      ROUTE_PATCH,    0,      0,      0,  { 0xFF }, { 0x00 } },  // data byte 0 zeroed
+    {   0x400,  0x4FF,  ROUTE_RATE,     0,      10,     1000 },     // max 10 frames/sec
+};
+DLK_CanRoutes Routing1to2;
 
 void setup()
 {
@@ -363,8 +361,8 @@ void setup()
     CAN1.MCP2515_SetMode(MODE_NORMAL);  // Set operation mode to normal so the MCP2515 sends acks to received data.
 
 #ifdef USING_RX1_INTS
-    // set CAN1 Rx interrupt callback
-    if (CAN1.MCP2515_OnRxInterrupt(CAN1_INT, RxInt1Handler) != MCP2515_OK)
+    // set CAN1 Rx interrupt (received CAN frames go into the CAN1 Rx ring buffer)
+    if (CAN1.MCP2515_OnRxInterrupt(CAN1_INT, nullptr) != MCP2515_OK)
     {
         Serial.println("Failed attaching MCP2515 CAN1_INT ...");
         while (1)
@@ -390,9 +388,19 @@ void setup()
 
     CAN2.MCP2515_SetMode(MODE_NORMAL);  // Set operation mode to normal so the MCP2515 sends acks to received data.
 
+    // compile CAN1 -> CAN2 routing rules (CAN2 -> CAN1 forwards all CAN frames unchanged)
+    if (Routing1to2.Compile(Routes1to2, sizeof(Routes1to2) / sizeof(Routes1to2[0])))
+    {
+        Gateway.SetRoutes(GW_A_TO_B, &Routing1to2);
+    }
+    else
+    {
+        Serial.println("Invalid CAN1 -> CAN2 routing rules ...");
+    }
+
 #ifdef USING_RX2_INTS
-    // set CAN2 Rx interrupt callback
-    if (CAN2.MCP2515_OnRxInterrupt(CAN2_INT, RxInt2Handler) != MCP2515_OK)
+    // set CAN2 Rx interrupt (received CAN frames go into the CAN2 Rx ring buffer)
+    if (CAN2.MCP2515_OnRxInterrupt(CAN2_INT, nullptr) != MCP2515_OK)
     {
         Serial.println("Failed attaching MCP2515 CAN2_INT ...");
         while (1)
@@ -403,159 +411,61 @@ void setup()
 #endif
 }
 
-#ifdef USING_RX1_INTS
-// Interrupt callback handler for Rx interrupt for CAN1
-void RxInt1Handler(CAN_FRAME * frame)
-{
-    RxCAN1_Frame = frame;    // save reference to CAN1 Rx data
-
-    Rx1IntFlag = true;       // set notification of received CAN1 data
-}
-#endif
-
-#ifdef USING_RX2_INTS
-// Interrupt callback handler for Rx interrupt for CAN2
-void RxInt2Handler(CAN_FRAME * frame)
+void loop()
 {
-    RxCAN2_Frame = frame;    // save reference to CAN2 Rx data
+    Gateway.Service();      // forward received CAN frames both ways (non-blocking)
 
-    Rx2IntFlag = true;       // set notification of received CAN2 data
+    PrintStats();
+    DoHeartbeat();
 }
-#endif
 
-void loop()
+/*
+ * NAME:
+ *  void PrintStats(void)
+ *
+ * PARAMETERS:
+ *  None.
+ *
+ * WHAT:
+ *  Print gateway statistics of both directions every STATS_INTERVAL.
+ *
+ * RETURN VALUES:
+ *  None.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  None.
+ */
+void PrintStats(void)
 {
-#if !defined(USING_RX1_INTS) || !defined(USING_RX2_INTS)
-    CAN_FRAME frame;
-#endif
-
-    bool got_rx = false;
-    uint8_t sndStat;
-
-#ifdef USING_RX1_INTS
-    if (Rx1IntFlag)      // got CAN Rx interrupt
-    {
-        Rx1IntFlag = false;
+    static uint32_t last_stats_tick = 0;
+    CAN_GW_STATS stats;
 
-        // Read data, Len: data length, Buf: data buffer
-        CanID = RxCAN1_Frame->can_id;
-        Len = RxCAN1_Frame->can_dlc;
-        memcpy(Buf, RxCAN1_Frame->can_data, Len);
-        got_rx = true;
-    }
-#else
-//if (!digitalRead(MCP2515_INT1_PIN))                 // If CAN0_INT pin is low, read receive buffer
-{
-    // use polling of MCP2515 to determine if CAN data available
-    // (could instead poll the MCP2515 interrupt pin to determine if CAN data available
-    //  for less SPI bus traffic)
-    if (CAN1.MCP2515_Recv(&frame) == MCP2515_OK) // check if data is coming in
-    {
-        // Read data, Len1: data length, Buf1: data buffer
-        CanID = frame.can_id;
-        Len = frame.can_dlc;
-        memcpy(Buf, frame.can_data, Len);
-        got_rx = true;
-    }
-}
-#endif
-    if (got_rx)
+    if (!TIMER_EXPIRED(last_stats_tick, STATS_INTERVAL))
     {
-        Serial.print("Rx CAN ID1: 0x");
-        Serial.print(CanID, HEX);       // print the CAN ID in HEX
-
-        Serial.print("    Data Length: "); // Print the length of the received data
-        Serial.print(Len);
-        Serial.print("    ");
-
-        for (int i = 0; i < Len; i++)    // loop on the incoming data to print each byte
-        {
-//            Serial.print(Buf[i]);     
-            PrintHexByte(Buf[i]);     
-            if (i < Len - 1)
-            {
-                Serial.print(",");      // Separate the numbers for readability
-            }
-        }
-        Serial.println();
-
-        // CAN.MCP2515_Send(msg ID, #of data bytes, data array);
-        sndStat = CAN2.MCP2515_Send(CanID, Len, Buf);
-        if (sndStat == MCP2515_OK)
-        {
-            Serial.println("Message Forwarded Successfully to CAN2!");
-        }
-        else
-        {
-            Serial.println("Error Forwarding Message to CAN2...");
-        }
-delay(100);
-        got_rx = false;
+        return;
     }
+    last_stats_tick = millis();
 
-#ifdef USING_RX2_INTS
-    if (Rx2IntFlag)      // got CAN Rx interrupt
-    {
-        Rx2IntFlag = false;
-
-        // Read data, Len: data length, Buf: data buffer
-        CanID = RxCAN2_Frame->can_id;
-        Len = RxCAN2_Frame->can_dlc;
-        memcpy(Buf, RxCAN2_Frame->can_data, Len);
-        got_rx = true;
-    }
-#else
-//if (!digitalRead(MCP2515_INT2_PIN))                 // If CAN1_INT pin is low, read receive buffer
-{
-    // use polling of MCP2515 to determine if CAN data available
-    // (could instead poll the MCP2515 interrupt pin to determine if CAN data available
-    //  for less SPI bus traffic)
-    if (CAN2.MCP2515_Recv(&frame) == MCP2515_OK) // check if data is coming in
+    for (uint8_t dir = GW_A_TO_B; dir < GW_N_DIRS; ++dir)
     {
-        // Read data, Len: data length, Buf: data buffer
-        CanID = frame.can_id;
-        Len = frame.can_dlc;
-        memcpy(Buf, frame.can_data, Len);
-        got_rx = true;
+        Gateway.GetStats(dir, &stats);
+        Serial.print((dir == GW_A_TO_B) ? F("CAN1->CAN2") : F("CAN2->CAN1"));
+        Serial.print(F("  forwarded: "));
+        Serial.print(stats.forwarded);
+        Serial.print(F("  dropped: "));
+        Serial.print(stats.dropped);
+        Serial.print(F("  failed: "));
+        Serial.print(stats.failed);
+        Serial.print(F("  filtered: "));
+        Serial.print(stats.filtered);
+        Serial.print(F("  latency avg/max uS: "));
+        Serial.print(stats.forwarded ? (stats.latency_us / stats.forwarded) : 0);
+        Serial.print(F("/"));
+        Serial.print(stats.latency_max_us);
+        Serial.print(F("  queue max: "));
+        Serial.println(stats.queue_hwm);
     }
 }
-#endif
-    if (got_rx)
-    {
-        Serial.print("Rx CAN ID2: 0x");
-        Serial.print(CanID, HEX);       // print the CAN ID in HEX
-
-        Serial.print("    Data Length: "); // Print the length of the received data
-        Serial.print(Len);
-        Serial.print("    ");
-
-        for (int i = 0; i < Len; i++)    // loop on the incoming data to print each byte
-        {
-//            Serial.print(Buf[i]);     
-            PrintHexByte(Buf[i]);     
-            if (i < Len - 1)
-            {
-                Serial.print(",");      // Separate the numbers for readability
-            }
-        }
-        Serial.println();
-
-        // CAN.MCP2515_Send(msg ID, #of data bytes, data array);
-        sndStat = CAN1.MCP2515_Send(CanID, Len, Buf);
-        if (sndStat == MCP2515_OK)
-        {
-            Serial.println("Message Forwarded Successfully to CAN1!");
-        }
-        else
-        {
-            Serial.println("Error Forwarding Message to CAN1...");
-        }
-delay(100);
-        got_rx = false;
-    }
-
-    DoHeartbeat();
-}
 
 /*
  * NAME:
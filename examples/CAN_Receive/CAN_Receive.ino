@@ -355,9 +355,7 @@
 #define LED_OFF             HIGH            // ESP8266 built-in LED active-low!
 #define LED_ON              LOW             // ESP8266 built-in LED active-low!
 
-#ifdef USING_RX_INTS
-#undef USING_RX_INTS                        // CAN interrupts not supported for ESP8266
-#endif
+// (no CAN interrupts for ESP8266 - the Int pin is polled by MCP2515_Service() instead)
 #endif
 
 // specify CS and interrupt pins to use
@@ -375,9 +373,7 @@
     #define MCP2515_INT_PIN     21              // GPIO
 #endif
 
-#ifdef USING_RX_INTS
-#undef USING_RX_INTS                            // CAN interrupts not supported for ESP32
-#endif
+// (no CAN interrupts for ESP32 - the Int pin is polled by MCP2515_Service() instead)
 #endif
 
 #define TIMER_EXPIRED(start, interval)  ((millis() - start) >= interval)
@@ -387,11 +383,6 @@
 #define SPI_CLOCK           2000000         // 2 Mbps
 #define CAN_SPEED           CAN_250KBPS
 
-#ifdef USING_RX_INTS
-volatile bool RxIntFlag = false;
-CAN_FRAME * RxCAN_Frame;
-#endif
-
 #if defined(PHILHOWER_RP2040) && defined(USE_HW_SPI_CS)
 DLK_MCP2515 CAN(SPI_CLOCK, MCP2515_CS_PIN, true, WHICH_SPI);
 #else
@@ -478,8 +469,8 @@ void setup()
     }
 
 #ifdef USING_RX_INTS
-    // set Rx interrupt callback
-    if (CAN.MCP2515_OnRxInterrupt(MCP2515_INT_PIN, RxIntHandler) != MCP2515_OK)
+    // set Rx interrupt (received CAN frames go into the Rx ring buffer - no callback needed)
+    if (CAN.MCP2515_OnRxInterrupt(MCP2515_INT_PIN, nullptr) != MCP2515_OK)
     {
         Serial.println("Failed attaching MCP2515 MCP2515_INT_PIN ...");
         while (1)
@@ -490,16 +481,6 @@ void setup()
 #endif
 }
 
-#ifdef USING_RX_INTS
-// Interrupt callback handler for Rx interrupt
-void RxIntHandler(CAN_FRAME * frame)
-{
-    RxCAN_Frame = frame;    // save reference to CAN Rx data
-
-    RxIntFlag = true;       // set notification of received CAN data
-}
-#endif
-
 //===============================================================================
 //  Main
 //===============================================================================
@@ -509,10 +490,9 @@ void loop()
     bool rxflag = false;
 
 #ifdef USING_RX_INTS
-    if (RxIntFlag)      // got CAN Rx interrupt
+    CAN.MCP2515_Service();      // Int pin polled (if no CAN interrupts)
+    if (CAN.MCP2515_Pop(&frame) == MCP2515_OK)  // got CAN Rx interrupt data
     {
-        RxIntFlag = false;
-        frame = *RxCAN_Frame;
         rxflag = true;
     }
 #else
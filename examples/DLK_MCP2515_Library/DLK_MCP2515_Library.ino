@@ -364,9 +364,7 @@
 #define LED_OFF             HIGH            // ESP8266 built-in LED active-low!
 #define LED_ON              LOW             // ESP8266 built-in LED active-low!
 
-#ifdef USING_RX_INTS
-#undef USING_RX_INTS                        // CAN interrupts not supported for ESP8266
-#endif
+// (no CAN interrupts for ESP8266 - the Int pin is polled by MCP2515_Service() instead)
 #endif
 
 // specify CS and interrupt pins to use
@@ -377,9 +375,7 @@
 #define CAN_DATA_PIN        26              // the CAN data indicator pin
 #define DEBUG_PIN           22              // the Debug pin
 
-#ifdef USING_RX_INTS
-#undef USING_RX_INTS                            // CAN interrupts not supported for ESP32
-#endif
+// (no CAN interrupts for ESP32 - the Int pin is polled by MCP2515_Service() instead)
 #endif
 
 #define CAN_DATA_HI()       digitalWrite(CAN_DATA_PIN, HIGH)
@@ -432,16 +428,6 @@ DLK_MCP2515 Mcp2515(SPI_CLOCK, MCP2515_CS_PIN, true);
 DLK_MCP2515 Mcp2515(SPI_CLOCK, MCP2515_CS_PIN);
 #endif
 
-#ifdef USING_RX_INTS
-#define CAN_FRAME_CNT   4
-
-volatile bool RxIntFlag = false;
-void RxIntHandler(CAN_FRAME * frame);
-CAN_FRAME * RxCAN_Frame[CAN_FRAME_CNT];
-uint8_t LastRxNdx = 0;
-uint8_t NextRxNdx = 0;
-#endif
-
 CAN_FRAME LastCAN_Frame;
 
 void ShowCAN_Msg(CAN_FRAME * frame);
@@ -524,8 +510,8 @@ void setup()
     }
 
 #ifdef USING_RX_INTS
-    // set Rx interrupt callback
-    if (Mcp2515.MCP2515_OnRxInterrupt(MCP2515_INT_PIN, RxIntHandler) != MCP2515_OK)
+    // set Rx interrupt (received CAN frames go into the Rx ring buffer - no callback needed)
+    if (Mcp2515.MCP2515_OnRxInterrupt(MCP2515_INT_PIN, nullptr) != MCP2515_OK)
     {
         Serial.println("Failed attaching MCP2515 MCP2515_INT_PIN ...");
         while (1)
@@ -536,26 +522,10 @@ void setup()
 #endif
 }
 
-#ifdef USING_RX_INTS
-// Interrupt callback handler for Rx interrupt
-void RxIntHandler(CAN_FRAME * frame)
-{
-    RxCAN_Frame[NextRxNdx] = frame;     // save reference to CAN Rx data
-    if (++NextRxNdx == CAN_FRAME_CNT)
-    {
-        NextRxNdx = 0;
-    }
-
-    RxIntFlag = true;       // set notification of received CAN data
-}
-#endif
-
 void loop()
 {
     static bool new_prompt = true;
-#ifndef USING_RX_INTS
     CAN_FRAME frame;
-#endif
 
     if (new_prompt)
     {
@@ -570,26 +540,18 @@ void loop()
     new_prompt = CmdLine.DoCmdLine();
 
 #ifdef USING_RX_INTS
-    if (RxIntFlag)      // got CAN Rx interrupt
+    Mcp2515.MCP2515_Service();      // Int pin polled (if no CAN interrupts)
+    while (Mcp2515.MCP2515_Pop(&frame) == MCP2515_OK)  // got CAN Rx interrupt data
     {
-        RxIntFlag = false;
-        while (RxCAN_Frame[LastRxNdx] != NULL)
+        ++CAN_MsgCnt;
+        CAN_DATA_TOGL();
+        if ((CAN_MsgDupes == CDUPE_YES) || 
+            (!CheckForDupes(&frame, &LastCAN_Frame)))
         {
-            ++CAN_MsgCnt;
-            CAN_DATA_TOGL();
-            if ((CAN_MsgDupes == CDUPE_YES) || 
-                (!CheckForDupes(RxCAN_Frame[LastRxNdx], &LastCAN_Frame)))
-            {
-                ShowCAN_Msg(RxCAN_Frame[LastRxNdx]);
-            }
-
-            LastCAN_Frame = *RxCAN_Frame[LastRxNdx];    // remember last CAN message - deep copy
-            RxCAN_Frame[LastRxNdx] = NULL;
-            if (++LastRxNdx == CAN_FRAME_CNT)
-            {
-                LastRxNdx = 0;
-            }
+            ShowCAN_Msg(&frame);
         }
+
+        LastCAN_Frame = frame;      // remember last CAN message
     }
 #else
     if (digitalRead(MCP2515_INT_PIN) == LOW)
@@ -5,7 +5,8 @@
  *  DLK MCP2515 Arduino Library CAN Controller multiple CAN devices test program.
  *
  * SPECIAL CONSIDERATIONS:
- *  None.
+ *  The MCP2515s not using Rx interrupts are serviced by a DLK_SpiBus per SPI port (their
+ *  Int pins polled, all in one SPI transaction per pass).
  *
  * AUTHOR:
  *  D.L. Karmann
@@ -268,6 +269,7 @@
 #include <SPI.h>
 
 #include <DLK_MCP2515.h>
+#include <DLK_SpiBus.h>
 
 #define SPI_CLOCK           2000000             // 2 Mbps
 #define CAN_SPEED           CAN_250KBPS
@@ -984,19 +986,19 @@
 #define HEARTBEAT_ON_INTERVAL   50      // mS
 
 #if defined(USING_RX0A_INTS) || defined(USING_RX0B_INTS) || defined(USING_RX0C_INTS) || defined(USING_RX0D_INTS)
-volatile bool Rx1IntFlag = false;
-CAN_FRAME * RxCAN1_Frame;
-
-volatile bool Rx2IntFlag = false;
-CAN_FRAME * RxCAN2_Frame;
-
-volatile bool Rx3IntFlag = false;
-CAN_FRAME * RxCAN3_Frame;
+DLK_MCP2515 * RxCAN1 = nullptr;     // MCP2515 using 1st CAN interrupt
+DLK_MCP2515 * RxCAN2 = nullptr;     // MCP2515 using 2nd CAN interrupt
+DLK_MCP2515 * RxCAN3 = nullptr;     // MCP2515 using 3rd CAN interrupt
+DLK_MCP2515 * RxCAN4 = nullptr;     // MCP2515 using 4th CAN interrupt
+#endif
 
-volatile bool Rx4IntFlag = false;
-CAN_FRAME * RxCAN4_Frame;
+DLK_SpiBus SpiBus0;                 // services SPI0 MCP2515s not using Rx interrupts
+#if defined(USE_CAN1_A) || defined(USE_CAN1_B) || defined(USE_CAN1_C) || defined(USE_CAN1_D)
+DLK_SpiBus SpiBus1;                 // services SPI1 MCP2515s not using Rx interrupts
 #endif
 
+uint32_t CAN_InitTime = 0;          // total time of all MCP2515_Init() (uS)
+
 void setup()
 {
     // init heartbeat LED
@@ -1372,41 +1374,42 @@ void setup()
     delay(50);
 
     // initialize MCP2515 CAN
+    uint32_t can_startup = micros();
 #ifdef PHILHOWER_RP2040     // Pi Pico
     #ifdef USE_SPI0
         #ifdef USE_CAN0_A
             // Initialize MCP2515
             #ifdef USING_RX0A_INTS
-                CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", true);
+                CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", true, nullptr);
             #else
-                CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", false);
+                CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", false, &SpiBus0);
             #endif
         #endif
 
         #ifdef USE_CAN0_B
             // Initialize MCP2515
             #ifdef USING_RX0B_INTS
-                CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", true);
+                CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", true, nullptr);
             #else
-                CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", false);
+                CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", false, &SpiBus0);
             #endif
         #endif
 
         #ifdef USE_CAN0_C
             // Initialize MCP2515
             #ifdef USING_RX0C_INTS
-                CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", true);
+                CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", true, nullptr);
             #else
-                CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", false);
+                CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", false, &SpiBus0);
             #endif
         #endif
 
         #ifdef USE_CAN0_D
             // Initialize MCP2515
             #ifdef USING_RX0D_INTS
-                CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", true);
+                CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", true, nullptr);
             #else
-                CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", false);
+                CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", false, &SpiBus0);
             #endif
         #endif
     #endif
@@ -1415,36 +1418,36 @@ void setup()
         #ifdef USE_CAN1_A
             // Initialize MCP2515
             #ifdef USING_RX1A_INTS
-                CAN_Setup(&CAN1a, MCP2515_INT1A_PIN_SPI1, "CAN1a", true);
+                CAN_Setup(&CAN1a, MCP2515_INT1A_PIN_SPI1, "CAN1a", true, nullptr);
             #else
-                CAN_Setup(&CAN1a, MCP2515_INT1A_PIN_SPI1, "CAN1a", false);
+                CAN_Setup(&CAN1a, MCP2515_INT1A_PIN_SPI1, "CAN1a", false, &SpiBus1);
             #endif
         #endif
 
         #ifdef USE_CAN1_B
             // Initialize MCP2515
             #ifdef USING_RX1B_INTS
-                CAN_Setup(&CAN1b, MCP2515_INT1B_PIN_SPI1, "CAN1b", true);
+                CAN_Setup(&CAN1b, MCP2515_INT1B_PIN_SPI1, "CAN1b", true, nullptr);
             #else
-                CAN_Setup(&CAN1b, MCP2515_INT1B_PIN_SPI1, "CAN1b", false);
+                CAN_Setup(&CAN1b, MCP2515_INT1B_PIN_SPI1, "CAN1b", false, &SpiBus1);
             #endif
         #endif
 
         #ifdef USE_CAN1_C
             // Initialize MCP2515
             #ifdef USING_RX1C_INTS
-                CAN_Setup(&CAN1c, MCP2515_INT1C_PIN_SPI1, "CAN1c", true);
+                CAN_Setup(&CAN1c, MCP2515_INT1C_PIN_SPI1, "CAN1c", true, nullptr);
             #else
-                CAN_Setup(&CAN1c, MCP2515_INT1C_PIN_SPI1, "CAN1c", false);
+                CAN_Setup(&CAN1c, MCP2515_INT1C_PIN_SPI1, "CAN1c", false, &SpiBus1);
             #endif
         #endif
 
         #ifdef USE_CAN1_D
             // Initialize MCP2515
             #ifdef USING_RX1D_INTS
-                CAN_Setup(&CAN1d, MCP2515_INT1D_PIN_SPI1, "CAN1d", true);
+                CAN_Setup(&CAN1d, MCP2515_INT1D_PIN_SPI1, "CAN1d", true, nullptr);
             #else
-                CAN_Setup(&CAN1d, MCP2515_INT1D_PIN_SPI1, "CAN1d", false);
+                CAN_Setup(&CAN1d, MCP2515_INT1D_PIN_SPI1, "CAN1d", false, &SpiBus1);
             #endif
         #endif
     #endif
@@ -1454,36 +1457,36 @@ void setup()
     #ifdef USE_CAN0_A
         // Initialize MCP2515
         #ifdef USING_RX0A_INTS
-            CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", true);
+            CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", true, nullptr);
         #else
-            CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", false);
+            CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", false, &SpiBus0);
         #endif
     #endif
 
     #ifdef USE_CAN0_B
         // Initialize MCP2515
         #ifdef USING_RX0B_INTS
-            CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", true);
+            CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", true, nullptr);
         #else
-            CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", false);
+            CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", false, &SpiBus0);
         #endif
     #endif
 
     #ifdef USE_CAN0_C
         // Initialize MCP2515
         #ifdef USING_RX0C_INTS
-            CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", true);
+            CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", true, nullptr);
         #else
-            CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", false);
+            CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", false, &SpiBus0);
         #endif
     #endif
 
     #ifdef USE_CAN0_D
         // Initialize MCP2515
         #ifdef USING_RX0D_INTS
-            CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", true);
+            CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", true, nullptr);
         #else
-            CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", false);
+            CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", false, &SpiBus0);
         #endif
     #endif
 #endif
@@ -1492,48 +1495,56 @@ void setup()
     #ifdef USE_SPI0
         #ifdef USE_CAN0_A
             // Initialize MCP2515
-            CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", false);
+            CAN_Setup(&CAN0a, MCP2515_INT0A_PIN_SPI0, "CAN0a", false, &SpiBus0);
         #endif
 
         #ifdef USE_CAN0_B
             // Initialize MCP2515
-            CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", false);
+            CAN_Setup(&CAN0b, MCP2515_INT0B_PIN_SPI0, "CAN0b", false, &SpiBus0);
         #endif
 
         #ifdef USE_CAN0_C
             // Initialize MCP2515
-            CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", false);
+            CAN_Setup(&CAN0c, MCP2515_INT0C_PIN_SPI0, "CAN0c", false, &SpiBus0);
         #endif
 
         #ifdef USE_CAN0_D
             // Initialize MCP2515
-            CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", false);
+            CAN_Setup(&CAN0d, MCP2515_INT0D_PIN_SPI0, "CAN0d", false, &SpiBus0);
         #endif
     #endif
 
     #ifdef USE_SPI1
         #ifdef USE_CAN1_A
             // Initialize MCP2515
-            CAN_Setup(&CAN1a, MCP2515_INT1A_PIN_SPI1, "CAN1a", false);
+            CAN_Setup(&CAN1a, MCP2515_INT1A_PIN_SPI1, "CAN1a", false, &SpiBus1);
         #endif
 
         #ifdef USE_CAN1_B
             // Initialize MCP2515
-            CAN_Setup(&CAN1b, MCP2515_INT1B_PIN_SPI1, "CAN1b", false);
+            CAN_Setup(&CAN1b, MCP2515_INT1B_PIN_SPI1, "CAN1b", false, &SpiBus1);
             #endif
 
         #ifdef USE_CAN1_C
             // Initialize MCP2515
-            CAN_Setup(&CAN1c, MCP2515_INT1C_PIN_SPI1, "CAN1c", false);
+            CAN_Setup(&CAN1c, MCP2515_INT1C_PIN_SPI1, "CAN1c", false, &SpiBus1);
         #endif
 
         #ifdef USE_CAN1_D
             // Initialize MCP2515
-            CAN_Setup(&CAN1d, MCP2515_INT1D_PIN_SPI1, "CAN1d", false);
+            CAN_Setup(&CAN1d, MCP2515_INT1D_PIN_SPI1, "CAN1d", false, &SpiBus1);
         #endif
     #endif
 #endif
 
+    // show MCP2515 startup time (MCP2515_Init() only, and including interrupt setup and printing)
+    can_startup = micros() - can_startup;
+    Serial.print("MCP2515 startup time: ");
+    Serial.print(CAN_InitTime);
+    Serial.print(" uS Init (");
+    Serial.print(can_startup);
+    Serial.println(" uS total)");
+
 DEBUG_TOGL();
 }
 
@@ -1543,44 +1554,39 @@ void loop()
 
     // check for CAN Rx interrupts
 #if defined(USING_RX0A_INTS) || defined(USING_RX0B_INTS) || defined(USING_RX0C_INTS) || defined(USING_RX0D_INTS)
-    if (Rx1IntFlag)      // got CAN Rx interrupt
+    if ((RxCAN1 != nullptr) && (RxCAN1->MCP2515_Pop(&frame) == MCP2515_OK))   // got CAN Rx interrupt data
     {
-        Rx1IntFlag = false;
-        frame = *RxCAN1_Frame;
         RecvCanData(&frame, "Rx1");
     }
 
-    if (Rx2IntFlag)      // got CAN Rx interrupt
+    if ((RxCAN2 != nullptr) && (RxCAN2->MCP2515_Pop(&frame) == MCP2515_OK))   // got CAN Rx interrupt data
     {
-        Rx2IntFlag = false;
-        frame = *RxCAN2_Frame;
         RecvCanData(&frame, "Rx2");
     }
 
-    if (Rx3IntFlag)      // got CAN Rx interrupt
+    if ((RxCAN3 != nullptr) && (RxCAN3->MCP2515_Pop(&frame) == MCP2515_OK))   // got CAN Rx interrupt data
     {
-        Rx3IntFlag = false;
-        frame = *RxCAN3_Frame;
         RecvCanData(&frame, "Rx3");
     }
 
-    if (Rx4IntFlag)      // got CAN Rx interrupt
+    if ((RxCAN4 != nullptr) && (RxCAN4->MCP2515_Pop(&frame) == MCP2515_OK))   // got CAN Rx interrupt data
     {
-        Rx4IntFlag = false;
-        frame = *RxCAN4_Frame;
         RecvCanData(&frame, "Rx4");
     }
 #endif
 
-     // process CAN receiving and sending
+    // service MCP2515s not using Rx interrupts (received CAN frames go into their Rx ring buffers)
+    SpiBus0.Service();
+#if defined(USE_CAN1_A) || defined(USE_CAN1_B) || defined(USE_CAN1_C) || defined(USE_CAN1_D)
+    SpiBus1.Service();
+#endif
+
+    // process CAN receiving and sending
 #ifdef USE_CAN0_A
     #ifndef USING_RX0A_INTS
-        if (digitalRead(MCP2515_INT0A_PIN_SPI0) == LOW)
+        if (CAN0a.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN0a.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN0a");
-            }
+            RecvCanData(&frame, "CAN0a");
         }
     #endif
     SendCanData(&CAN0a, 0, "CAN0a");
@@ -1588,12 +1594,9 @@ void loop()
 
 #ifdef USE_CAN0_B
     #ifndef USING_RX0B_INTS
-        if (digitalRead(MCP2515_INT0B_PIN_SPI0) == LOW)
+        if (CAN0b.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN0b.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN0b");
-            }
+            RecvCanData(&frame, "CAN0b");
         }
     #endif
     SendCanData(&CAN0b, 16, "CAN0b");
@@ -1601,12 +1604,9 @@ void loop()
 
 #ifdef USE_CAN0_C
     #ifndef USING_RX0C_INTS
-        if (digitalRead(MCP2515_INT0C_PIN_SPI0) == LOW)
+        if (CAN0c.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN0c.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN0c");
-            }
+            RecvCanData(&frame, "CAN0c");
         }
     #endif
     SendCanData(&CAN0c, 32, "CAN0c");
@@ -1614,12 +1614,9 @@ void loop()
 
 #ifdef USE_CAN0_D
     #ifndef USING_RX0D_INTS
-        if (digitalRead(MCP2515_INT0D_PIN_SPI0) == LOW)
+        if (CAN0d.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN0d.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN0d");
-            }
+            RecvCanData(&frame, "CAN0d");
         }
     #endif
     SendCanData(&CAN0d, 48, "CAN0d");
@@ -1627,12 +1624,9 @@ void loop()
 
 #ifdef USE_CAN1_A
     #ifndef USING_RX1A_INTS
-        if (digitalRead(MCP2515_INT1A_PIN_SPI1) == LOW)
+        if (CAN1a.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN1a.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN1a");
-            }
+            RecvCanData(&frame, "CAN1a");
         }
     #endif
     SendCanData(&CAN1a, 64, "CAN1a");
@@ -1640,12 +1634,9 @@ void loop()
 
 #ifdef USE_CAN1_B
     #ifndef USING_RX1B_INTS
-        if (digitalRead(MCP2515_INT1B_PIN_SPI1) == LOW)
+        if (CAN1b.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN1b.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN1b");
-            }
+            RecvCanData(&frame, "CAN1b");
         }
     #endif
     SendCanData(&CAN0b, 80, "CAN1b");
@@ -1653,12 +1644,9 @@ void loop()
 
 #ifdef USE_CAN1_C
     #ifndef USING_RX1C_INTS
-        if (digitalRead(MCP2515_INT1C_PIN_SPI1) == LOW)
+        if (CAN1c.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN1c.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN1c");
-            }
+            RecvCanData(&frame, "CAN1c");
         }
     #endif
     SendCanData(&CAN0c, 96, "CAN1c");
@@ -1666,12 +1654,9 @@ void loop()
 
 #ifdef USE_CAN1_D
     #ifndef USING_RX1D_INTS
-        if (digitalRead(MCP2515_INT1D_PIN_SPI1) == LOW)
+        if (CAN1d.MCP2515_Pop(&frame) == MCP2515_OK)
         {
-            if (CAN1d.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                RecvCanData(&frame, "CAN1d");
-            }
+            RecvCanData(&frame, "CAN1d");
         }
     #endif
     SendCanData(&CAN0d, 112, "CAN1d");
@@ -1759,48 +1744,18 @@ if (TIMER_EXPIRED(last_toggle, 100))
     Serial.println();
 }
 
-#if defined(USING_RX0A_INTS) || defined(USING_RX0B_INTS) || defined(USING_RX0C_INTS) || defined(USING_RX0D_INTS)
-// Interrupt callback handler for Rx interrupt for 1st CAN interrupt
-void RxInt1Handler(CAN_FRAME * frame)
-{
-    RxCAN1_Frame = frame;    // save reference to CAN Rx data
-
-    Rx1IntFlag = true;       // set notification of received CAN data
-}
-
-// Interrupt callback handler for Rx interrupt for 2nd CAN interrupt
-void RxInt2Handler(CAN_FRAME * frame)
-{
-    RxCAN2_Frame = frame;    // save reference to CAN Rx data
-
-    Rx2IntFlag = true;       // set notification of received CAN data
-}
-
-// Interrupt callback handler for Rx interrupt for 3rd CAN interrupt
-void RxInt3Handler(CAN_FRAME * frame)
-{
-    RxCAN3_Frame = frame;    // save reference to CAN Rx data
-
-    Rx3IntFlag = true;       // set notification of received CAN data
-}
-
-// Interrupt callback handler for Rx interrupt for 4th CAN interrupt
-void RxInt4Handler(CAN_FRAME * frame)
-{
-    RxCAN4_Frame = frame;    // save reference to CAN Rx data
-
-    Rx4IntFlag = true;       // set notification of received CAN data
-}
-#endif
-
-void CAN_Setup(DLK_MCP2515 * mcp, int int_pin, const char * title, bool use_int)
+void CAN_Setup(DLK_MCP2515 * mcp, int int_pin, const char * title, bool use_int, DLK_SpiBus * bus)
 {
     static uint8_t can_int_cnt = 0;
     uint8_t rslt;
+    uint32_t init_time;
 
 DEBUG_TOGL();
     // Initialize MCP2515 running at 8MHz with a baudrate of 250kb/s
+    init_time = micros();
     rslt = mcp->MCP2515_Init(CAN_SPEED);
+    init_time = micros() - init_time;
+    CAN_InitTime += init_time;
     if (rslt != MCP2515_OK)
     {
         Serial.print(title);
@@ -1818,11 +1773,12 @@ DEBUG_TOGL();
     if (use_int)
     {
 #if defined(USING_RX0A_INTS) || defined(USING_RX0B_INTS) || defined(USING_RX0C_INTS) || defined(USING_RX0D_INTS)
-        // set CAN Rx interrupt callback
+        // set CAN Rx interrupt (received CAN frames go into the MCP2515's Rx ring buffer)
         switch (can_int_cnt)
         {
             case 0:
-                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, RxInt1Handler);
+                RxCAN1 = mcp;
+                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, nullptr);
                 if (rslt != MCP2515_OK)
                 {
                     Serial.print(": Failed attaching MCP2515 ");
@@ -1835,7 +1791,8 @@ DEBUG_TOGL();
                 }
                 break;
             case 1:
-                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, RxInt2Handler);
+                RxCAN2 = mcp;
+                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, nullptr);
                 if (rslt != MCP2515_OK)
                 {
                     Serial.print(": Failed attaching MCP2515 ");
@@ -1849,7 +1806,8 @@ DEBUG_TOGL();
                 break;
 #if (MAX_INTS > 2)
             case 2:
-                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, RxInt3Handler);
+                RxCAN3 = mcp;
+                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, nullptr);
                 if (rslt != MCP2515_OK)
                 {
                     Serial.print(": Failed attaching MCP2515 ");
@@ -1862,7 +1820,8 @@ DEBUG_TOGL();
                 }
                 break;
             case 3:
-                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, RxInt4Handler);
+                RxCAN4 = mcp;
+                rslt = mcp->MCP2515_OnRxInterrupt(int_pin, nullptr);
                 if (rslt != MCP2515_OK)
                 {
                     Serial.print(": Failed attaching MCP2515 ");
@@ -1888,11 +1847,23 @@ DEBUG_TOGL();
     }
     else
     {
-        // init MCP2515 Int input pin
+        // init MCP2515 Int input pin, polled by SPI bus scheduler
         pinMode(int_pin, INPUT_PULLUP);
+        if (bus->Attach(mcp, nullptr, int_pin) != MCP2515_OK)
+        {
+            Serial.print(": Failed attaching MCP2515 ");
+            Serial.print(title);
+            Serial.println(" to SPI bus ...");
+            while (1)
+            {
+                yield();    // needed by ESP8266 to prevent Soft WDT reset "rst cause:2, boot mode:(3,6)"
+            }
+        }
     }
 
-    Serial.println(": MCP2515 Initialized Successfully!");
+    Serial.print(": MCP2515 Initialized Successfully! (");
+    Serial.print(init_time);
+    Serial.println(" uS)");
 }
 
 // do Heartbeat
@@ -1,14 +1,20 @@
-/* CAN OBD & UDS Simulator
+/* CAN OBD Simulator
  *
  *  Currently replies to some general OBD requests
- *  Place holders exist for what I've been able to locate on the Internet
- *  Does not currently support UDS correctly, just placeholders with mode descriptions
+ *  The replies are in a table (ObdTable) of mode/PID entries, each with a static
+ *  payload or a handler - add a reply by adding its entry (sorted by mode then PID)
  *
  *  Written By: Cory J. Fowler  December 20th, 2016
  *
  *  Note:
- *   The MCP2515 interrupt pin is polled for received CAN messages, but the
- *   DLK_MCP2515 CAN Bus library is not using Rx interrupts.
+ *   The MCP2515 interrupt pin is polled by the DLK_MCP2515 CAN Bus library
+ *   (MCP2515_OnRxPoll()) for received CAN messages, and ISO-TP replies are
+ *   sent by the non-blocking DLK_IsoTp engine, so CAN messages keep being
+ *   received while a multi-frame reply is sent.
+ *
+ *   Requests are looked up by the DLK_ObdResponder in constant time, and the
+ *   supported PIDs replies (PID $00, $20, $40, ...) are generated from the table.
+ *   Comment out PRINT_REQUESTS for high request rates (scan tool load tests).
  */
 /*                Nano
    MCP2515 Pin  Arduino Pin
@@ -48,6 +54,8 @@
  */
 
 #include <DLK_MCP2515.h>    // MCP2515 CAN Bus library
+#include <DLK_IsoTp.h>      // non-blocking ISO-TP (ISO 15765-2) engine
+#include <DLK_ObdResponder.h>   // table-driven OBD-II responder
 
 #define MCP2515_CS_PIN      10
 #define MCP2515_INT_PIN     2
@@ -67,9 +75,7 @@
 #define LED_ON      HIGH
 #define LED_OFF     LOW
 
-//#define EXTRAS
-
-#define PAD 0x00
+#define PRINT_REQUESTS      // print each request (slows replies at high request rates)
 
 // What CAN ID type?  Standard (1) or Extended
 #define STANDARD    1
@@ -86,22 +92,11 @@
 #define LISTEN_ID       0x18DA01F1
 #define FUNCTIONAL_ID   0x18DB33F1
 #endif
-#define RESPONSE_BIT    0x40
-
-// ISO-TP items
-#define TP_SF       0x00    // ISO-TP Single Frame
-#define TP_FF       0x10    // ISO-TP First Frame
-#define TP_CF       0x20    // ISO-TP Consecutive Frame
-#define TP_FC       0x30    // ISO-TP Flow Control Frame
-#define CONT        0       // Continue
-#define WAIT        1       // Wait
-#define ABORT       2       // Overflow/Abort
-#define PADDING     0xcc
 
 // CAN RX Variables
 unsigned long rxId;
 uint8_t dlc;
-uint8_t TxMsgBuf[80];
+uint8_t TxMsgBuf[OBD_REPLY_MAX];
 
 bool ClearedDTCs = false;
 uint16_t Listen_ID;
@@ -111,6 +106,101 @@ uint16_t Reply_ID;
 #define CAN0_INT    MCP2515_INT_PIN             // Set CAN0 INT to pin 2
 DLK_MCP2515 CAN0(SPI_CLOCK, MCP2515_CS_PIN);    // Set CAN0 CS to pin 10
 
+// ISO-TP engine and session (Reply_ID <-> Listen_ID)
+DLK_IsoTp IsoTp(&CAN0);
+uint8_t TpSession = ISOTP_NO_SESSION;
+
+//=============================================================================
+// OBD-II replies
+//=============================================================================
+//                                          U00BA       P0011       B0013       B1045       B2031
+static constexpr uint8_t DTCs[] PROGMEM = { 0xC0, 0xBA, 0x00, 0x11, 0x80, 0x13, 0x90, 0x45, 0xA0, 0x31 };
+
+// MODE $01 - Show current data
+static constexpr uint8_t MonitorStatus[] PROGMEM = { 0x85, 0x07, 0xFF, 0x00 };  // MIL on, 5 DTCs
+static constexpr uint8_t FuelStatus[] PROGMEM    = { 0xFA };
+static constexpr uint8_t EngineLoad[] PROGMEM    = { 0x6A };                    // 100/255 * 0x6a = 41.5686%
+static constexpr uint8_t CoolantTemp[] PROGMEM   = { 0xFA };
+static constexpr uint8_t IntakeMap[] PROGMEM     = { 0x64 };
+static constexpr uint8_t EngineRpm[] PROGMEM     = { 0x9C, 0x40 };
+static constexpr uint8_t VehicleSpeed[] PROGMEM  = { 0xFA };
+static constexpr uint8_t IntakeTemp[] PROGMEM    = { 0xFA };
+static constexpr uint8_t Throttle[] PROGMEM      = { 0xFA };
+static constexpr uint8_t MilDistance[] PROGMEM   = { 0x00, 0x23 };
+static constexpr uint8_t MilTime[] PROGMEM       = { 0x00, 0x3C };
+static constexpr uint8_t OilTemp[] PROGMEM       = { 0x1E };
+static constexpr uint8_t InjTiming[] PROGMEM     = { 0x61, 0x80 };
+static constexpr uint8_t FuelRate[] PROGMEM      = { 0x07, 0xD0 };
+
+// MODE $0A - Show permanent DTCs
+static constexpr uint8_t PermDTCs[] PROGMEM = { 0x05, 0xC0, 0xBA, 0x00, 0x11, 0x80, 0x13, 0x90, 0x45, 0xA0, 0x31 };
+
+// MODE $09 - Request vehicle information (message count, then string without NUL)
+static constexpr uint8_t VIN[] PROGMEM     = "\x01" "1ZVBP8AM7D5220181";
+static constexpr uint8_t CID[] PROGMEM     = "\x01" "Arduino OBDIIsimQRST";
+static constexpr uint8_t CVN[] PROGMEM     = "\x01" "\x11" "BBB\"CCC";
+static constexpr uint8_t ECMname[] PROGMEM = "\x01" "ACM" "\x00" "-ArduinoOBDIIsim";
+static constexpr uint8_t ESN[] PROGMEM     = "\x01" "Arduino-OBDIIsim";
+
+// MODE $03/$07 - Show stored/pending DTCs (count, DTCs)
+uint8_t storedDtcs(uint8_t mode, uint8_t pid, uint8_t * payload)
+{
+    (void)mode;
+    (void)pid;
+    if (ClearedDTCs)
+    {
+        payload[0] = 0x00;
+        payload[1] = 0x00;
+        return 2;
+    }
+    payload[0] = sizeof(DTCs) / 2;
+    memcpy_P(&payload[1], DTCs, sizeof(DTCs));
+    return 1 + sizeof(DTCs);
+}
+
+// MODE $04 - Clear DTCs and stored values
+uint8_t clearDtcs(uint8_t mode, uint8_t pid, uint8_t * payload)
+{
+    (void)mode;
+    (void)pid;
+    (void)payload;
+    ClearedDTCs = true;     // Need to clear DTCs.  We just acknowledge the command for now.
+    return 0;
+}
+
+// reply table - sorted by mode then PID
+static constexpr OBD_PID ObdTable[] PROGMEM =
+{
+    //  mode  pid   len                      data            handler
+    { 0x01, 0x01, sizeof(MonitorStatus),    MonitorStatus,  nullptr     },  // Monitor status since DTCs cleared
+    { 0x01, 0x03, sizeof(FuelStatus),       FuelStatus,     nullptr     },  // Fuel system status
+    { 0x01, 0x04, sizeof(EngineLoad),       EngineLoad,     nullptr     },  // Calculated engine load
+    { 0x01, 0x05, sizeof(CoolantTemp),      CoolantTemp,    nullptr     },  // Engine coolant temperature
+    { 0x01, 0x0B, sizeof(IntakeMap),        IntakeMap,      nullptr     },  // Intake manifold absolute pressure
+    { 0x01, 0x0C, sizeof(EngineRpm),        EngineRpm,      nullptr     },  // Engine RPM
+    { 0x01, 0x0D, sizeof(VehicleSpeed),     VehicleSpeed,   nullptr     },  // Vehicle speed
+    { 0x01, 0x0F, sizeof(IntakeTemp),       IntakeTemp,     nullptr     },  // Intake air temperature
+    { 0x01, 0x11, sizeof(Throttle),         Throttle,       nullptr     },  // Throttle position
+    { 0x01, 0x21, sizeof(MilDistance),      MilDistance,    nullptr     },  // Distance traveled with MIL on
+    { 0x01, 0x4D, sizeof(MilTime),          MilTime,        nullptr     },  // Time run with MIL on
+    { 0x01, 0x5C, sizeof(OilTemp),          OilTemp,        nullptr     },  // Engine oil Temperature
+    { 0x01, 0x5D, sizeof(InjTiming),        InjTiming,      nullptr     },  // Fuel injection timing
+    { 0x01, 0x5E, sizeof(FuelRate),         FuelRate,       nullptr     },  // Engine fuel rate
+    { 0x03, 0x00, 0,                        nullptr,        storedDtcs  },  // Show stored DTCs
+    { 0x04, 0x00, 0,                        nullptr,        clearDtcs   },  // Clear DTCs and stored values
+    { 0x06, 0x00, 0,                        nullptr,        nullptr     },  // Test Results (no tests - supported PIDs only)
+    { 0x07, 0x00, 0,                        nullptr,        storedDtcs  },  // Show pending DTCs
+    { 0x09, 0x02, sizeof(VIN) - 1,          VIN,            nullptr     },  // VIN (17 to 20 Bytes) Uses ISO-TP
+    { 0x09, 0x04, sizeof(CID) - 1,          CID,            nullptr     },  // Calibration ID
+    { 0x09, 0x06, sizeof(CVN) - 1,          CVN,            nullptr     },  // CVN
+    { 0x09, 0x0A, sizeof(ECMname) - 1,      ECMname,        nullptr     },  // ECM Name
+    { 0x09, 0x0D, sizeof(ESN) - 1,          ESN,            nullptr     },  // ESN
+    { 0x0A, 0x00, sizeof(PermDTCs),         PermDTCs,       nullptr     },  // Show permanent DTCs
+};
+static_assert(ObdTableSorted(ObdTable), "ObdTable must be sorted by mode then PID");
+
+DLK_ObdResponder Obd;
+
 void setup()
 {
     // init heartbeat LED
@@ -175,6 +265,19 @@ void setup()
 
     CAN0.MCP2515_SetMode(MODE_NORMAL);                  // Set operation mode to normal so the MCP2515 sends acks to received data.
 
+    // poll CAN0_INT pin for received CAN messages (Rx ring buffer - no callback)
+    CAN0.MCP2515_OnRxPoll(CAN0_INT, nullptr);
+
+    if (!Obd.Begin(ObdTable, sizeof(ObdTable) / sizeof(ObdTable[0])))
+    {
+        Serial.println("Invalid OBD-II reply table!");
+    }
+
+    // physical requests and replies with ISO-TP
+    TpSession = IsoTp.Open(Reply_ID, Listen_ID);
+    IsoTp.OnReceive(isoTpReq);
+    IsoTp.OnSendDone(isoTpDone);
+
     Serial.println("OBD-II CAN Simulator");
 }
 
@@ -182,22 +285,26 @@ void loop()
 {
     CAN_FRAME frame;
 
-    if (!digitalRead(CAN0_INT))                         // If CAN0_INT pin is low, read receive buffer
+    CAN0.MCP2515_Service();                             // read CAN messages if CAN0_INT pin is low
+    IsoTp.Service();                                    // ISO-TP Consecutive Frames and timeouts
+
+    while (CAN0.MCP2515_Pop(&frame) == MCP2515_OK)      // Get CAN data
     {
-        //CAN0.readMsgBuf(&rxId, &dlc, rxBuf);        
-        if (CAN0.MCP2515_Recv(&frame) == MCP2515_OK)    // Get CAN data
+        if (IsoTp.Input(&frame))
+        {
+            continue;                                   // ISO-TP frame of Listen_ID
+        }
+
+        // First request from most adapters...
+        if (frame.can_id == FUNCTIONAL_ID)
         {
-            // First request from most adapters...
-            if (frame.can_id == FUNCTIONAL_ID)
+            if (frame.can_dlc >= 3)
+            {
+                obdReq(frame.can_data);
+            }
+            else
             {
-                if (frame.can_dlc >= 3)
-                {
-                    obdReq(frame.can_data);
-                }
-                else
-                {
-                    Serial.println("Invalid OBD-II Message!");
-                }
+                Serial.println("Invalid OBD-II Message!");
             }
         }
     }
@@ -209,1061 +316,31 @@ void loop()
 //      | len | mode | pid |   |   |   |   |   |
 void obdReq(uint8_t * data)
 {
-    uint8_t len = 0;
-    uint8_t mode = data[1] & 0x0F;      // Service ID / mode
-    uint8_t pid = data[2];              // Parameter ID
-    bool tx = false;
+    uint8_t mode = data[1];             // Service ID / mode
+    uint8_t pid = data[2];              // Parameter ID (not used by modes without PIDs)
+    uint8_t len;
 
-    memset(TxMsgBuf, 0xcc, 8);
+#ifdef PRINT_REQUESTS
+    char msgstring[64];
 
-char msgstring[64];
+    sprintf(msgstring, "Mode: $%02X, PID:$%02X", mode, pid);
+    Serial.println(msgstring);
+#endif
 
-sprintf(msgstring, "Mode: $%02X, PID:$%02X", mode, pid);
-Serial.println(msgstring);
+    len = Obd.Respond(mode, pid, TxMsgBuf);
+#ifdef PRINT_REQUESTS
+    if (TxMsgBuf[0] == OBD_NEG_RESPONSE)
+    {
+        unsupportedPrint(mode, pid);
+    }
+#endif
 
-    //=============================================================================
-    // MODE $01 - Show current data
-    //=============================================================================
-    if (mode == 0x01)
+    // Non-blocking ISO transport (ISO-TP i.e. ISO 15765-2) of reply
+    if (IsoTp.Send(TpSession, TxMsgBuf, len) != ISOTP_OK)
     {
-        if (pid == 0x00)        // Supported PIDs 01-20
-        {
-            TxMsgBuf[0] = 0x80;
-            TxMsgBuf[1] = 0x38;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x01;
-            len = 4;
-            tx = true;
-            // 06 41 00 80 38 00 01 00
-        }
-        else if (pid == 0x01)   // Monitor status since DTs cleared
-        {
-            bool MIL = true;
-            uint8_t DTC = 5;
-
-            TxMsgBuf[0] = (MIL << 7) | (DTC & 0x7F);
-            TxMsgBuf[1] = 0x07;
-            TxMsgBuf[2] = 0xFF;
-            TxMsgBuf[3] = 0x00;
-            len = 4;
-            tx = true;
-            // 06 41 01 85 07 FF 00 00
-        }
-#ifdef EXTRAS
-        else if (pid == 0x02)    // Freeze DTC
-        {
-        }
-#endif
-        else if (pid == 0x03)    // Fuel system status
-        {
-            TxMsgBuf[0] = 0xFA;
-            len = 1;
-            tx = true;
-            // 03 41 03 FA 00 00 00 00 
-        }
-        else if (pid == 0x04)    // Calculated engine load
-        {
-            TxMsgBuf[0] = 0x6A;     // % = 100/255 * 0x6a = 41.5686%
-            len = 1;
-            tx = true;
-        }
-        else if (pid == 0x05)    // Engine coolant temperature
-        {
-            TxMsgBuf[0] = 0xFA;
-            len = 1;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x06)    // Short term fuel trim - Bank 1
-        {
-        }
-        else if (pid == 0x07)    // Long term fuel trim - Bank 1
-        {
-        }
-        else if (pid == 0x08)    // Short term fuel trim - Bank 2
-        {
-        }
-        else if (pid == 0x09)    // Long term fuel trim - Bank 2
-        {
-        }
-        else if (pid == 0x0A)    // Fuel pressure (gauge)
-        {
-        }
-#endif
-        else if (pid == 0x0B)    // Intake manifold absolute pressure
-        {
-            TxMsgBuf[0] = 0x64;
-            len = 1;
-            tx = true;
-        }
-        else if (pid == 0x0C)    // Engine RPM
-        {
-            TxMsgBuf[0] = 0x9C;
-            TxMsgBuf[1] = 0x40;
-            len = 2;
-            tx = true;
-        }
-        else if (pid == 0x0D)    // Vehicle speed
-        {
-            TxMsgBuf[0] = 0xFA;
-            len = 1;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x0E)    // Timing advance
-        {
-        }
-#endif
-        else if (pid == 0x0F)    // Intake air temperature
-        {
-            TxMsgBuf[0] = 0xFA;
-            len = 1;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x10)    // MAF air flow rate
-        {
-        }
-#endif
-        else if (pid == 0x11)    // Throttle position
-        {
-            TxMsgBuf[0] = 0xFA;
-            len = 1;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x12)    // Commanded secondary air status
-        {
-        }
-        else if (pid == 0x13)    // Oxygen sensors present (in 2 banks)
-        {
-        }
-        else if (pid == 0x14)    // Oxygen Sensor 1 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x15)    // Oxygen Sensor 2 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x16)    // Oxygen Sensor 3 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x17)    // Oxygen Sensor 4 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x18)    // Oxygen Sensor 5 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x19)    // Oxygen Sensor 6 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x1A)    // Oxygen Sensor 7 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x1B)    // Oxygen Sensor 8 (Voltage & Trim)
-        {
-        }
-        else if (pid == 0x1C)    // OBD standards this vehicle conforms to
-        {
-        }
-        else if (pid == 0x1D)    // Oxygen sensors present (in 4 banks)
-        {
-        }
-        else if (pid == 0x1E)    // Auxiliary input status
-        {
-        }
-        else if (pid == 0x1F)    // Run time since engine start
-        {
-        }
-#endif
-        else if (pid == 0x20)    // Supported PIDs 21-40
-        {
-            TxMsgBuf[0] = 0x80;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x01;
-            len = 4;
-            tx = true;
-        }
-        else if (pid == 0x21)    // Distance traveled with MIL on
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x23;
-            len = 2;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x22)    // Fuel rail pressure (Relative to Manifold Vacuum)
-        {
-        }
-        else if (pid == 0x23)    // Fuel rail gauge pressure (diesel or gasoline direct injection)
-        {
-        }
-        else if (pid == 0x24)    // Oxygen Sensor 1 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x25)    // Oxygen Sensor 2 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x26)    // Oxygen Sensor 3 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x27)    // Oxygen Sensor 4 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x28)    // Oxygen Sensor 5 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x29)    // Oxygen Sensor 6 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x2A)    // Oxygen Sensor 7 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x2B)    // Oxygen Sensor 8 (Fuel to Air & Voltage)
-        {
-        }
-        else if (pid == 0x2C)    // Commanded EGR
-        {
-        }
-        else if (pid == 0x2D)    // EGR Error
-        {
-        }
-        else if (pid == 0x2E)    // Commanded evaporative purge
-        {
-        }
-        else if (pid == 0x2F)    // Fuel tank level input
-        {
-        }
-        else if (pid == 0x30)    // Warm-ups since codes cleared
-        {
-        }
-        else if (pid == 0x31)    // Distance traveled since codes cleared
-        {
-        }
-        else if (pid == 0x32)    // Evap. System Vapor Pressure
-        {
-        }
-        else if (pid == 0x33)    // Absolute Barometric Pressure
-        {
-        }
-        else if (pid == 0x34)    // Oxygen Sensor 1 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x35)    // Oxygen Sensor 2 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x36)    // Oxygen Sensor 3 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x37)    // Oxygen Sensor 4 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x38)    // Oxygen Sensor 5 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x39)    // Oxygen Sensor 6 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x3A)    // Oxygen Sensor 7 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x3B)    // Oxygen Sensor 8 (Fuel to Air & Current)
-        {
-        }
-        else if (pid == 0x3C)    // Catalyst Temperature: Bank 1, Sensor 1
-        {
-        }
-        else if (pid == 0x3D)    // Catalyst Temperature: Bank 2, Sensor 1
-        {
-        }
-        else if (pid == 0x3E)    // Catalyst Temperature: Bank 1, Sensor 2
-        {
-        }
-        else if (pid == 0x3F)    // Catalyst Temperature: Bank 2, Sensor 2
-        {
-        }
-#endif
-        else if (pid == 0x40)    // Supported PIDs 41-60
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x08;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x0D;
-            len = 4;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x41)    // Monitor status this drive cycle
-        {
-        }
-        else if (pid == 0x42)    // Control module voltage
-        {
-        }
-        else if (pid == 0x43)    // Absolute load value
-        {
-        }
-        else if (pid == 0x44)    // Fuel-Air commanded equivalence ratio
-        {
-        }
-        else if (pid == 0x45)    // Relative throttle position
-        {
-        }
-        else if (pid == 0x46)    // Ambient air temperature
-        {
-        }
-        else if (pid == 0x47)    // Absolute throttle position B
-        {
-        }
-        else if (pid == 0x48)    // Absolute throttle position C
-        {
-        }
-        else if (pid == 0x49)    // Accelerator pedal position D
-        {
-        }
-        else if (pid == 0x4A)    // Accelerator pedal position E
-        {
-        }
-        else if (pid == 0x4B)    // Accelerator pedal position F
-        {
-        }
-        else if (pid == 0x4C)    // Commanded throttle actuator
-        {
-        }
-#endif
-        else if (pid == 0x4D)    // Time run with MIL on
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x3C;
-            len = 2;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x4E)    // Time since troble codes cleared
-        {
-        }
-        else if (pid == 0x4F)    // Time since trouble codes cleared
-        {
-        }
-        else if (pid == 0x50)    // Maximum value for Fuel-Air equivalence ratio, oxygen sensor voltage, oxygen sensro current, and intake manifold absolute-pressure
-        {
-        }
-        else if (pid == 0x51)    // Fuel Type
-        {
-        }
-        else if (pid == 0x52)    // Ethanol Fuel %
-        {
-        }
-        else if (pid == 0x53)    // Absolute evap system vapor pressure
-        {
-        }
-        else if (pid == 0x54)    // Evap system vapor pressure
-        {
-        }
-        else if (pid == 0x55)    // Short term secondary oxygen sensor trim, A: bank 1, B: bank 3
-        {
-        }
-        else if (pid == 0x56)    // Long term secondary oxygen sensor trim, A: bank 1, B: bank 3
-        {
-        }
-        else if (pid == 0x57)    // Short term secondary oxygen sensor trim, A: bank 2, B: bank 4
-        {
-        }
-        else if (pid == 0x58)    // Long term secondary oxygen sensor trim, A: bank 2, B: bank 4
-        {
-        }
-        else if (pid == 0x59)    // Fuel rail absolute pressure
-        {
-        }
-        else if (pid == 0x5A)    // Relative accelerator pedal position
-        {
-        }
-        else if (pid == 0x5B)    // Hybrid battery pack remaining life
-        {
-        }
-#endif
-        else if (pid == 0x5C)    // Engine oil Temperature
-        {
-            TxMsgBuf[0] = 0x1E;
-            len = 1;
-            tx = true;
-        }
-        else if (pid == 0x5D)    // Fuel injection timing
-        {
-            TxMsgBuf[0] = 0x61;
-            TxMsgBuf[1] = 0x80;
-            len = 2;
-            tx = true;
-        }
-        else if (pid == 0x5E)    // Engine fuel rate
-        {
-            TxMsgBuf[0] = 0x07;
-            TxMsgBuf[1] = 0xD0;
-            len = 2;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x5F)    // Emissions requirements to which vehicle is designed
-        {
-        }
-#endif
-        else if (pid == 0x60)    // Supported PIDs 61-80
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x01;
-            len = 4;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x61)    // Driver's demand engine - percent torque
-        {
-        }
-        else if (pid == 0x62)    // Actual engine - percent torque
-        {
-        }
-        else if (pid == 0x63)    // Engine reference torque
-        {
-        }
-        else if (pid == 0x64)    // Engine percent torque data
-        {
-        }
-        else if (pid == 0x65)    // Auxiliary input / output supported
-        {
-        }
-        else if (pid == 0x66)    // Mas air flow sensor
-        {
-        }
-        else if (pid == 0x67)    // Engine coolant temperature
-        {
-        }
-        else if (pid == 0x68)    // Intake air temperature sensor
-        {
-        }
-        else if (pid == 0x69)    // Commanded EGR and EGR error
-        {
-        }
-        else if (pid == 0x6A)    // Commanded Diesel intake air flow control and relative intake air flow position
-        {
-        }
-        else if (pid == 0x6B)    // Exhaust gas recirculation temperature
-        {
-        }
-        else if (pid == 0x6C)    // Commanded throttle actuator control and relative throttle position
-        {
-        }
-        else if (pid == 0x6D)    // Fuel pressure control system
-        {
-        }
-        else if (pid == 0x6E)    // Injection pressure control system
-        {
-        }
-        else if (pid == 0x6F)    // Turbocharger compressor inlet pressure
-        {
-        }
-        else if (pid == 0x70)    // Boost pressure control
-        {
-        }
-        else if (pid == 0x71)    // Variable Geometry turbo sensor
-        {
-        }
-        else if (pid == 0x72)    // Wastegate control
-        {
-        }
-        else if (pid == 0x73)    // Exhaust pressure
-        {
-        }
-        else if (pid == 0x74)    // Turbocharger RPM
-        {
-        }
-        else if (pid == 0x75)    // Turbocharger temperature
-        {
-        }
-        else if (pid == 0x76)    // Turbocharger temperature
-        {
-        }
-        else if (pid == 0x77)    // Charge air cooler temperature (CACT)
-        {
-        }
-        else if (pid == 0x78)    // Exhaust Gas Temperature (EGT) bank 1
-        {
-        }
-        else if (pid == 0x79)    // Exhaust Gas Temperature (EGT) bank 2
-        {
-        }
-        else if (pid == 0x7A)    // Diesel particulate filter (DPF)
-        {
-        }
-        else if (pid == 0x7B)    // Diesel particulate filter (DPF)
-        {
-        }
-        else if (pid == 0x7C)    // Diesel particulate filter (DPF) temperature
-        {
-        }
-        else if (pid == 0x7D)    // NOx NTE control area status
-        {
-        }
-        else if (pid == 0x7E)    // PM NTE control area status
-        {
-        }
-        else if (pid == 0x7F)    // Engine run time
-        {
-        }
-#endif
-        else if (pid == 0x80)    // Supported PIDs 81-A0
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x01;
-            len = 4;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x81)    // Engine run time for Auxiliary Emissions Control Device (AECD)
-        {
-        }
-        else if (pid == 0x82)    // Engine run time for Auxiliary Emissions Control Device (AECD)
-        {
-        }
-        else if (pid == 0x83)    // NOx sensor
-        {
-        }
-        else if (pid == 0x84)    // Manifold surface temperature
-        {
-        }
-        else if (pid == 0x85)    // NOx reqgent system
-        {
-        }
-        else if (pid == 0x86)    // Particulate Matter (PM) sensor
-        {
-        }
-        else if (pid == 0x87)    // Intake manifold absolute pressure
-        {
-        }
-#endif
-        else if (pid == 0xA0)    // Supported PIDs A1-C0
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x01;
-            len = 4;
-            tx = true;
-        }
-        else if (pid == 0xC0)    // Supported PIDs C1-E0
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x01;
-            len = 4;
-            tx = true;
-        }
-        else if (pid == 0xE0)    // Supported PIDs E1-FF?
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x00;
-            len = 4;
-            tx = true;
-        }
-        else
-        {
-            unsupported(mode, pid);
-        }
-    }
-
-    //=============================================================================
-    // MODE $02 - Show freeze frame data
-    //=============================================================================
-    else if (mode == 0x02)
-    {
-        unsupported(mode, pid);
-    }
-
-    //=============================================================================
-    // MODE $03 - Show stored DTCs
-    //=============================================================================
-    else if (mode == 0x03)
-    {
-        //                         U00BA        P0011      B0013       B1045       B2031
-        const uint8_t DTCs[] = { 0xC0, 0xBA, 0x00, 0x11, 0x80, 0x13, 0x90, 0x45, 0xA0, 0x31 };
-        if (!ClearedDTCs)
-        {
-            pid = 0x05;         // DTC count
-            iso_tp(mode, pid, sizeof(DTCs), DTCs);
-        }
-        else
-        {
-            const uint8_t none = 0x00;
-            pid = 0x00;         // dummy
-            iso_tp(mode, pid, 1, &none);
-        }
-    }
-
-    //=============================================================================
-    // MODE $04 - Clear DTCs and stored values
-    //=============================================================================
-    else if (mode == 0x04)
-    {
-        // Need to clear DTCs.  We just acknowledge the command for now.
-        len = 0;
-        ClearedDTCs = true;
-        tx = true;
-    }
-
-    //=============================================================================
-    // MODE $05 - Test Results, oxygen sensor monitoring (non CAN only)
-    //=============================================================================
-    else if (mode == 0x05)
-    {
-        unsupported(mode, pid);
-    }
-
-    //=============================================================================
-    // MODE $06 - Test Results, On-Board Monitoring (Oxygen sensor monitoring for CAN only)
-    //=============================================================================
-    else if (mode == 0x06)
-    {
-        if (pid == 0x00)        // Supported PIDs 01-20
-        {
-            TxMsgBuf[0] = 0x00;
-            TxMsgBuf[1] = 0x00;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x00;
-            len = 4;
-            tx = true;
-        }
-        else
-        {
-            unsupported(mode, pid);
-        }
-    }
-
-    //=============================================================================
-    // MODE $07 - Show pending DTCs (Detected during current or last driving cycle)
-    //=============================================================================
-    else if (mode == 0x07)
-    {
-        //                         U00BA        P0011      B0013       B1045       B2031
-        const uint8_t DTCs[] = { 0xC0, 0xBA, 0x00, 0x11, 0x80, 0x13, 0x90, 0x45, 0xA0, 0x31 };
-        if (!ClearedDTCs)
-        {
-            pid = 0x05;         // DTC count
-            iso_tp(mode, pid, sizeof(DTCs), DTCs);
-        }
-        else
-        {
-            const uint8_t none = 0x00;
-            pid = 0x00;         // dummy
-            iso_tp(mode, pid, 1, &none);
-        }
-    }
-
-    //=============================================================================
-    // MODE $08 - Control operation of on-board component/system
-    //=============================================================================
-    else if (mode == 0x08)
-    {
-        unsupported(mode, pid);
-    }
-
-    //=============================================================================
-    // MODE $09 - Request vehicle information
-    //=============================================================================
-    else if (mode == 0x09)
-    {
-        if (pid == 0x00)        // Supported PIDs 01-20
-        {
-            TxMsgBuf[0] = 0x54;
-            TxMsgBuf[1] = 0x40;
-            TxMsgBuf[2] = 0x00;
-            TxMsgBuf[3] = 0x00;
-            len = 4;
-            tx = true;
-        }
-#ifdef EXTRAS
-        else if (pid == 0x01)    // VIN message count for PID 02. (Only for ISO 9141-2, ISO 14230-4 and SAE J1850.)
-        {
-        }
-#endif
-        else if (pid == 0x02)    // VIN (17 to 20 Bytes) Uses ISO-TP
-        {
-            const uint8_t VIN[] = { "1ZVBP8AM7D5220181" };
-
-            TxMsgBuf[0] = 0x01;
-            memcpy(&TxMsgBuf[1], VIN, sizeof(VIN));
-            iso_tp(mode, pid, 1 + sizeof(VIN) - 1, TxMsgBuf);
-        }
-#ifdef EXTRAS
-        else if (pid == 0x03)    // Calibration ID message count for PID 04. (Only for ISO 9141-2, ISO 14230-4 and SAE J1850.)
-        {
-        }
-#endif
-        else if (pid == 0x04)    // Calibration ID
-        {
-            const uint8_t CID[] = { "Arduino OBDIIsimQRST" };
-
-            TxMsgBuf[0] = 0x01;
-            memcpy(&TxMsgBuf[1], CID, sizeof(CID));
-            iso_tp(mode, pid, 1 + sizeof(CID) - 1, TxMsgBuf);
-        }
-#ifdef EXTRAS
-        else if (pid == 0x05)    // Calibration Verification Number (CVN) message count for PID 06. (Only for ISO 9141-2, ISO 14230-4 and SAE J1850.)
-        {
-        }
-#endif
-        else if (pid == 0x06)    // CVN
-        {
-            const uint8_t CVN[] = { "BBB\"CCC" };
-
-            TxMsgBuf[0] = 0x01;
-            TxMsgBuf[1] = 0x11;
-            memcpy(&TxMsgBuf[2], CVN, sizeof(CVN));
-            iso_tp(mode, pid, 2 + sizeof(CVN) - 1, TxMsgBuf);
-        }
-#ifdef EXTRAS
-        else if (pid == 0x07)    // In-use performance tracking message count for PID 08 and 0B. (Only for ISO 9141-2, ISO 14230-4 and SAE J1850.)
-        {
-        }
-        else if (pid == 0x08)    // In-use performance tracking for spark ignition vehicles.
-        {
-        }
-        else if (pid == 0x09)    // ECU name message count for PID 0A.
-        {
-        }
-#endif
-        else if (pid == 0x0A)    // ECM Name
-        {
-            const uint8_t ECMname[] = { "ACM" "\x00" "-ArduinoOBDIIsim" };
-
-            TxMsgBuf[0] = 0x01;
-            memcpy(&TxMsgBuf[1], ECMname, sizeof(ECMname));
-            iso_tp(mode, pid, 1 + sizeof(ECMname) - 1, TxMsgBuf);
-        }
-#ifdef EXTRAS
-        else if (pid == 0x0B)    // In-use performance tracking for compression ignition vehicles.
-        {
-        }
-        else if (pid == 0x0C)    // ESN message count for PID 0D.
-        {
-        }
-#endif
-        else if (pid == 0x0D)    // ESN
-        {
-            const uint8_t ESN[] = { "Arduino-OBDIIsim" };
-
-            TxMsgBuf[0] = 0x01;
-            memcpy(&TxMsgBuf[1], ESN, sizeof(ESN));
-            iso_tp(mode, pid, 1 + sizeof(ESN) - 1, TxMsgBuf);
-        }
-        else
-        {
-            unsupported(mode, pid);
-        }
-    }
-
-    //=============================================================================
-    // MODE $0A - Show permanent DTCs
-    //=============================================================================
-    else if (mode == 0x0A)
-    {
-        //                         U00BA        P0011      B0013       B1045       B2031
-        const uint8_t DTCs[] = { 0xC0, 0xBA, 0x00, 0x11, 0x80, 0x13, 0x90, 0x45, 0xA0, 0x31 };
-        pid = 0x05;         // DTC count
-        iso_tp(mode, pid, sizeof(DTCs), DTCs);
-    }
-
-    // UDS Modes: Diagonstic and Communications Management =======================================
-    //=============================================================================
-    // MODE $10 - Diagnostic Session Control
-    //=============================================================================
-#ifdef EXTRAS
-    else if (mode == 0x10)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $11 - ECU Reset
-    //=============================================================================
-    else if (mode == 0x11)
-    {
-        TxMsgBuf[0] = mode;
-        iso_tp(mode, pid, 1, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $27 - Security Access
-    //=============================================================================
-    else if (mode == 0x27)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $28 - Communication Control
-    //=============================================================================
-    else if (mode == 0x28)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $3E - Tester Present
-    //=============================================================================
-    else if (mode == 0x3E)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $83 - Access Timing Parameters
-    //=============================================================================
-    else if (mode == 0x83)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $84 - Secured Data Transmission
-    //=============================================================================
-    else if (mode == 0x84)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $85 - Control DTC Sentings
-    //=============================================================================
-    else if (mode == 0x85)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $86 - Response On Event
-    //=============================================================================
-    else if (mode == 0x86)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $87 - Link Control
-    //=============================================================================
-    else if (mode == 0x87)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    // UDS Modes: Data Transmission ==============================================================
-    //=============================================================================
-    // MODE $22 - Read Data By Identifier
-    //=============================================================================
-    else if (mode == 0x22)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $23 - Read Memory By Address
-    //=============================================================================
-    else if (mode == 0x23)
-    {
-        TxMsgBuf[0] = mode;
-        iso_tp(mode, pid, 1, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $24 - Read Scaling Data By Identifier
-    //=============================================================================
-    else if (mode == 0x24)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $2A - Read Data By Periodic Identifier
-    //=============================================================================
-    else if (mode == 0x2A)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $2C - Dynamically Define Data Identifier
-    //=============================================================================
-    else if (mode == 0x2C)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $2E - Write Data By Identifier
-    //=============================================================================
-    else if (mode == 0x2E)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $3D - Write Memory By Address
-    //=============================================================================
-    else if (mode == 0x3D)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    // UDS Modes: Stored Data Transmission =======================================================
-    //=============================================================================
-    // MODE $14 - Clear Diagnostic Information
-    //=============================================================================
-    else if (mode == 0x14)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $19 - Read DTC Information
-    //=============================================================================
-    else if (mode == 0x19)
-    {
-        TxMsgBuf[0] = mode;
-        iso_tp(mode, pid, 1, TxMsgBuf);
-    }
-
-    // UDS Modes: Input Output Control ===========================================================
-    //=============================================================================
-    // MODE $2F - Input Output Control By Identifier
-    //=============================================================================
-    else if (mode == 0x2F)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    // UDS Modes: Remote Activation of Routine ===================================================
-    //=============================================================================
-    // MODE $31 - Routine Control
-    //=============================================================================
-    else if (mode == 0x2F)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    // UDS Modes: Upload / Download ==============================================================
-    //=============================================================================
-    // MODE $34 - Request Download
-    //=============================================================================
-    else if (mode == 0x34)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $35 - Request Upload
-    //=============================================================================
-    else if (mode == 0x35)
-    {
-        TxMsgBuf[0] = mode;
-        iso_tp(mode, pid, 1, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $36 - Transfer Data
-    //=============================================================================
-    else if (mode == 0x36)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $37 - Request Transfer Exit
-    //=============================================================================
-    else if (mode == 0x37)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-
-    //=============================================================================
-    // MODE $38 - Request File Transfer
-    //=============================================================================
-    else if (mode == 0x38)
-    {
-        TxMsgBuf[0] = mode;
-        TxMsgBuf[1] = 0x00;
-        iso_tp(mode, pid, 2, TxMsgBuf);
-    }
-#endif
-    else
-    {
-        unsupported(mode, pid);
-    }
-
-    if (tx)
-    {
-        iso_tp(mode, pid, len, TxMsgBuf);
-    }
-}
-
-// Generic debug serial output
-void unsupported(uint8_t mode, uint8_t pid)
-{
-    negAck(mode, 0x12);
-    unsupportedPrint(mode, pid);
-}
-
-// Generic debug serial output
-void negAck(uint8_t mode, uint8_t reason)
-{
-    const uint8_t txData[] = { 0x03, 0x7F, mode, reason, PAD, PAD, PAD, PAD };
-
-    CAN0.MCP2515_Send(Reply_ID, 8, (uint8_t *)txData);
-}
+        Serial.println("ISO-TP reply not sent");
+    }
+}
 
 // Generic debug serial output
 void unsupportedPrint(uint8_t mode, uint8_t pid)
@@ -1274,146 +351,32 @@ void unsupportedPrint(uint8_t mode, uint8_t pid)
     Serial.println(msgstring);
 }
 
-// Blocking example of ISO transport (ISO-TP i.e. ISO 15765-2)
-// See: https://en.wikipedia.org/wiki/ISO_15765-2
-void iso_tp(uint8_t mode, uint8_t pid, int len, const uint8_t * data)
+// ISO-TP physical request received (Listen_ID) - mode, pid, ...
+void isoTpReq(uint8_t session, uint8_t * data, uint16_t len)
 {
-    CAN_FRAME frame;
-    uint8_t tpData[8];
-    int offset = 0;
-    uint8_t index = 0;
+    uint8_t req[8] = { 0 };
 
-    len += 2;
-    if (len < 8)
+    (void)session;
+    if ((len < 1) || (len > 7))
     {
-        // Single frame
-Serial.println("Sending SF");
-
-        if (len == 2)
-        {
-            tpData[0] = TP_SF | (len - 1);
-            tpData[1] = (uint8_t)(RESPONSE_BIT | mode);
-            tpData[2] = data[offset];
-        }
-        else
-        {
-            tpData[0] = TP_SF | len;
-            tpData[1] = (uint8_t)(RESPONSE_BIT | mode);
-            tpData[2] = pid;
-        }
-
-        for (uint8_t i = 3; i < 8; ++i)
-        {
-            if (i <= len)
-            {
-                tpData[i] = data[offset++];
-            }
-            else
-            {
-                tpData[i] = PADDING;
-            }
-        }
-        CAN0.MCP2515_Send(Reply_ID, 8, tpData);
+        Serial.println("Invalid OBD-II Message!");
         return;
     }
+    req[0] = (uint8_t)len;      // same layout as Single Frame of functional request
+    memcpy(&req[1], data, len);
+    obdReq(req);
+}
 
+// ISO-TP reply sent (or failed)
+void isoTpDone(uint8_t session, uint8_t result)
+{
+    char msgstring[32];
 
-    // First frame
-Serial.println("Sending FF");
-    tpData[0] = TP_FF | ((len >> 8) & 0x0F);
-    tpData[1] = 0x00FF & len;
-    tpData[2] = (uint8_t)(RESPONSE_BIT | mode);
-    tpData[3] = pid;
-    for (uint8_t i = 4; i < 8; i++)
-    {
-        tpData[i] = data[offset++];
-    }
-    CAN0.MCP2515_Send(Reply_ID, 8, tpData);
-    index++;        // We sent a packet so increase our index.
-
-    bool not_done = true;
-    unsigned long sepPrev = millis();
-    uint8_t sepInvl = 0;
-    uint8_t frames = 0;
-    bool lockout = false;
-
-    while (not_done)
+    (void)session;
+    if (result != ISOTP_OK)
     {
-        // Need to wait for flow frame
-        if (!digitalRead(CAN0_INT))
-        {
-            // CAN0.readMsgBuf(&rxId, &dlc, rxBuf);
-            if (CAN0.MCP2515_Recv(&frame) == MCP2515_OK)
-            {
-                if ((frame.can_id == Listen_ID) && ((frame.can_data[0] & 0xF0) == TP_FC))
-                {
-Serial.println("Received FC");
-                    if ((frame.can_data[0] & 0x0F) == CONT)
-                    {
-                        // Continue
-                        frames = frame.can_data[1];
-                        sepInvl = frame.can_data[2];
-                        lockout = true;
-                    }
-                    else if ((frame.can_data[0] & 0x0F) == WAIT)
-                    {
-                        // Wait
-                        lockout = false;
-                        delay(frame.can_data[2]);
-                    }
-                    else if ((frame.can_data[0] & 0x0F) == ABORT)
-                    {
-                        // Abort
-                        not_done = false;
-                        return;
-                    }
-                }
-            }
-        }
-
-        if (((millis() - sepPrev) >= sepInvl) && lockout)
-        {
-            sepPrev = millis();
-Serial.println("Sending CF");
-            {
-                char msgstring[32];
-
-                sprintf(msgstring, "Offset: 0x%04X\tLen: 0x%04X", offset, (len - 2));
-                Serial.println(msgstring);
-            }
-
-            tpData[0] = TP_CF | index++;         // consecutive frame
-            for (uint8_t i = 1; i < 8; i++)
-            {
-                if (offset != (len - 2))
-                {
-                    tpData[i] = data[offset++];
-                }
-                else
-                {
-                    tpData[i] = PADDING;
-                }
-            }
-
-            // Do consecutive frames (CF) as instructed via flow frame
-            CAN0.MCP2515_Send(Reply_ID, 8, tpData);
-
-            if (frames-- == 1)
-            {
-                lockout = false;
-            }
-        }
-
-        if (offset == (len - 2))
-        {
-            not_done = false;
-        }
-
-        // Timeout
-        if ((millis() - sepPrev) >= 1000)
-        {
-            not_done = false;
-        }
+        sprintf(msgstring, "ISO-TP reply failed: %u", result);
+        Serial.println(msgstring);
     }
 }
 
@@ -0,0 +1,75 @@
+/*
+ * NAME: Arduino.h
+ *
+ * WHAT:
+ *  Minimal Arduino core stand-in for Linux host builds of the DLK_MCP2515 library
+ *  (implemented in Host.cpp).
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Only for Linux host builds - never compiled into Arduino sketches.
+ *  Only what the DLK_MCP2515 library and the host programs use is provided.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#define HIGH                1
+#define LOW                 0
+#define INPUT               0
+#define OUTPUT              1
+#define INPUT_PULLUP        2
+#define CHANGE              1
+#define FALLING             2
+#define RISING              3
+#define NOT_AN_INTERRUPT    (-1)
+#define MSBFIRST            1
+#define HEX                 16
+#define DEC                 10
+#define F(s)                (s)
+#define PROGMEM
+#define memcpy_P            memcpy
+#define digitalPinToInterrupt(p) ((p) < 64 ? (int)(p) : NOT_AN_INTERRUPT)
+
+// Arduino core (virtual time, pins and interrupts - see Host.cpp)
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(int irq, void (*isr)(void), int mode);
+void detachInterrupt(int irq);
+void noInterrupts(void);
+void interrupts(void);
+void yield(void);
+
+#ifdef __cplusplus
+/**
+ * Output stream base (as Arduino Print - only the raw byte output).
+ */
+class Print
+{
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t * buf, size_t n)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                write(buf[i]);
+            }
+            return n;
+        }
+};
+#endif
+
+#endif  // __HOST_ARDUINO_H__
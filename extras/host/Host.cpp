@@ -0,0 +1,314 @@
+/*
+ * NAME: Host.cpp
+ *
+ * WHAT:
+ *  Arduino core, SPI and interrupt stand-ins for Linux host builds.
+ *  Time is virtual: it advances with delay()/delayMicroseconds() and with
+ *  the modelled duration of every SPI byte/transaction.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Only for Linux host builds - never compiled into Arduino sketches.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+
+#include <vector>
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "MCP2515_Model.h"
+
+#define HOST_N_PINS     64
+
+SPIClass SPI;
+SPIClass SPI1;
+
+static std::vector<MCP2515_Model *> Devices;
+static uint8_t PinLevel[HOST_N_PINS];
+static void (* PinIsr[HOST_N_PINS])(void);
+static int PinIsrMode[HOST_N_PINS];
+static uint8_t PinLastLevel[HOST_N_PINS];
+
+static uint64_t NowNs = 0;
+static uint32_t SpiHz = 4000000;
+static uint32_t CsOverheadNs = 1000;
+static uint32_t SpiTransactions = 0;
+static uint32_t SpiBytes = 0;
+static uint64_t SpiNs = 0;
+static uint8_t SpiDepth = 0;
+static bool IntsEnabled = true;
+static bool InIsr = false;
+
+static void Host_CheckInterrupts(void);
+
+static void Host_StepDevices(void)
+{
+    for (size_t i = 0; i < Devices.size(); ++i)
+    {
+        Devices[i]->Step(NowNs / 1000);
+    }
+}
+
+static void Host_AddNs(uint64_t ns)
+{
+    NowNs += ns;
+    Host_StepDevices();
+}
+
+void Host_AddDevice(MCP2515_Model * dev)
+{
+    Devices.push_back(dev);
+    dev->Step(NowNs / 1000);
+}
+
+void Host_Reset(void)
+{
+    Devices.clear();
+    for (int i = 0; i < HOST_N_PINS; ++i)
+    {
+        PinLevel[i] = HIGH;
+        PinLastLevel[i] = HIGH;
+        PinIsr[i] = nullptr;
+    }
+    NowNs = 0;
+    SpiTransactions = 0;
+    SpiBytes = 0;
+    SpiNs = 0;
+    SpiDepth = 0;
+    IntsEnabled = true;
+    InIsr = false;
+}
+
+void Host_Advance(uint32_t us)
+{
+    // advance in small steps so that device events and interrupts interleave
+    while (us > 0)
+    {
+        uint32_t step = (us > 10) ? 10 : us;
+        Host_AddNs((uint64_t)step * 1000);
+        us -= step;
+        Host_CheckInterrupts();
+    }
+}
+
+void Host_SetSpiTiming(uint32_t spi_hz, uint32_t cs_overhead_ns)
+{
+    SpiHz = spi_hz;
+    CsOverheadNs = cs_overhead_ns;
+}
+
+uint32_t Host_SpiTransactions(void)
+{
+    return SpiTransactions;
+}
+
+uint32_t Host_SpiBytes(void)
+{
+    return SpiBytes;
+}
+
+uint64_t Host_SpiNs(void)
+{
+    return SpiNs;
+}
+
+void Host_ResetSpiCounters(void)
+{
+    SpiTransactions = 0;
+    SpiBytes = 0;
+    SpiNs = 0;
+}
+
+uint64_t Host_NowNs(void)
+{
+    return NowNs;
+}
+
+// Arduino core
+
+uint32_t millis(void)
+{
+    return (uint32_t)(NowNs / 1000000ULL);
+}
+
+uint32_t micros(void)
+{
+    return (uint32_t)(NowNs / 1000ULL);
+}
+
+void delay(uint32_t ms)
+{
+    Host_Advance(ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    Host_Advance(us);
+}
+
+void yield(void)
+{
+    Host_Advance(1);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin >= HOST_N_PINS)
+    {
+        return;
+    }
+    PinLevel[pin] = val ? HIGH : LOW;
+    for (size_t i = 0; i < Devices.size(); ++i)
+    {
+        if (Devices[i]->CS_pin == pin)
+        {
+            if (val == LOW)
+            {
+                ++SpiTransactions;
+                SpiNs += CsOverheadNs;
+                Host_AddNs(CsOverheadNs);
+            }
+            Devices[i]->Select(val == LOW);
+        }
+    }
+    if (val == HIGH)
+    {
+        Host_CheckInterrupts();
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    if (pin >= HOST_N_PINS)
+    {
+        return HIGH;
+    }
+    bool driven = false;
+    bool low = false;
+
+    for (size_t i = 0; i < Devices.size(); ++i)
+    {
+        if (Devices[i]->INT_pin == pin)
+        {
+            driven = true;
+            low = low || Devices[i]->IntAsserted();     // wired-OR open drain
+        }
+    }
+    if (driven)
+    {
+        return low ? LOW : HIGH;
+    }
+    return PinLevel[pin];
+}
+
+void attachInterrupt(int irq, void (* isr)(void), int mode)
+{
+    if ((irq >= 0) && (irq < HOST_N_PINS))
+    {
+        PinIsr[irq] = isr;
+        PinIsrMode[irq] = mode;
+        PinLastLevel[irq] = digitalRead(irq);
+    }
+    Host_CheckInterrupts();
+}
+
+void detachInterrupt(int irq)
+{
+    if ((irq >= 0) && (irq < HOST_N_PINS))
+    {
+        PinIsr[irq] = nullptr;
+    }
+}
+
+void noInterrupts(void)
+{
+    IntsEnabled = false;
+}
+
+void interrupts(void)
+{
+    IntsEnabled = true;
+    Host_CheckInterrupts();
+}
+
+// fire pending pin interrupts (LOW level or FALLING edge)
+static void Host_CheckInterrupts(void)
+{
+    if (!IntsEnabled || InIsr || (SpiDepth > 0))
+    {
+        return;
+    }
+    for (int pin = 0; pin < HOST_N_PINS; ++pin)
+    {
+        if (PinIsr[pin] == nullptr)
+        {
+            continue;
+        }
+        for (uint8_t guard = 0; guard < 32; ++guard)
+        {
+            uint8_t level = digitalRead(pin);
+            bool fire = (PinIsrMode[pin] == LOW) ? (level == LOW) :
+                        ((PinIsrMode[pin] == FALLING) && (level == LOW) && (PinLastLevel[pin] == HIGH));
+            PinLastLevel[pin] = level;
+            if (!fire || (PinIsr[pin] == nullptr) || !IntsEnabled)
+            {
+                break;
+            }
+            InIsr = true;
+            PinIsr[pin]();
+            InIsr = false;
+        }
+    }
+}
+
+// SPI
+
+void SPIClass::beginTransaction(SPISettings s)
+{
+    SpiHz = s.clock;
+    ++SpiDepth;
+}
+
+void SPIClass::endTransaction(void)
+{
+    if (SpiDepth > 0)
+    {
+        --SpiDepth;
+    }
+    Host_CheckInterrupts();
+}
+
+uint8_t SPIClass::transfer(uint8_t b)
+{
+    uint8_t miso = 0xff;
+
+    ++SpiBytes;
+    for (size_t i = 0; i < Devices.size(); ++i)
+    {
+        if (PinLevel[Devices[i]->CS_pin] == LOW)
+        {
+            miso = Devices[i]->Exchange(b);
+        }
+    }
+    SpiNs += 8000000000ULL / SpiHz;
+    Host_AddNs(8000000000ULL / SpiHz);
+    return miso;
+}
+
+void SPIClass::transfer(void * buf, size_t cnt)
+{
+    uint8_t * p = (uint8_t *)buf;
+
+    for (size_t i = 0; i < cnt; ++i)
+    {
+        p[i] = transfer(p[i]);
+    }
+}
@@ -0,0 +1,32 @@
+/*
+ * NAME: HostCheck.h
+ *
+ * WHAT:
+ *  Check macro of the Linux host test programs.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Only for Linux host builds - never compiled into Arduino sketches.
+ *  A failed check prints its source line and exits with 1 (fails make check).
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __HOST_CHECK_H__
+#define __HOST_CHECK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// exit with 1 if condition 'cond' is false
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+            exit(1);                                                            \
+        }                                                                       \
+    } while (0)
+
+#endif  // __HOST_CHECK_H__
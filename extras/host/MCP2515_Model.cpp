@@ -0,0 +1,827 @@
+/*
+ * NAME: MCP2515_Model.cpp
+ *
+ * WHAT:
+ *  Host-side MCP2515 register/instruction model.
+ *  Decodes the MCP2515 SPI instruction set (RESET, READ, WRITE, BIT MODIFY,
+ *  READ STATUS, RX STATUS, LOAD TX BUFFER, RTS, READ RX BUFFER) and models
+ *  the Tx/Rx buffers, acceptance masks/filters, interrupt flags and the
+ *  error counters closely enough for driver testing and SPI cost benchmarking.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Only for Linux host builds - never compiled into Arduino sketches.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+
+#include "MCP2515_Model.h"
+
+// MCP2515 registers only writable in Configuration mode
+static bool ConfigOnlyReg(uint8_t reg)
+{
+    return ((reg <= MCP2515_RXF2EID0) ||
+            ((reg >= MCP2515_RXF3SIDH) && (reg <= MCP2515_RXF5EID0)) ||
+            ((reg >= MCP2515_RXM0SIDH) && (reg <= MCP2515_CNF1)));
+}
+
+MCP2515_Model::MCP2515_Model(uint8_t cs_pin, uint8_t int_pin, uint32_t osc_hz)
+{
+    CS_pin = cs_pin;
+    INT_pin = int_pin;
+    Osc_Hz = osc_hz;
+    ModeDelayUs = 20;
+    Bus = nullptr;
+    Now = 0;
+    HardReset();
+}
+
+MCP2515_Model::~MCP2515_Model()
+{
+}
+
+// device hardware reset
+void MCP2515_Model::HardReset(void)
+{
+    memset(Regs, 0, sizeof(Regs));
+    Regs[MCP2515_CANCTRL] = 0x87;       // REQOP = Configuration, CLKEN, CLKPRE = /8
+    Regs[MCP2515_CANSTAT] = MODE_CONFIG;
+    Selected = false;
+    Instr = 0;
+    Count = 0;
+    Addr = 0;
+    ModePending = false;
+    TxActive = -1;
+    HoldTx = false;
+    AbortPending = 0;
+    BusOffDue = 0;
+    Transactions = 0;
+    Bytes = 0;
+    FramesSent = 0;
+    FramesReceived = 0;
+    FramesOverrun = 0;
+    FramesFiltered = 0;
+}
+
+// bit time in nS derived from CNF1..3
+uint32_t MCP2515_Model::BitTimeNs(void) const
+{
+    uint32_t brp = (Regs[MCP2515_CNF1] & BRP_BITS) + 1;
+    uint32_t prseg = (Regs[MCP2515_CNF2] & PRSEG_BITS) + 1;
+    uint32_t ps1 = ((Regs[MCP2515_CNF2] & PHSEG1_BITS) >> 3) + 1;
+    uint32_t ps2 = (Regs[MCP2515_CNF3] & PHSEG2_BITS) + 1;
+    uint64_t tq_ns = (2ULL * brp * 1000000000ULL) / Osc_Hz;
+
+    if (!(Regs[MCP2515_CNF2] & BTLMODE))
+    {
+        ps2 = (ps1 > 2) ? ps1 : 2;      // PS2 = max(PS1, IPT)
+    }
+    return (uint32_t)(tq_ns * (1 + prseg + ps1 + ps2));
+}
+
+// state of the ~INT output
+bool MCP2515_Model::IntAsserted(void) const
+{
+    return (Regs[MCP2515_CANINTE] & Regs[MCP2515_CANINTF]) != 0;
+}
+
+// SPI chip select edge
+void MCP2515_Model::Select(bool asserted)
+{
+    if (asserted && !Selected)
+    {
+        Selected = true;
+        Count = 0;
+        ++Transactions;
+    }
+    else if (!asserted && Selected)
+    {
+        Selected = false;
+
+        // READ RX BUFFER clears the associated RXnIF when CS is raised
+        if ((Count > 0) && ((Instr & 0xf9) == MCP2515_READ_RX0H))
+        {
+            Regs[MCP2515_CANINTF] &= ~((Instr & 0x04) ? MCP2515_RX1IF : MCP2515_RX0IF);
+            UpdateIcod();
+        }
+    }
+}
+
+// READ STATUS instruction value
+uint8_t MCP2515_Model::ReadStatus(void) const
+{
+    uint8_t intf = Regs[MCP2515_CANINTF];
+    uint8_t stat = 0;
+
+    stat |= (intf & MCP2515_RX0IF) ? STAT_RX0IF : 0;
+    stat |= (intf & MCP2515_RX1IF) ? STAT_RX1IF : 0;
+    stat |= (Regs[MCP2515_TXB0CTRL] & TXB_TXREQ_BIT) ? STAT_TX0REQ : 0;
+    stat |= (intf & MCP2515_TX0IF) ? STAT_TX0IF : 0;
+    stat |= (Regs[MCP2515_TXB1CTRL] & TXB_TXREQ_BIT) ? STAT_TX1REQ : 0;
+    stat |= (intf & MCP2515_TX1IF) ? STAT_TX1IF : 0;
+    stat |= (Regs[MCP2515_TXB2CTRL] & TXB_TXREQ_BIT) ? STAT_TX2REQ : 0;
+    stat |= (intf & MCP2515_TX2IF) ? STAT_TX2IF : 0;
+    return stat;
+}
+
+// RX STATUS instruction value
+uint8_t MCP2515_Model::RxStatus(void) const
+{
+    uint8_t intf = Regs[MCP2515_CANINTF];
+    uint8_t stat = 0;
+    uint8_t base;
+
+    if (intf & MCP2515_RX0IF)
+    {
+        stat |= RXM_RXB0_MSG;
+    }
+    if (intf & MCP2515_RX1IF)
+    {
+        stat |= RXM_RXB1_MSG;
+    }
+    if (stat == 0)
+    {
+        return stat;
+    }
+
+    base = (intf & MCP2515_RX0IF) ? MCP2515_RXB0CTRL : MCP2515_RXB1CTRL;
+    if (Regs[base + MCP2515_BUF_SIDL] & MCP2515_RXB_IDE)
+    {
+        stat |= (Regs[base + MCP2515_BUF_DLC] & MCP2515_RTR_MASK) ? MTYP_EXT_REM : MTYP_EXT_DATA;
+    }
+    else
+    {
+        stat |= (Regs[base] & RXRTR_BIT) ? MTYP_STD_REM : MTYP_STD_DATA;
+    }
+
+    if (base == MCP2515_RXB0CTRL)
+    {
+        stat |= (Regs[base] & FILHIT0_BIT);
+    }
+    else
+    {
+        uint8_t fm = Regs[base] & FILHIT_MASK;
+        stat |= (fm < FILHIT_RXF2) ? (FM_RXF0_RXB1 + fm) : fm;     // RXF0/RXF1 in RXB1 = rollover
+    }
+    return stat;
+}
+
+// SPI byte exchange while selected
+uint8_t MCP2515_Model::Exchange(uint8_t mosi)
+{
+    uint8_t miso = 0xff;
+
+    if (!Selected)
+    {
+        return miso;
+    }
+
+    ++Bytes;
+    if (Count == 0)
+    {
+        Instr = mosi;
+        Count = 1;
+
+        if (Instr == MCP2515_RESET)
+        {
+            HardReset();
+            Selected = true;
+            Count = 1;
+            Instr = MCP2515_RESET;
+        }
+        else if ((Instr & 0xf8) == MCP2515_LOAD_TX0H)
+        {
+            static const uint8_t loadaddr[6] =
+            {
+                MCP2515_TXB0SIDH, MCP2515_TXB0D0, MCP2515_TXB1SIDH,
+                MCP2515_TXB1D0, MCP2515_TXB2SIDH, MCP2515_TXB2D0
+            };
+            Addr = loadaddr[(Instr & 0x07) % 6];
+        }
+        else if ((Instr & 0xf9) == MCP2515_READ_RX0H)
+        {
+            static const uint8_t readaddr[4] =
+            {
+                MCP2515_RXB0SIDH, MCP2515_RXB0D0, MCP2515_RXB1SIDH, MCP2515_RXB1D0
+            };
+            Addr = readaddr[(Instr >> 1) & 0x03];
+        }
+        else if ((Instr & 0xf8) == 0x80)    // RTS
+        {
+            HoldTx = true;                  // all requested buffers compete together
+            for (uint8_t i = 0; i < MCP2515_N_TXBUFFERS; ++i)
+            {
+                if (Instr & (1 << i))
+                {
+                    uint8_t ctrl = MCP2515_TXB0CTRL + (i << 4);
+                    WriteReg(ctrl, Regs[ctrl] | TXB_TXREQ_BIT, true);
+                }
+            }
+            HoldTx = false;
+            StartNextTx();
+        }
+        return miso;
+    }
+
+    switch (Instr)
+    {
+        case MCP2515_READ:
+            if (Count == 1)
+            {
+                Addr = mosi & 0x7f;
+            }
+            else
+            {
+                miso = Regs[Addr];
+                Addr = (Addr + 1) & 0x7f;
+            }
+            break;
+
+        case MCP2515_WRITE:
+            if (Count == 1)
+            {
+                Addr = mosi & 0x7f;
+            }
+            else
+            {
+                WriteReg(Addr, mosi, true);
+                Addr = (Addr + 1) & 0x7f;
+            }
+            break;
+
+        case MCP2515_BITMOD:
+            if (Count == 1)
+            {
+                Addr = mosi & 0x7f;
+            }
+            else if (Count == 2)
+            {
+                BitModMask = mosi;
+            }
+            else if (Count == 3)
+            {
+                WriteReg(Addr, (Regs[Addr] & ~BitModMask) | (mosi & BitModMask), true);
+            }
+            break;
+
+        case MCP2515_READ_STATUS:
+            miso = ReadStatus();
+            break;
+
+        case MCP2515_RX_STATUS:
+            miso = RxStatus();
+            break;
+
+        default:
+            if ((Instr & 0xf8) == MCP2515_LOAD_TX0H)
+            {
+                WriteReg(Addr, mosi, true);
+                Addr = (Addr + 1) & 0x7f;
+            }
+            else if ((Instr & 0xf9) == MCP2515_READ_RX0H)
+            {
+                miso = Regs[Addr];
+                Addr = (Addr + 1) & 0x7f;
+            }
+            break;
+    }
+    if (Count < 0xff)
+    {
+        ++Count;
+    }
+    return miso;
+}
+
+// register write with MCP2515 access rules
+void MCP2515_Model::WriteReg(uint8_t reg, uint8_t val, bool from_mcu)
+{
+    uint8_t old = Regs[reg];
+
+    if (from_mcu && ConfigOnlyReg(reg) && (OpMode() != MODE_CONFIG))
+    {
+        return;     // ignored outside of Configuration mode
+    }
+
+    switch (reg)
+    {
+        case MCP2515_CANSTAT:
+        case MCP2515_TEC:
+        case MCP2515_REC:
+            return;     // read-only
+
+        case MCP2515_CANCTRL:
+            Regs[reg] = val & ~ABORT_TX;
+            if (val & ABORT_TX)
+            {
+                for (uint8_t i = 0; i < MCP2515_N_TXBUFFERS; ++i)
+                {
+                    uint8_t ctrl = MCP2515_TXB0CTRL + (i << 4);
+                    if ((Regs[ctrl] & TXB_TXREQ_BIT) && (TxActive != i))
+                    {
+                        Regs[ctrl] = (Regs[ctrl] & ~TXB_TXREQ_BIT) | TXB_ABTF_BIT;
+                    }
+                }
+            }
+            if ((val & MODE_MASK) != (old & MODE_MASK) || (val & MODE_MASK) != OpMode())
+            {
+                ModePending = true;
+                ModeRequested = val & MODE_MASK;
+                ModeDue = Now + ModeDelayUs;
+                if (ModeDelayUs == 0)
+                {
+                    Step(Now);
+                }
+            }
+            break;
+
+        case MCP2515_EFLG:
+            Regs[reg] = old & (val | ~(MCP2515_EFLG_RX1OVR | MCP2515_EFLG_RX0OVR));
+            break;
+
+        case MCP2515_TXB0CTRL:
+        case MCP2515_TXB1CTRL:
+        case MCP2515_TXB2CTRL:
+        {
+            uint8_t txb = (reg >> 4) - 3;
+
+            val &= (TXB_TXREQ_BIT | TXB_TXP10_MASK);
+            if ((val & TXB_TXREQ_BIT) && !(old & TXB_TXREQ_BIT))
+            {
+                Regs[reg] = val;        // new request clears ABTF, MLOA, TXERR
+            }
+            else if (!(val & TXB_TXREQ_BIT) && (old & TXB_TXREQ_BIT))
+            {
+                if (TxActive == txb)
+                {
+                    // message on the wire continues to transmit (aborted if it fails)
+                    Regs[reg] = (old & ~TXB_TXP10_MASK) | (val & TXB_TXP10_MASK);
+                    AbortPending |= (1 << txb);
+                }
+                else
+                {
+                    Regs[reg] = (old & (TXB_MLOA_BIT | TXB_TXERR_BIT)) | TXB_ABTF_BIT | val;
+                }
+            }
+            else
+            {
+                Regs[reg] = (old & ~(TXB_TXREQ_BIT | TXB_TXP10_MASK)) | val;
+            }
+            break;
+        }
+
+        case MCP2515_RXB0CTRL:
+            Regs[reg] = (old & ~(RXM_MASK | BUKT_BIT | BUKT1_BIT)) | (val & (RXM_MASK | BUKT_BIT));
+            Regs[reg] |= (val & BUKT_BIT) ? BUKT1_BIT : 0;
+            break;
+
+        case MCP2515_RXB1CTRL:
+            Regs[reg] = (old & ~RXM_MASK) | (val & RXM_MASK);
+            break;
+
+        default:
+            Regs[reg] = val;
+            break;
+    }
+    UpdateIcod();
+    StartNextTx();
+}
+
+// CANSTAT.ICOD reflects highest priority enabled pending interrupt
+void MCP2515_Model::UpdateIcod(void)
+{
+    static const uint8_t order[7][2] =
+    {
+        { MCP2515_ERRIF, ERROR_INT }, { MCP2515_WAKIF, WAKE_UP_INT },
+        { MCP2515_TX0IF, TXB0_INT }, { MCP2515_TX1IF, TXB1_INT }, { MCP2515_TX2IF, TXB2_INT },
+        { MCP2515_RX0IF, RXB0_INT }, { MCP2515_RX1IF, RXB1_INT }
+    };
+    uint8_t ints = Regs[MCP2515_CANINTE] & Regs[MCP2515_CANINTF];
+    uint8_t icod = NO_INT;
+
+    for (uint8_t i = 0; i < 7; ++i)
+    {
+        if (ints & order[i][0])
+        {
+            icod = order[i][1];
+            break;
+        }
+    }
+    Regs[MCP2515_CANSTAT] = (Regs[MCP2515_CANSTAT] & ~INT_MASK) | icod;
+}
+
+// EFLG error state bits from TEC/REC
+void MCP2515_Model::UpdateErrorFlags(void)
+{
+    uint8_t tec = Regs[MCP2515_TEC];
+    uint8_t rec = Regs[MCP2515_REC];
+    uint8_t old = Regs[MCP2515_EFLG];
+    uint8_t eflg = old & (MCP2515_EFLG_RX1OVR | MCP2515_EFLG_RX0OVR | MCP2515_EFLG_TXBO);
+
+    if (tec >= 96)
+    {
+        eflg |= MCP2515_EFLG_TXWAR | MCP2515_EFLG_EWARN;
+    }
+    if (rec >= 96)
+    {
+        eflg |= MCP2515_EFLG_RXWAR | MCP2515_EFLG_EWARN;
+    }
+    if (tec >= 128)
+    {
+        eflg |= MCP2515_EFLG_TXEP;
+    }
+    if (rec >= 128)
+    {
+        eflg |= MCP2515_EFLG_RXEP;
+    }
+    Regs[MCP2515_EFLG] = eflg;
+    if ((eflg & ~old) & (MCP2515_EFLG_TXBO | MCP2515_EFLG_TXEP | MCP2515_EFLG_RXEP | MCP2515_EFLG_EWARN))
+    {
+        Regs[MCP2515_CANINTF] |= MCP2515_ERRIF;
+    }
+}
+
+// start highest priority pending Tx buffer
+void MCP2515_Model::StartNextTx(void)
+{
+    int8_t best = -1;
+    uint8_t best_p = 0;
+    uint8_t mode = OpMode();
+
+    if (HoldTx || (TxActive >= 0) || ((mode != MODE_NORMAL) && (mode != MODE_LOOPBACK)) ||
+        (Regs[MCP2515_EFLG] & MCP2515_EFLG_TXBO))
+    {
+        return;
+    }
+
+    // highest TXP wins, equal TXP - highest buffer number wins
+    for (int8_t i = 0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        uint8_t ctrl = Regs[MCP2515_TXB0CTRL + (i << 4)];
+        if ((ctrl & TXB_TXREQ_BIT) && ((best < 0) || ((ctrl & TXB_TXP10_MASK) >= best_p)))
+        {
+            best = i;
+            best_p = ctrl & TXB_TXP10_MASK;
+        }
+    }
+    if (best < 0)
+    {
+        return;
+    }
+
+    uint8_t base = MCP2515_TXB0CTRL + (best << 4);
+    uint8_t dlc = Regs[base + MCP2515_BUF_DLC] & MCP2515_DLC_MASK;
+    uint32_t bits;
+
+    if (dlc > CAN_MAX_DLEN)
+    {
+        dlc = CAN_MAX_DLEN;
+    }
+    bits = (Regs[base + MCP2515_BUF_SIDL] & MCP2515_RXB_IDE) ? 67 : 47;
+    if (!(Regs[base + MCP2515_BUF_DLC] & MCP2515_RTR_MASK))
+    {
+        bits += 8 * dlc;
+    }
+    TxActive = best;
+    TxDue = Now + (((uint64_t)bits * BitTimeNs()) + 999) / 1000;
+}
+
+// complete transmission of active Tx buffer
+void MCP2515_Model::FinishTx(void)
+{
+    uint8_t base = MCP2515_TXB0CTRL + (TxActive << 4);
+    uint8_t sidl = Regs[base + MCP2515_BUF_SIDL];
+    CAN_FRAME frame;
+    bool ack;
+
+    if (sidl & MCP2515_RXB_IDE)
+    {
+        frame.can_id = ((uint32_t)Regs[base + MCP2515_BUF_SIDH] << 21) |
+                       ((uint32_t)(sidl >> 5) << 18) | ((uint32_t)(sidl & 0x03) << 16) |
+                       ((uint32_t)Regs[base + MCP2515_BUF_EID8] << 8) | Regs[base + MCP2515_BUF_EID0];
+        frame.can_id |= CAN_EFF_FLAG;
+    }
+    else
+    {
+        frame.can_id = ((uint32_t)Regs[base + MCP2515_BUF_SIDH] << 3) | (sidl >> 5);
+    }
+    if (Regs[base + MCP2515_BUF_DLC] & MCP2515_RTR_MASK)
+    {
+        frame.can_id |= CAN_RTR_FLAG;
+    }
+    frame.can_dlc = Regs[base + MCP2515_BUF_DLC] & MCP2515_DLC_MASK;
+    if (frame.can_dlc > CAN_MAX_DLEN)
+    {
+        frame.can_dlc = CAN_MAX_DLEN;
+    }
+    frame.can_rxb = 0;
+    memcpy(frame.can_data, &Regs[base + MCP2515_BUF_DATA0], CAN_MAX_DLEN);
+
+    if (OpMode() == MODE_LOOPBACK)
+    {
+        Receive(&frame);
+        ack = true;
+    }
+    else
+    {
+        ack = (Bus != nullptr) && Bus->Transmit(this, &frame);
+    }
+
+    if (ack)
+    {
+        ++FramesSent;
+        Regs[base] &= ~(TXB_TXREQ_BIT | TXB_TXERR_BIT);
+        Regs[MCP2515_CANINTF] |= (MCP2515_TX0IF << TxActive);
+        if (Regs[MCP2515_TEC] > 0)
+        {
+            --Regs[MCP2515_TEC];
+        }
+    }
+    else    // acknowledge error
+    {
+        Regs[base] |= TXB_TXERR_BIT;
+        Regs[MCP2515_CANINTF] |= MCP2515_MERRF;
+        if (Regs[MCP2515_TEC] > 255 - 8)
+        {
+            Regs[MCP2515_TEC] = 255;
+            Regs[MCP2515_EFLG] |= MCP2515_EFLG_TXBO;
+            BusOffDue = Now + ((uint64_t)128 * 11 * BitTimeNs()) / 1000;
+        }
+        else if ((Regs[MCP2515_TEC] < 128) || (Regs[MCP2515_TEC] >= 128 && Bus && Bus->AckPeer))
+        {
+            Regs[MCP2515_TEC] += 8;     // error passive node with no ack does not increment further
+        }
+        if ((Regs[MCP2515_CANCTRL] & MODE_ONESHOT) || (AbortPending & (1 << TxActive)))
+        {
+            Regs[base] = (Regs[base] & ~TXB_TXREQ_BIT) | TXB_ABTF_BIT;
+        }
+    }
+    AbortPending &= ~(1 << TxActive);
+    UpdateErrorFlags();
+    TxActive = -1;
+    UpdateIcod();
+}
+
+// advance device state to specified time
+void MCP2515_Model::Step(uint64_t now_us)
+{
+    Now = now_us;
+
+    if (ModePending && (Now >= ModeDue))
+    {
+        ModePending = false;
+        if ((ModeRequested == MODE_CONFIG) && (TxActive >= 0))
+        {
+            FinishTx();     // pending transmission completes first
+        }
+        Regs[MCP2515_CANSTAT] = (Regs[MCP2515_CANSTAT] & ~MODE_MASK) | ModeRequested;
+    }
+
+    if ((Regs[MCP2515_EFLG] & MCP2515_EFLG_TXBO) && (Now >= BusOffDue))
+    {
+        Regs[MCP2515_EFLG] &= ~(MCP2515_EFLG_TXBO | MCP2515_EFLG_TXEP | MCP2515_EFLG_TXWAR | MCP2515_EFLG_EWARN);
+        Regs[MCP2515_TEC] = 0;
+        Regs[MCP2515_REC] = 0;
+    }
+
+    for (uint8_t guard = 0; guard < 16; ++guard)
+    {
+        StartNextTx();
+        if ((TxActive < 0) || (Now < TxDue))
+        {
+            break;
+        }
+        FinishTx();
+    }
+}
+
+// acceptance check of frame against mask/filter pair
+bool MCP2515_Model::Match(const CAN_FRAME * frame, uint8_t mask_reg, uint8_t filt_reg) const
+{
+    const uint8_t * m = &Regs[mask_reg];
+    const uint8_t * f = &Regs[filt_reg];
+    uint8_t v[4];
+    uint32_t id = frame->can_id;
+
+    if (frame->can_id & CAN_EFF_FLAG)
+    {
+        if (!(f[MCP2515_SIDL] & MCP2515_RXB_IDE))
+        {
+            return false;       // filter applies to standard frames only
+        }
+        id &= CAN_EFF_MASK;
+        v[MCP2515_SIDH] = id >> 21;
+        v[MCP2515_SIDL] = (((id >> 18) & 0x07) << 5) | ((id >> 16) & 0x03);
+        v[MCP2515_EID8] = id >> 8;
+        v[MCP2515_EID0] = id;
+        return ((((v[0] ^ f[0]) & m[0]) | ((v[1] ^ f[1]) & m[1] & 0xe3) |
+                 ((v[2] ^ f[2]) & m[2]) | ((v[3] ^ f[3]) & m[3])) == 0);
+    }
+
+    if (f[MCP2515_SIDL] & MCP2515_RXB_IDE)
+    {
+        return false;           // filter applies to extended frames only
+    }
+    id &= CAN_SFF_MASK;
+    v[MCP2515_SIDH] = id >> 3;
+    v[MCP2515_SIDL] = (id & 0x07) << 5;
+    v[MCP2515_EID8] = (frame->can_dlc > 0) ? frame->can_data[0] : 0;
+    v[MCP2515_EID0] = (frame->can_dlc > 1) ? frame->can_data[1] : 0;
+    return ((((v[0] ^ f[0]) & m[0]) | ((v[1] ^ f[1]) & m[1] & 0xe0) |
+             ((v[2] ^ f[2]) & m[2]) | ((v[3] ^ f[3]) & m[3])) == 0);
+}
+
+// store frame into Rx buffer
+void MCP2515_Model::Store(uint8_t rxb, const CAN_FRAME * frame, uint8_t filhit)
+{
+    uint8_t base = rxb ? MCP2515_RXB1CTRL : MCP2515_RXB0CTRL;
+    uint32_t id = frame->can_id;
+    bool rtr = (frame->can_id & CAN_RTR_FLAG) != 0;
+    uint8_t dlc = frame->can_dlc & MCP2515_DLC_MASK;
+
+    if (id & CAN_EFF_FLAG)
+    {
+        id &= CAN_EFF_MASK;
+        Regs[base + MCP2515_BUF_SIDH] = id >> 21;
+        Regs[base + MCP2515_BUF_SIDL] = (((id >> 18) & 0x07) << 5) | MCP2515_RXB_IDE | ((id >> 16) & 0x03);
+        Regs[base + MCP2515_BUF_EID8] = id >> 8;
+        Regs[base + MCP2515_BUF_EID0] = id;
+        Regs[base + MCP2515_BUF_DLC] = dlc | (rtr ? MCP2515_RTR_MASK : 0);
+    }
+    else
+    {
+        id &= CAN_SFF_MASK;
+        Regs[base + MCP2515_BUF_SIDH] = id >> 3;
+        Regs[base + MCP2515_BUF_SIDL] = ((id & 0x07) << 5) | (rtr ? 0x10 : 0);     // SRR
+        Regs[base + MCP2515_BUF_EID8] = 0;
+        Regs[base + MCP2515_BUF_EID0] = 0;
+        Regs[base + MCP2515_BUF_DLC] = dlc;
+    }
+    memcpy(&Regs[base + MCP2515_BUF_DATA0], frame->can_data, CAN_MAX_DLEN);
+
+    if (rxb == RXB0)
+    {
+        Regs[base] = (Regs[base] & (RXM_MASK | BUKT_BIT | BUKT1_BIT)) | (rtr ? RXRTR_BIT : 0) | (filhit & FILHIT0_BIT);
+    }
+    else
+    {
+        if (filhit >= FM_RXF0_RXB1)
+        {
+            filhit -= FM_RXF0_RXB1;     // rolled over from RXB0 - FILHIT = RXF0/RXF1
+        }
+        Regs[base] = (Regs[base] & RXM_MASK) | (rtr ? RXRTR_BIT : 0) | (filhit & FILHIT_MASK);
+    }
+    Regs[MCP2515_CANINTF] |= rxb ? MCP2515_RX1IF : MCP2515_RX0IF;
+    ++FramesReceived;
+    UpdateIcod();
+}
+
+// deliver a frame from the CAN bus
+bool MCP2515_Model::Receive(const CAN_FRAME * frame)
+{
+    uint8_t mode = OpMode();
+    int8_t hit0 = -1;
+    int8_t hit1 = -1;
+
+    if ((mode != MODE_NORMAL) && (mode != MODE_LISTENONLY) && (mode != MODE_LOOPBACK))
+    {
+        return false;
+    }
+
+    if ((Regs[MCP2515_RXB0CTRL] & RXM_MASK) == RXM_M3)
+    {
+        hit0 = 0;
+    }
+    else
+    {
+        for (uint8_t i = 0; i < 2 && hit0 < 0; ++i)
+        {
+            if (Match(frame, MCP2515_RXM0SIDH, MCP2515_RXF0SIDH + 4 * i))
+            {
+                hit0 = i;
+            }
+        }
+    }
+    if ((Regs[MCP2515_RXB1CTRL] & RXM_MASK) == RXM_M3)
+    {
+        hit1 = 2;
+    }
+    else
+    {
+        static const uint8_t filt[4] = { MCP2515_RXF2SIDH, MCP2515_RXF3SIDH, MCP2515_RXF4SIDH, MCP2515_RXF5SIDH };
+        for (uint8_t i = 0; i < 4 && hit1 < 0; ++i)
+        {
+            if (Match(frame, MCP2515_RXM1SIDH, filt[i]))
+            {
+                hit1 = 2 + i;
+            }
+        }
+    }
+
+    if (hit0 >= 0)
+    {
+        if (!(Regs[MCP2515_CANINTF] & MCP2515_RX0IF))
+        {
+            Store(RXB0, frame, hit0);
+            return true;
+        }
+        if (Regs[MCP2515_RXB0CTRL] & BUKT_BIT)
+        {
+            if (!(Regs[MCP2515_CANINTF] & MCP2515_RX1IF))
+            {
+                Store(RXB1, frame, FM_RXF0_RXB1 + hit0);
+                return true;
+            }
+            Regs[MCP2515_EFLG] |= MCP2515_EFLG_RX1OVR;
+        }
+        else
+        {
+            Regs[MCP2515_EFLG] |= MCP2515_EFLG_RX0OVR;
+        }
+    }
+    else if (hit1 >= 0)
+    {
+        if (!(Regs[MCP2515_CANINTF] & MCP2515_RX1IF))
+        {
+            Store(RXB1, frame, hit1);
+            return true;
+        }
+        Regs[MCP2515_EFLG] |= MCP2515_EFLG_RX1OVR;
+    }
+    else
+    {
+        ++FramesFiltered;
+        return false;
+    }
+
+    ++FramesOverrun;
+    Regs[MCP2515_CANINTF] |= MCP2515_ERRIF;
+    UpdateIcod();
+    return false;
+}
+
+// MCP2515_Bus
+
+void MCP2515_Bus::Attach(MCP2515_Model * node)
+{
+    Nodes.push_back(node);
+    node->Bus = this;
+}
+
+bool MCP2515_Bus::Transmit(MCP2515_Model * from, const CAN_FRAME * frame)
+{
+    bool ack = AckPeer;
+
+    if (AckPeer)
+    {
+        PeerLog.push_back(*frame);
+    }
+    for (size_t i = 0; i < Nodes.size(); ++i)
+    {
+        if (Nodes[i] != from)
+        {
+            uint8_t mode = Nodes[i]->OpMode();
+            Nodes[i]->Receive(frame);
+            if (mode == MODE_NORMAL)
+            {
+                ack = true;
+            }
+        }
+    }
+    return ack;
+}
+
+void MCP2515_Bus::Inject(const CAN_FRAME * frame)
+{
+    for (size_t i = 0; i < Nodes.size(); ++i)
+    {
+        Nodes[i]->Receive(frame);
+    }
+}
+
+bool MCP2515_Model::Accepts(const CAN_FRAME * frame) const
+{
+    for (uint8_t i = 0; i < 2; ++i)
+        if (Match(frame, MCP2515_RXM0SIDH, MCP2515_RXF0SIDH + 4 * i)) return true;
+    static const uint8_t filt[4] = { MCP2515_RXF2SIDH, MCP2515_RXF3SIDH, MCP2515_RXF4SIDH, MCP2515_RXF5SIDH };
+    for (uint8_t i = 0; i < 4; ++i)
+        if (Match(frame, MCP2515_RXM1SIDH, filt[i])) return true;
+    return false;
+}
+
+void MCP2515_Model::ForceBusOff(void)
+{
+    Regs[MCP2515_TEC] = 255;
+    Regs[MCP2515_EFLG] |= MCP2515_EFLG_TXBO;
+    BusOffDue = Now + ((uint64_t)128 * 11 * BitTimeNs()) / 1000;
+    UpdateErrorFlags();
+    Regs[MCP2515_CANINTF] |= MCP2515_ERRIF;
+    UpdateIcod();
+}
+
+void MCP2515_Model::SetTec(uint8_t tec)
+{
+    Regs[MCP2515_TEC] = tec;
+    UpdateErrorFlags();
+    UpdateIcod();
+}
@@ -0,0 +1,177 @@
+/*
+ * NAME: MCP2515_Model.h
+ *
+ * WHAT:
+ *  Header file for the host-side MCP2515 register/instruction model.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Only for Linux host builds - never compiled into Arduino sketches.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __MCP2515_MODEL_H__
+#define __MCP2515_MODEL_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "can.h"
+#include "MCP2515.h"
+
+class MCP2515_Bus;
+
+/**
+ * Emulated MCP2515 device attached to the fake SPI backend.
+ */
+class MCP2515_Model
+{
+    public:
+        /**
+         *  Create an emulated MCP2515.
+         *
+         *  \param cs_pin: the chip select pin the device answers to
+         *  \param int_pin: the pin driven by the device ~INT output (0xff = not wired)
+         *  \param osc_hz: the device oscillator frequency
+         */
+        MCP2515_Model(uint8_t cs_pin, uint8_t int_pin = 0xff, uint32_t osc_hz = 8000000UL);
+        ~MCP2515_Model();
+
+        /// SPI chip select edge (true = asserted)
+        void Select(bool asserted);
+
+        /// SPI byte exchange while selected
+        uint8_t Exchange(uint8_t mosi);
+
+        /// advance device state to specified time (uS)
+        void Step(uint64_t now_us);
+
+        /// deliver a frame from the CAN bus (filters applied)
+        /// \return true if frame was stored in an Rx buffer
+        bool Receive(const CAN_FRAME * frame);
+        bool Accepts(const CAN_FRAME * frame) const;
+
+        /// state of the ~INT output
+        bool IntAsserted(void) const;
+
+        /// raw register access (no side effects)
+        uint8_t Peek(uint8_t reg) const { return Regs[reg & 0x7f]; }
+        void Poke(uint8_t reg, uint8_t val) { Regs[reg & 0x7f] = val; }
+
+        /// current operating mode (CANSTAT.OPMOD)
+        uint8_t OpMode(void) const { return Regs[MCP2515_CANSTAT] & MODE_MASK; }
+
+        /// bit time in nS derived from CNF1..3 (0 if not configured)
+        uint32_t BitTimeNs(void) const;
+
+        /// device hardware reset
+        void HardReset(void);
+
+        /// force bus-off (TEC > 255), recovering after 128 x 11 recessive bits
+        void ForceBusOff(void);
+
+        /// force TEC (error warning/passive flags follow)
+        void SetTec(uint8_t tec);
+
+        uint8_t CS_pin;
+        uint8_t INT_pin;
+        uint32_t Osc_Hz;
+
+        /// delay between CANCTRL.REQOP write and CANSTAT.OPMOD change
+        uint32_t ModeDelayUs;
+
+        /// attached CAN bus (may be null)
+        MCP2515_Bus * Bus;
+
+        /// statistics
+        uint32_t Transactions;
+        uint32_t Bytes;
+        uint32_t FramesSent;
+        uint32_t FramesReceived;
+        uint32_t FramesOverrun;
+        uint32_t FramesFiltered;
+
+    private:
+        uint8_t Regs[128];
+
+        bool Selected;
+        uint8_t Instr;
+        uint8_t Count;
+        uint8_t Addr;
+        uint8_t BitModMask;
+
+        uint64_t Now;
+        bool ModePending;
+        uint8_t ModeRequested;
+        uint64_t ModeDue;
+
+        uint8_t AbortPending;   // abort requested for Tx buffer on the wire
+        bool HoldTx;            // RTS in progress - defer Tx start
+        int8_t TxActive;        // Tx buffer currently on the wire (-1 = none)
+        uint64_t TxDue;
+        uint64_t BusOffDue;
+
+        void WriteReg(uint8_t reg, uint8_t val, bool from_mcu);
+        uint8_t ReadStatus(void) const;
+        uint8_t RxStatus(void) const;
+        void StartNextTx(void);
+        void FinishTx(void);
+        void UpdateErrorFlags(void);
+        void UpdateIcod(void);
+        bool Match(const CAN_FRAME * frame, uint8_t mask_reg, uint8_t filt_reg) const;
+        void Store(uint8_t rxb, const CAN_FRAME * frame, uint8_t filhit);
+};
+
+/**
+ * Emulated CAN bus connecting emulated MCP2515 devices (and optional acking peer).
+ */
+class MCP2515_Bus
+{
+    public:
+        MCP2515_Bus() : AckPeer(true) {}
+
+        void Attach(MCP2515_Model * node);
+
+        /// deliver frame to all other nodes
+        /// \return true if frame was acknowledged
+        bool Transmit(MCP2515_Model * from, const CAN_FRAME * frame);
+
+        /// inject frame from an external peer
+        void Inject(const CAN_FRAME * frame);
+
+        /// external peer present that acknowledges (and records) frames
+        bool AckPeer;
+
+        /// frames seen by the external peer
+        std::vector<CAN_FRAME> PeerLog;
+
+    private:
+        std::vector<MCP2515_Model *> Nodes;
+};
+
+// host environment control
+
+/// register emulated device on the fake SPI backend
+void Host_AddDevice(MCP2515_Model * dev);
+
+/// remove all emulated devices and reset virtual time/pins
+void Host_Reset(void);
+
+/// advance virtual time (uS), stepping devices and firing interrupts
+void Host_Advance(uint32_t us);
+
+/// virtual SPI clock (Hz) and per-transaction CS overhead (nS) used for time model
+void Host_SetSpiTiming(uint32_t spi_hz, uint32_t cs_overhead_ns);
+
+/// SPI transaction/byte counters and SPI busy time (nS) of the fake backend
+uint32_t Host_SpiTransactions(void);
+uint32_t Host_SpiBytes(void);
+uint64_t Host_SpiNs(void);
+void Host_ResetSpiCounters(void);
+
+/// virtual time now (nS)
+uint64_t Host_NowNs(void);
+
+#endif  // __MCP2515_MODEL_H__
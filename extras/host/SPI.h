@@ -0,0 +1,54 @@
+/*
+ * NAME: SPI.h
+ *
+ * WHAT:
+ *  Arduino SPI library stand-in for Linux host builds of the DLK_MCP2515 library.
+ *  The SPI bytes are exchanged with the emulated MCP2515 devices (see Host.cpp).
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Only for Linux host builds - never compiled into Arduino sketches.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __HOST_SPI_H__
+#define __HOST_SPI_H__
+
+#include "Arduino.h"
+
+#define SPI_MODE0   0
+#define SPI_MODE3   3
+
+/**
+ * SPI transaction settings (only the SPI clock is used by the time model).
+ */
+class SPISettings
+{
+    public:
+        SPISettings() : clock(4000000) {}
+        SPISettings(uint32_t c, uint8_t, uint8_t) : clock(c) {}
+
+        uint32_t clock;
+};
+
+/**
+ * SPI port - every SPI port is connected to all emulated MCP2515 devices
+ * (the CS pin selects the device).
+ */
+class SPIClass
+{
+    public:
+        void begin(void) {}
+        void beginTransaction(SPISettings s);
+        void endTransaction(void);
+        uint8_t transfer(uint8_t b);
+        void transfer(void * buf, size_t cnt);
+        void usingInterrupt(int) {}
+        void notUsingInterrupt(int) {}
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
+
+#endif  // __HOST_SPI_H__
@@ -0,0 +1,533 @@
+/*
+ * NAME: host_bench.cpp
+ *
+ * WHAT:
+ *  Linux host SPI cost benchmark of the DLK_MCP2515 library against an emulated
+ *  MCP2515: SPI transactions, bytes, modelled SPI time and (virtual) wall time per
+ *  call of the main public functions and per CAN frame handled by the interrupt
+ *  handler and DLK_SpiBus service pass (MCP2515 polled with READ STATUS), and the
+ *  resulting max sustainable Rx/Tx frames per second at each CAN bus speed.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Usage:
+ *      host_bench [-c spi_hz] [-o cs_ns] [-b budget_file [-u]]
+ *          -c  SPI clock (default 4000000 - MCP2515 max is 10000000)
+ *          -o  SPI transaction overhead (CS toggling, driver code) in nS (default 1000)
+ *          -b  check the SPI transactions/bytes per call against the budget file
+ *              (exit 1 if any operation is over its budget)
+ *          -u  with -b, write the measured values as the new budgets instead
+ *
+ *  Only the SPI time is modelled (no MCU time other than -o), so the frames per
+ *  second are upper limits: compare them for a board by using its SPI clock and a
+ *  measured -o (e.g. about 5000 for an AVR with digitalWrite() CS toggling).
+ *
+ *  The transactions/bytes of MCP2515_Send/MCP2515_Xsend/MCP2515_SetFilter include
+ *  the polling while waiting for the CAN frame/mode change, so they depend on the
+ *  SPI clock: budgets are only checked at the SPI clock they were written for.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+
+#include <stdlib.h>
+
+#include "DLK_MCP2515.h"
+#include "DLK_SpiBus.h"
+#include "MCP2515_Model.h"
+
+#define BENCH_CS            10
+#define BENCH_INT           2
+#define BENCH_CALLS         100     // calls per operation measured
+#define BENCH_SEND_CALLS    10      // blocking sends per CAN bus speed
+#define BENCH_SPEED         CAN_500KBPS
+#define BENCH_FRAME_BITS    111     // 8 byte standard CAN data frame + interframe space (no stuff bits)
+
+// benchmarked operations
+enum
+{
+    OP_INIT,
+    OP_SETFILTER,
+    OP_SEND,
+    OP_XSEND,
+    OP_RECV,
+    OP_ISR_RX,
+    OP_ISR_TX,
+    OP_BUS_IDLE,
+    OP_BUS_RX,
+    OP_CNT
+};
+
+static const char * const OpNames[OP_CNT] =
+{
+    "MCP2515_Init",
+    "MCP2515_SetFilter",
+    "MCP2515_Send",
+    "MCP2515_Xsend",
+    "MCP2515_Recv",
+    "ISR_Rx_frame",
+    "ISR_Tx_frame",
+    "SpiBus_idle_pass",
+    "SpiBus_Rx_frame",
+};
+
+// measured cost of an operation (totals over all calls)
+typedef struct
+{
+    uint32_t calls;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint64_t spi_ns;
+    uint64_t wall_ns;
+} BENCH_RESULT;
+
+// CAN bus speed names (CAN_5KBPS to CAN_1000KBPS)
+static const char * const SpeedNames[CAN_1000KBPS] =
+{
+    "5K", "10K", "20K", "31K25", "33K", "40K", "50K", "80K",
+    "83K3", "95K", "100K", "125K", "200K", "250K", "500K", "1000K"
+};
+
+static BENCH_RESULT Results[OP_CNT];
+static uint64_t StartNs;
+static uint32_t RxFrames;
+
+static MCP2515_Model Dev(BENCH_CS, BENCH_INT);
+static MCP2515_Bus Bus;
+
+// Rx interrupt callback
+static void Rx_Handler(CAN_FRAME * frame)
+{
+    (void)frame;
+    RxFrames++;
+}
+
+static void BenchStart(void)
+{
+    Host_ResetSpiCounters();
+    StartNs = Host_NowNs();
+}
+
+static void BenchEnd(uint8_t op, uint32_t calls)
+{
+    Results[op].calls = calls;
+    Results[op].transactions = Host_SpiTransactions();
+    Results[op].bytes = Host_SpiBytes();
+    Results[op].spi_ns = Host_SpiNs();
+    Results[op].wall_ns = Host_NowNs() - StartNs;
+}
+
+static void Fail(const char * what)
+{
+    printf("FAILED: %s\n", what);
+    exit(2);
+}
+
+// per call value x 10 (rounded up)
+static uint32_t PerCall10(uint64_t total, uint32_t calls)
+{
+    return (uint32_t)((total * 10 + calls - 1) / calls);
+}
+
+static void RunBenchmarks(DLK_MCP2515 & can)
+{
+    uint8_t data[8] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 };
+    CAN_FRAME frame;
+    CAN_FRAME rx;
+    size_t sent;
+    uint32_t i;
+
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        if (can.MCP2515_Init(BENCH_SPEED) != MCP2515_OK)
+        {
+            Fail("MCP2515_Init");
+        }
+    }
+    BenchEnd(OP_INIT, BENCH_CALLS);
+
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        can.MCP2515_SetFilter(i % MCP2515_N_FILTERS, 0x100 + i, 0, 0);
+    }
+    BenchEnd(OP_SETFILTER, BENCH_CALLS);
+    can.MCP2515_Init(BENCH_SPEED);      // accept all CAN frames again
+
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        if (can.MCP2515_Send(0x100 + i, sizeof(data), data) != MCP2515_OK)
+        {
+            Fail("MCP2515_Send");
+        }
+    }
+    BenchEnd(OP_SEND, BENCH_CALLS);
+
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        if (can.MCP2515_Xsend(0x1000000 + i, sizeof(data), data) != MCP2515_OK)
+        {
+            Fail("MCP2515_Xsend");
+        }
+    }
+    BenchEnd(OP_XSEND, BENCH_CALLS);
+
+    frame.can_id = 0x6A5;
+    frame.can_dlc = sizeof(data);
+    memcpy(frame.can_data, data, sizeof(data));
+
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        Bus.Inject(&frame);
+        if (can.MCP2515_Recv(&rx) != MCP2515_OK)
+        {
+            Fail("MCP2515_Recv");
+        }
+    }
+    BenchEnd(OP_RECV, BENCH_CALLS);
+
+    if (can.MCP2515_OnRxInterrupt(BENCH_INT, Rx_Handler) != MCP2515_OK)
+    {
+        Fail("MCP2515_OnRxInterrupt");
+    }
+
+    // one CAN frame per interrupt
+    RxFrames = 0;
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        Bus.Inject(&frame);
+        Host_Advance(10);
+    }
+    BenchEnd(OP_ISR_RX, BENCH_CALLS);
+    if (RxFrames != BENCH_CALLS)
+    {
+        Fail("Rx interrupt");
+    }
+
+    // Tx queue kept full, Tx buffers refilled from the Tx interrupt
+    sent = Bus.PeerLog.size();
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; )
+    {
+        frame.can_id = 0x100 + i;
+        if (can.MCP2515_SendAsync(&frame) == MCP2515_OK)
+        {
+            ++i;
+        }
+        else
+        {
+            Host_Advance(10);
+        }
+    }
+    while (can.MCP2515_TxPending() > 0)
+    {
+        Host_Advance(10);
+    }
+    BenchEnd(OP_ISR_TX, BENCH_CALLS);
+    if (Bus.PeerLog.size() - sent != BENCH_CALLS)
+    {
+        Fail("Tx interrupt");
+    }
+
+    can.MCP2515_DetachInterrupt();
+
+    // DLK_SpiBus polling the MCP2515 with READ STATUS
+    DLK_SpiBus spi_bus;
+
+    if (spi_bus.Attach(&can, Rx_Handler) != MCP2515_OK)
+    {
+        Fail("DLK_SpiBus::Attach");
+    }
+    spi_bus.Service();
+
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        spi_bus.Service();
+    }
+    BenchEnd(OP_BUS_IDLE, BENCH_CALLS);
+
+    RxFrames = 0;
+    BenchStart();
+    for (i = 0; i < BENCH_CALLS; ++i)
+    {
+        Bus.Inject(&frame);
+        spi_bus.Service();
+    }
+    BenchEnd(OP_BUS_RX, BENCH_CALLS);
+    if (RxFrames != BENCH_CALLS)
+    {
+        Fail("DLK_SpiBus Rx");
+    }
+
+    spi_bus.Detach(&can);
+}
+
+static void PrintResults(uint32_t spi_hz)
+{
+    printf("SPI cost per call (SPI clock %u Hz, CAN bus %s bps)\n\n", spi_hz, SpeedNames[BENCH_SPEED - 1]);
+    printf("%-20s %12s %8s %10s %10s\n", "operation", "transactions", "bytes", "SPI uS", "wall uS");
+    for (uint8_t op = 0; op < OP_CNT; ++op)
+    {
+        const BENCH_RESULT * r = &Results[op];
+
+        printf("%-20s %10u.%u %6u.%u %10.1f %10.1f\n", OpNames[op],
+               PerCall10(r->transactions, r->calls) / 10, PerCall10(r->transactions, r->calls) % 10,
+               PerCall10(r->bytes, r->calls) / 10, PerCall10(r->bytes, r->calls) % 10,
+               r->spi_ns / 1000.0 / r->calls, r->wall_ns / 1000.0 / r->calls);
+    }
+}
+
+// max frames per second for each CAN bus speed
+static void PrintThroughput(DLK_MCP2515 & can)
+{
+    uint8_t data[8] = { 0 };
+    MCP2515_BITTIMING bt;
+    double rx_fps = 1e9 * Results[OP_ISR_RX].calls / Results[OP_ISR_RX].spi_ns;
+    double tx_fps = 1e9 * Results[OP_ISR_TX].calls / Results[OP_ISR_TX].spi_ns;
+
+    printf("\nMax frames/second (8 byte standard CAN data frames)\n");
+    printf("  bus     = fully loaded CAN bus\n");
+    printf("  Send    = blocking MCP2515_Send() (measured)\n");
+    printf("  ISR Rx  = Rx interrupt handler SPI time limit (%.0f)\n", rx_fps);
+    printf("  ISR Tx  = MCP2515_SendAsync() + Tx interrupt SPI time limit (%.0f)\n\n", tx_fps);
+    printf("%-8s %10s %10s %10s %10s\n", "CAN bps", "bus", "Send", "ISR Rx", "ISR Tx");
+
+    for (uint8_t speed = CAN_5KBPS; speed <= CAN_1000KBPS; ++speed)
+    {
+        uint64_t t0;
+        double bus_fps;
+        double send_fps;
+
+        if ((can.MCP2515_GetBitTiming(speed, &bt) != MCP2515_OK) || (can.MCP2515_Init(speed) != MCP2515_OK))
+        {
+            printf("%-8s (not supported)\n", SpeedNames[speed - 1]);
+            continue;
+        }
+        bus_fps = (double)bt.bitrate / BENCH_FRAME_BITS;
+
+        t0 = Host_NowNs();
+        for (uint8_t i = 0; i < BENCH_SEND_CALLS; ++i)
+        {
+            if (can.MCP2515_Send(0x100 + i, sizeof(data), data) != MCP2515_OK)
+            {
+                Fail("MCP2515_Send");
+            }
+        }
+        send_fps = 1e9 * BENCH_SEND_CALLS / (Host_NowNs() - t0);
+
+        printf("%-8s %10.0f %10.0f %10s %10s\n", SpeedNames[speed - 1], bus_fps, send_fps,
+               (rx_fps >= bus_fps) ? "ok" : "TOO SLOW", (tx_fps >= bus_fps) ? "ok" : "TOO SLOW");
+    }
+}
+
+// get SPI clock of budget file (0 = none)
+static uint32_t BudgetSpiHz(const char * fname)
+{
+    char line[128];
+    uint32_t budget_hz = 0;
+    FILE * fp = fopen(fname, "r");
+
+    if (fp != NULL)
+    {
+        while (fgets(line, sizeof(line), fp) != NULL)
+        {
+            if (sscanf(line, "spi_hz %u", &budget_hz) == 1)
+            {
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    return budget_hz;
+}
+
+// check (or update) budget file:
+//  "spi_hz <Hz>" line, then "<operation> <transactions> <bytes>" lines (per call)
+//  '#' starts a comment
+static int CheckBudgets(const char * fname, uint32_t spi_hz, bool update)
+{
+    char line[128];
+    char name[64];
+    double trans;
+    double bytes;
+    bool checked[OP_CNT] = { false };
+    int over = 0;
+    FILE * fp;
+
+    if (update)
+    {
+        fp = fopen(fname, "w");
+        if (fp == NULL)
+        {
+            printf("can't write %s\n", fname);
+            return 2;
+        }
+        fprintf(fp, "# DLK_MCP2515 SPI cost budgets per call (written by host_bench -u)\n");
+        fprintf(fp, "# operation          transactions    bytes\n");
+        fprintf(fp, "spi_hz %u\n", spi_hz);
+        for (uint8_t op = 0; op < OP_CNT; ++op)
+        {
+            fprintf(fp, "%-20s %10u.%u %6u.%u\n", OpNames[op],
+                    PerCall10(Results[op].transactions, Results[op].calls) / 10,
+                    PerCall10(Results[op].transactions, Results[op].calls) % 10,
+                    PerCall10(Results[op].bytes, Results[op].calls) / 10,
+                    PerCall10(Results[op].bytes, Results[op].calls) % 10);
+        }
+        fclose(fp);
+        printf("\nbudgets written to %s\n", fname);
+        return 0;
+    }
+
+    fp = fopen(fname, "r");
+    if (fp == NULL)
+    {
+        printf("can't read %s\n", fname);
+        return 2;
+    }
+    printf("\nBudget check (%s)\n", fname);
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if ((line[0] == '#') || (sscanf(line, "%63s", name) != 1))
+        {
+            continue;
+        }
+        if (strcmp(name, "spi_hz") == 0)
+        {
+            continue;
+        }
+        if (sscanf(line, "%*s %lf %lf", &trans, &bytes) != 2)
+        {
+            printf("bad budget line: %s", line);
+            over++;
+            continue;
+        }
+
+        uint8_t op;
+        for (op = 0; op < OP_CNT; ++op)
+        {
+            if (strcmp(name, OpNames[op]) == 0)
+            {
+                break;
+            }
+        }
+        if (op == OP_CNT)
+        {
+            printf("unknown operation in budgets: %s\n", name);
+            over++;
+            continue;
+        }
+
+        checked[op] = true;
+
+        double got_trans = PerCall10(Results[op].transactions, Results[op].calls) / 10.0;
+        double got_bytes = PerCall10(Results[op].bytes, Results[op].calls) / 10.0;
+        bool ok = (got_trans <= trans + 0.05) && (got_bytes <= bytes + 0.05);
+
+        printf("%-20s %8.1f/%-8.1f %8.1f/%-8.1f %s\n", name, got_trans, trans, got_bytes, bytes,
+               ok ? "ok" : "OVER BUDGET");
+        if (!ok)
+        {
+            over++;
+        }
+    }
+    fclose(fp);
+
+    for (uint8_t op = 0; op < OP_CNT; ++op)
+    {
+        if (!checked[op])
+        {
+            printf("%-20s no budget\n", OpNames[op]);
+            over++;
+        }
+    }
+
+    if (over > 0)
+    {
+        printf("%d operation(s) over budget\n", over);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    uint32_t spi_hz = 4000000;
+    uint32_t cs_ns = 1000;
+    bool spi_hz_set = false;
+    bool update = false;
+    const char * budgets = NULL;
+    int opt;
+
+    for (opt = 1; opt < argc; ++opt)
+    {
+        if ((strcmp(argv[opt], "-c") == 0) && (opt + 1 < argc))
+        {
+            spi_hz = strtoul(argv[++opt], NULL, 0);
+            spi_hz_set = true;
+        }
+        else if ((strcmp(argv[opt], "-o") == 0) && (opt + 1 < argc))
+        {
+            cs_ns = strtoul(argv[++opt], NULL, 0);
+        }
+        else if ((strcmp(argv[opt], "-b") == 0) && (opt + 1 < argc))
+        {
+            budgets = argv[++opt];
+        }
+        else if (strcmp(argv[opt], "-u") == 0)
+        {
+            update = true;
+        }
+        else
+        {
+            printf("usage: %s [-c spi_hz] [-o cs_ns] [-b budget_file [-u]]\n", argv[0]);
+            return 2;
+        }
+    }
+    if ((budgets != NULL) && !update)
+    {
+        uint32_t budget_hz = BudgetSpiHz(budgets);
+
+        if (budget_hz == 0)
+        {
+            printf("no spi_hz in %s\n", budgets);
+            return 2;
+        }
+        if (!spi_hz_set)
+        {
+            spi_hz = budget_hz;         // run at SPI clock of budgets
+        }
+        else if (spi_hz != budget_hz)
+        {
+            printf("budgets are for SPI clock %u Hz (not checked)\n\n", budget_hz);
+            budgets = NULL;
+        }
+    }
+    if (spi_hz == 0)
+    {
+        printf("bad SPI clock\n");
+        return 2;
+    }
+
+    Host_Reset();
+    Host_SetSpiTiming(spi_hz, cs_ns);
+    Bus.Attach(&Dev);
+    Host_AddDevice(&Dev);
+
+    DLK_MCP2515 can(spi_hz, BENCH_CS);
+
+    RunBenchmarks(can);
+    PrintResults(spi_hz);
+    PrintThroughput(can);
+
+    if (budgets != NULL)
+    {
+        return CheckBudgets(budgets, spi_hz, update);
+    }
+    return 0;
+}
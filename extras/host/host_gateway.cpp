@@ -0,0 +1,266 @@
+/*
+ * NAME: host_gateway.cpp
+ *
+ * WHAT:
+ *  Linux host test of DLK_CanGateway against emulated MCP2515s on two emulated
+ *  CAN buses:
+ *   1) 500 Kbps both sides, CAN bus A at about 90% load and CAN bus B at about 45%
+ *      load - every CAN frame forwarded both ways, in order
+ *   2) destination MCP2515 bus-off - CAN frames counted as failed, no stall
+ *   3) 500 Kbps to 125 Kbps - the slower destination drops CAN frames when the
+ *      gateway queue is full, counted as dropped
+ *   4) immediate mode Int pins, destination CAN frame never acknowledged - times out
+ *      as failed (TX_TIMEOUT_MS), then forwarding resumes
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Exits with 0 if all checks pass.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+
+#include <string.h>
+
+#include "DLK_CanGateway.h"
+#include "MCP2515_Model.h"
+#include "HostCheck.h"
+
+#define CAN_A_CS        10
+#define CAN_A_INT       2
+#define CAN_B_CS        9
+#define CAN_B_INT       3
+
+#define LOAD_FRAMES     2000    // CAN frames sent on CAN bus A (half as many on CAN bus B)
+#define LOAD_A_US       300     // CAN frame period on CAN bus A (8 data bytes, ~90% at 500 Kbps)
+#define LOAD_B_US       600     // CAN frame period on CAN bus B
+#define SLOW_FRAMES     100     // CAN frames sent to the 125 Kbps destination
+
+// let the gateway run for 'passes' service passes 'us' apart
+static void Run(DLK_CanGateway * gw, uint32_t passes, uint32_t us)
+{
+    for (uint32_t i = 0; i < passes; ++i)
+    {
+        gw->Service();
+        Host_Advance(us);
+    }
+}
+
+// 500 Kbps to 500 Kbps under load, then destination bus-off
+static void TestLoad(void)
+{
+    MCP2515_Model dev_a(CAN_A_CS, CAN_A_INT);
+    MCP2515_Model dev_b(CAN_B_CS, CAN_B_INT);
+    MCP2515_Bus bus_a;
+    MCP2515_Bus bus_b;
+    CAN_GW_STATS a_to_b;
+    CAN_GW_STATS b_to_a;
+    CAN_FRAME frame;
+    uint32_t next_a;
+    uint32_t next_b;
+    uint32_t cnt_a = 0;
+    uint32_t cnt_b = 0;
+    uint32_t val;
+
+    Host_Reset();
+    Host_SetSpiTiming(8000000, 2000);
+    bus_a.Attach(&dev_a);
+    bus_b.Attach(&dev_b);
+    Host_AddDevice(&dev_a);
+    Host_AddDevice(&dev_b);
+
+    DLK_MCP2515 can_a(8000000, CAN_A_CS);
+    DLK_MCP2515 can_b(8000000, CAN_B_CS);
+
+    CHECK(can_a.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_b.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_a.MCP2515_OnRxInterrupt(CAN_A_INT, nullptr) == MCP2515_OK);
+    CHECK(can_b.MCP2515_OnRxInterrupt(CAN_B_INT, nullptr, true) == MCP2515_OK);
+
+    DLK_CanGateway gw(&can_a, &can_b);
+
+    frame.can_dlc = 8;
+    memset(frame.can_data, 0, sizeof(frame.can_data));
+    next_a = next_b = micros();
+    while ((cnt_a < LOAD_FRAMES) || (cnt_b < (LOAD_FRAMES / 2)))
+    {
+        if ((cnt_a < LOAD_FRAMES) && ((int32_t)(micros() - next_a) >= 0))
+        {
+            frame.can_id = 0x100 + (cnt_a & 0xff);
+            memcpy(frame.can_data, &cnt_a, sizeof(cnt_a));
+            bus_a.Inject(&frame);
+            cnt_a++;
+            next_a += LOAD_A_US;
+        }
+        if ((cnt_b < (LOAD_FRAMES / 2)) && ((int32_t)(micros() - next_b) >= 0))
+        {
+            frame.can_id = 0x200 + (cnt_b & 0xff);
+            memcpy(frame.can_data, &cnt_b, sizeof(cnt_b));
+            bus_b.Inject(&frame);
+            cnt_b++;
+            next_b += LOAD_B_US;
+        }
+        gw.Service();
+        Host_Advance(20);
+    }
+    Run(&gw, 2000, 50);
+
+    gw.GetStats(GW_A_TO_B, &a_to_b);
+    gw.GetStats(GW_B_TO_A, &b_to_a);
+    printf("load:    A->B forwarded %u dropped %u failed %u latency max %u uS, queue hwm %u\n",
+           a_to_b.forwarded, a_to_b.dropped, a_to_b.failed, a_to_b.latency_max_us, a_to_b.queue_hwm);
+    printf("         B->A forwarded %u dropped %u failed %u latency max %u uS, queue hwm %u\n",
+           b_to_a.forwarded, b_to_a.dropped, b_to_a.failed, b_to_a.latency_max_us, b_to_a.queue_hwm);
+    CHECK((a_to_b.forwarded == LOAD_FRAMES) && (a_to_b.dropped == 0) && (a_to_b.failed == 0));
+    CHECK((b_to_a.forwarded == (LOAD_FRAMES / 2)) && (b_to_a.dropped == 0) && (b_to_a.failed == 0));
+    CHECK((can_a.MCP2515_RxOverflows() == 0) && (can_b.MCP2515_RxOverflows() == 0));
+    CHECK(bus_b.PeerLog.size() == LOAD_FRAMES);
+    CHECK(bus_a.PeerLog.size() == (LOAD_FRAMES / 2));
+
+    // each CAN ID forwarded in order (and all CAN frames in order, single source)
+    for (uint32_t i = 0; i < LOAD_FRAMES; ++i)
+    {
+        memcpy(&val, bus_b.PeerLog[i].can_data, sizeof(val));
+        CHECK((val == i) && (bus_b.PeerLog[i].can_id == (0x100 + (i & 0xff))));
+    }
+    for (uint32_t i = 0; i < (LOAD_FRAMES / 2); ++i)
+    {
+        memcpy(&val, bus_a.PeerLog[i].can_data, sizeof(val));
+        CHECK((val == i) && (bus_a.PeerLog[i].can_id == (0x200 + (i & 0xff))));
+    }
+
+    // bus-off destination - CAN frames fail instead of stalling the gateway queue
+    dev_b.ForceBusOff();
+    frame.can_id = 0x300;
+    for (uint8_t i = 0; i < 10; ++i)
+    {
+        bus_a.Inject(&frame);
+        Run(&gw, 20, 50);
+    }
+    gw.GetStats(GW_A_TO_B, &a_to_b);
+    printf("bus-off: A->B forwarded %u failed %u pending %u\n",
+           a_to_b.forwarded, a_to_b.failed, gw.Pending(GW_A_TO_B));
+    CHECK((a_to_b.failed > 0) && ((a_to_b.forwarded + a_to_b.failed) == (LOAD_FRAMES + 10)));
+    CHECK(gw.Pending(GW_A_TO_B) == 0);
+}
+
+// 500 Kbps to 125 Kbps - the slower destination drops CAN frames
+static void TestSlowDest(void)
+{
+    MCP2515_Model dev_a(CAN_A_CS, CAN_A_INT);
+    MCP2515_Model dev_b(CAN_B_CS, CAN_B_INT);
+    MCP2515_Bus bus_a;
+    MCP2515_Bus bus_b;
+    CAN_GW_STATS stats;
+    CAN_FRAME frame;
+
+    Host_Reset();
+    bus_a.Attach(&dev_a);
+    bus_b.Attach(&dev_b);
+    Host_AddDevice(&dev_a);
+    Host_AddDevice(&dev_b);
+
+    DLK_MCP2515 can_a(8000000, CAN_A_CS);
+    DLK_MCP2515 can_b(8000000, CAN_B_CS);
+
+    CHECK(can_a.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_b.MCP2515_Init(CAN_125KBPS) == MCP2515_OK);
+    CHECK(can_a.MCP2515_OnRxInterrupt(CAN_A_INT, nullptr) == MCP2515_OK);
+    CHECK(can_b.MCP2515_OnRxInterrupt(CAN_B_INT, nullptr) == MCP2515_OK);
+
+    DLK_CanGateway gw(&can_a, &can_b);
+
+    frame.can_id = 0x123;
+    frame.can_dlc = 8;
+    memset(frame.can_data, 0, sizeof(frame.can_data));
+    for (uint8_t i = 0; i < SLOW_FRAMES; ++i)
+    {
+        frame.can_data[0] = i;
+        bus_a.Inject(&frame);
+        Run(&gw, 6, 50);
+    }
+    Run(&gw, 4000, 50);
+
+    gw.GetStats(GW_A_TO_B, &stats);
+    printf("125K:    A->B forwarded %u dropped %u failed %u latency max %u uS, queue hwm %u\n",
+           stats.forwarded, stats.dropped, stats.failed, stats.latency_max_us, stats.queue_hwm);
+    CHECK((stats.dropped > 0) && (stats.failed == 0) && ((stats.forwarded + stats.dropped) == SLOW_FRAMES));
+    CHECK(stats.queue_hwm == GW_QUEUE_CNT);
+    CHECK(bus_b.PeerLog.size() == stats.forwarded);
+
+    // CAN frames forwarded keep their order
+    for (size_t i = 1; i < bus_b.PeerLog.size(); ++i)
+    {
+        CHECK(bus_b.PeerLog[i].can_data[0] > bus_b.PeerLog[i - 1].can_data[0]);
+    }
+
+    gw.ResetStats();
+    gw.GetStats(GW_A_TO_B, &stats);
+    CHECK((stats.forwarded == 0) && (stats.dropped == 0) && (stats.queue_hwm == 0));
+}
+
+// immediate mode Int pins, destination CAN bus without an acknowledging node
+static void TestNoAck(void)
+{
+    MCP2515_Model dev_a(CAN_A_CS, CAN_A_INT);
+    MCP2515_Model dev_b(CAN_B_CS, CAN_B_INT);
+    MCP2515_Bus bus_a;
+    MCP2515_Bus bus_b;
+    MCP2515_STATS can_stats;
+    CAN_GW_STATS stats;
+    CAN_FRAME frame;
+
+    Host_Reset();
+    bus_a.Attach(&dev_a);
+    bus_b.Attach(&dev_b);
+    bus_b.AckPeer = false;
+    Host_AddDevice(&dev_a);
+    Host_AddDevice(&dev_b);
+
+    DLK_MCP2515 can_a(8000000, CAN_A_CS);
+    DLK_MCP2515 can_b(8000000, CAN_B_CS);
+
+    CHECK(can_a.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_b.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_a.MCP2515_OnRxInterrupt(CAN_A_INT, nullptr) == MCP2515_OK);
+    CHECK(can_b.MCP2515_OnRxInterrupt(CAN_B_INT, nullptr) == MCP2515_OK);
+
+    DLK_CanGateway gw(&can_a, &can_b);
+
+    frame.can_id = 0x123;
+    frame.can_dlc = 8;
+    memset(frame.can_data, 0, sizeof(frame.can_data));
+    bus_a.Inject(&frame);
+    Run(&gw, 20, 50);
+    CHECK(can_b.MCP2515_TxPending() == 1);
+
+    // unacknowledged CAN frame aborted after TX_TIMEOUT_MS
+    Run(&gw, ((TX_TIMEOUT_MS + 50) * 1000UL) / 500, 500);
+    CHECK(can_b.MCP2515_GetStats(&can_stats) == MCP2515_OK);
+    printf("no ack:  Tx pending %u timeouts %u failures %u\n",
+           can_b.MCP2515_TxPending(), can_stats.tx_timeouts, can_stats.tx_failures);
+    CHECK((can_b.MCP2515_TxPending() == 0) && (can_stats.tx_timeouts == 1) && (can_stats.tx_failures == 1));
+    CHECK(gw.Pending(GW_A_TO_B) == 0);
+
+    // acknowledging node back - forwarding resumes
+    bus_b.AckPeer = true;
+    for (uint8_t i = 0; i < 5; ++i)
+    {
+        frame.can_data[0] = i;
+        bus_a.Inject(&frame);
+        Run(&gw, 20, 50);
+    }
+    Run(&gw, 200, 50);
+    gw.GetStats(GW_A_TO_B, &stats);
+    CHECK((stats.forwarded == 6) && (stats.dropped == 0) && (bus_b.PeerLog.size() == 5));
+    CHECK((can_b.MCP2515_TxPending() == 0) && (gw.Pending(GW_A_TO_B) == 0));
+}
+
+int main(void)
+{
+    TestLoad();
+    TestSlowDest();
+    TestNoAck();
+    printf("ok\n");
+    return 0;
+}
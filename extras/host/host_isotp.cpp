@@ -0,0 +1,427 @@
+/*
+ * NAME: host_isotp.cpp
+ *
+ * WHAT:
+ *  Linux host test of DLK_IsoTp between two emulated MCP2515s (ECU and tester) on
+ *  one emulated CAN bus, and against Flow Control/CAN frames injected by an external
+ *  peer:
+ *   1) two concurrent sessions - 300 and 100 byte requests reassembled by the ECU,
+ *      replied to from its receive callback and reassembled by the tester, with the
+ *      Flow Control (Block Size and Separation Time) of the receivers obeyed
+ *   2) sending - Single Frame, no Flow Control timeout, Flow Control WAIT (up to
+ *      ISOTP_MAX_WFT), Block Size and Separation Time of the peer, Flow Control overflow
+ *   3) receiving - First Frame longer than ISOTP_BUF_SIZE refused (Flow Control
+ *      overflow), Consecutive Frames reassembled, wrong sequence number and missing
+ *      Consecutive Frames (timeout) dropped
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Exits with 0 if all checks pass.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+
+#include <string.h>
+#include <vector>
+
+// Flow Control sent when receiving: blocks of 3 Consecutive Frames, 2 mS apart
+#ifndef ISOTP_BS
+#define ISOTP_BS        3
+#endif
+#ifndef ISOTP_STMIN
+#define ISOTP_STMIN     2           // mS (0x00-0x7F only)
+#endif
+
+#include "DLK_IsoTp.h"
+#include "MCP2515_Model.h"
+#include "HostCheck.h"
+
+#define ECU_CS          10
+#define ECU_INT         2
+#define TESTER_CS       9
+#define TESTER_INT      3
+
+#define ECU_RX_ID       0x7E0       // tester session 0 request CAN ID (+ session)
+#define ECU_TX_ID       0x7E8       // ECU session 0 response CAN ID (+ session)
+#define PEER_RX_ID      0x555       // external peer CAN IDs (tester session 2)
+#define PEER_TX_ID      0x556
+
+#define PEER_SESSION    2
+#define N_SESSIONS      3
+
+#define PASS_US         20          // time between service passes
+#define BLOCK_CFS       ((ISOTP_BS == 0) ? 0xFFFF : ISOTP_BS)   // Consecutive Frames per block
+#define GAP_SLACK_US    300         // CAN frame waiting for another one (8 data bytes at 500 Kbps)
+
+static DLK_MCP2515 * CanEcu;
+static DLK_MCP2515 * CanTester;
+static DLK_IsoTp * Ecu;
+static DLK_IsoTp * Tester;
+static MCP2515_Bus * Bus;
+
+static std::vector<uint8_t> EcuRx[N_SESSIONS];      // last message received by ECU
+static std::vector<uint8_t> TesterRx[N_SESSIONS];   // last message received by tester
+static uint8_t TesterDone[N_SESSIONS];              // tester messages sent (or failed)
+static uint8_t TesterResult[N_SESSIONS];            // tester last send result
+static uint8_t EcuDone;                             // ECU messages sent (or failed)
+static uint32_t Other;                              // CAN frames of no session
+static std::vector<uint32_t> LogUs;                 // time each CAN frame of bus log seen (uS)
+
+// ECU message received - reply with the message inverted
+static void EcuReceive(uint8_t session, uint8_t * msg, uint16_t len)
+{
+    std::vector<uint8_t> reply(msg, msg + len);
+
+    EcuRx[session].assign(msg, msg + len);
+    for (uint16_t i = 0; i < len; ++i)
+    {
+        reply[i] ^= 0xFF;
+    }
+    CHECK(Ecu->Send(session, reply.data(), len) == ISOTP_OK);
+}
+
+// ECU message sent
+static void EcuSendDone(uint8_t session, uint8_t result)
+{
+    CHECK(result == ISOTP_OK);
+    EcuDone++;
+}
+
+// tester message received
+static void TesterReceive(uint8_t session, uint8_t * msg, uint16_t len)
+{
+    TesterRx[session].assign(msg, msg + len);
+}
+
+// tester message sent (or failed)
+static void TesterSendDone(uint8_t session, uint8_t result)
+{
+    TesterDone[session]++;
+    TesterResult[session] = result;
+}
+
+// run 'passes' service passes PASS_US apart, timestamping the CAN frames on the CAN bus
+static void Pump(uint32_t passes)
+{
+    CAN_FRAME frame;
+
+    for (uint32_t i = 0; i < passes; ++i)
+    {
+        CanEcu->MCP2515_Service();
+        CanTester->MCP2515_Service();
+        Ecu->Service();
+        Tester->Service();
+        while (CanEcu->MCP2515_Pop(&frame) == MCP2515_OK)
+        {
+            if (!Ecu->Input(&frame))
+            {
+                Other++;
+            }
+        }
+        while (CanTester->MCP2515_Pop(&frame) == MCP2515_OK)
+        {
+            if (!Tester->Input(&frame))
+            {
+                Other++;
+            }
+        }
+        Host_Advance(PASS_US);
+        while (LogUs.size() < Bus->PeerLog.size())
+        {
+            LogUs.push_back(micros());
+        }
+    }
+}
+
+// inject CAN frame from the external peer and run 'passes' service passes
+static void Inject(uint32_t can_id, const uint8_t * data, uint8_t len, uint32_t passes)
+{
+    CAN_FRAME frame;
+
+    frame.can_id = can_id;
+    frame.can_dlc = 8;
+    memset(frame.can_data, ISOTP_PADDING, sizeof(frame.can_data));
+    memcpy(frame.can_data, data, len);
+    Bus->Inject(&frame);
+    Pump(passes);
+}
+
+// number of Consecutive Frames of message of length 'len'
+static uint16_t CfCount(uint16_t len)
+{
+    return (len - 6 + 6) / 7;
+}
+
+// check Flow Control and Consecutive Frames on the CAN bus log (from 'start') of message
+// of length 'len' sent on CAN ID 'tx_id' and received on CAN ID 'rx_id'
+static void CheckFlow(size_t start, uint32_t tx_id, uint32_t rx_id, uint16_t len)
+{
+    uint16_t cfs = 0;
+    uint16_t fcs = 0;
+    uint16_t in_block = 0;
+    uint32_t last_us = 0;
+    uint32_t min_gap = 0xFFFFFFFF;
+    uint8_t seq = 1;
+
+    for (size_t i = start; i < Bus->PeerLog.size(); ++i)
+    {
+        const CAN_FRAME & f = Bus->PeerLog[i];
+
+        if ((f.can_id == rx_id) && ((f.can_data[0] & 0xF0) == ISOTP_PCI_FC) && (cfs < CfCount(len)))
+        {
+            CHECK((f.can_data[0] == (ISOTP_PCI_FC | ISOTP_FS_CTS)) && (f.can_data[1] == ISOTP_BS) &&
+                  (f.can_data[2] == ISOTP_STMIN));
+            fcs++;
+            in_block = 0;
+        }
+        else if ((f.can_id == tx_id) && ((f.can_data[0] & 0xF0) == ISOTP_PCI_CF) && (cfs < CfCount(len)))
+        {
+            CHECK(f.can_data[0] == (ISOTP_PCI_CF | seq));
+            CHECK(++in_block <= BLOCK_CFS);             // not beyond Block Size
+            if (cfs > 0)
+            {
+                min_gap = (LogUs[i] - last_us < min_gap) ? LogUs[i] - last_us : min_gap;
+            }
+            last_us = LogUs[i];
+            seq = (seq + 1) & 0x0F;
+            cfs++;
+        }
+    }
+    printf("         0x%03X: %u CF, %u FC, min CF gap %u uS\n", tx_id, cfs, fcs, min_gap);
+    CHECK(cfs == CfCount(len));
+    CHECK(fcs == (1 + ((cfs - 1) / BLOCK_CFS)));
+    CHECK((min_gap + GAP_SLACK_US) >= (ISOTP_STMIN * 1000));
+}
+
+// two sessions sending and receiving at the same time
+static void TestConcurrent(void)
+{
+    const uint16_t lens[2] = { 300, 100 };
+    std::vector<uint8_t> msg[2];
+    size_t start = Bus->PeerLog.size();
+    CAN_FRAME other;
+
+    for (uint8_t s = 0; s < 2; ++s)
+    {
+        for (uint16_t i = 0; i < lens[s]; ++i)
+        {
+            msg[s].push_back((uint8_t)((i * 7) + s));
+        }
+        CHECK(Tester->Send(s, msg[s].data(), lens[s]) == ISOTP_OK);
+        CHECK(Tester->Send(s, msg[s].data(), lens[s]) == ISOTP_BUSY);
+    }
+
+    // other traffic in between (seen by both MCP2515s)
+    other.can_id = 0x123;
+    other.can_dlc = 8;
+    memset(other.can_data, 0, sizeof(other.can_data));
+    for (uint8_t i = 0; i < 40; ++i)
+    {
+        Bus->Inject(&other);
+        Pump(10);
+    }
+    Pump(20000);
+
+    for (uint8_t s = 0; s < 2; ++s)
+    {
+        printf("session %u: %u bytes request, %u bytes reply\n", s,
+               (unsigned)EcuRx[s].size(), (unsigned)TesterRx[s].size());
+        CHECK((TesterDone[s] == 1) && (TesterResult[s] == ISOTP_OK));
+        CHECK(EcuRx[s] == msg[s]);
+        CHECK(TesterRx[s].size() == lens[s]);
+        for (uint16_t i = 0; i < lens[s]; ++i)
+        {
+            CHECK(TesterRx[s][i] == (uint8_t)~msg[s][i]);
+        }
+        CHECK(!Tester->Busy(s) && !Ecu->Busy(s));
+        CheckFlow(start, ECU_RX_ID + s, ECU_TX_ID + s, lens[s]);
+        CheckFlow(start, ECU_TX_ID + s, ECU_RX_ID + s, lens[s]);
+    }
+    CHECK((EcuDone == 2) && (Other == 80));
+    CHECK(Tester->Service() == 0);
+}
+
+// sending against Flow Control of the external peer
+static void TestSend(void)
+{
+    const uint8_t msg[27] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99 };
+    const uint8_t fc_wait[3] = { ISOTP_PCI_FC | ISOTP_FS_WAIT, 0, 0 };
+    const uint8_t fc_ovflw[3] = { ISOTP_PCI_FC | ISOTP_FS_OVFLW, 0, 0 };
+    uint8_t fc_cts[3] = { ISOTP_PCI_FC | ISOTP_FS_CTS, 1, 5 };     // Block Size 1, 5 mS
+    uint8_t done = TesterDone[PEER_SESSION];
+    size_t base;
+
+    // Single Frame
+    base = Bus->PeerLog.size();
+    CHECK(Tester->Send(PEER_SESSION, msg, 7) == ISOTP_OK);
+    Pump(20);
+    CHECK((TesterDone[PEER_SESSION] == ++done) && (TesterResult[PEER_SESSION] == ISOTP_OK));
+    CHECK((Bus->PeerLog.size() == (base + 1)) && (Bus->PeerLog[base].can_id == PEER_RX_ID));
+    CHECK((Bus->PeerLog[base].can_data[0] == 0x07) && (memcmp(&Bus->PeerLog[base].can_data[1], msg, 7) == 0));
+
+    // no Flow Control - timeout
+    CHECK(Tester->Send(PEER_SESSION, msg, sizeof(msg)) == ISOTP_OK);
+    Pump(100);
+    CHECK((TesterDone[PEER_SESSION] == done) && Tester->Busy(PEER_SESSION));
+    Pump(ISOTP_TIMEOUT_MS * 50);
+    CHECK((TesterDone[PEER_SESSION] == ++done) && (TesterResult[PEER_SESSION] == ISOTP_TIMEOUT));
+    printf("send:    timeout ok\n");
+
+    // ISOTP_MAX_WFT Flow Control waits, then Block Size 1 and 5 mS Separation Time
+    base = Bus->PeerLog.size();
+    CHECK(Tester->Send(PEER_SESSION, msg, sizeof(msg)) == ISOTP_OK);
+    Pump(20);
+    CHECK((Bus->PeerLog.size() == (base + 1)) && (Bus->PeerLog[base].can_data[0] == 0x10) &&
+          (Bus->PeerLog[base].can_data[1] == sizeof(msg)));
+    for (uint8_t i = 0; i < ISOTP_MAX_WFT; ++i)
+    {
+        Inject(PEER_TX_ID, fc_wait, sizeof(fc_wait), 20);
+    }
+    CHECK(TesterDone[PEER_SESSION] == done);
+    Inject(PEER_TX_ID, fc_cts, sizeof(fc_cts), 400);
+    CHECK((Bus->PeerLog.size() == (base + 2)) && (Bus->PeerLog[base + 1].can_data[0] == 0x21));
+    fc_cts[1] = 0;                              // rest of message in one block
+    Inject(PEER_TX_ID, fc_cts, sizeof(fc_cts), 100);
+    CHECK(Bus->PeerLog.size() == (base + 3));   // Separation Time holds next CF
+    CHECK(TesterDone[PEER_SESSION] == done);
+    Pump(400);
+    CHECK((Bus->PeerLog.size() == (base + 4)) && (Bus->PeerLog[base + 2].can_data[0] == 0x22) &&
+          (Bus->PeerLog[base + 3].can_data[0] == 0x23));
+    CHECK((LogUs[base + 3] - LogUs[base + 2] + GAP_SLACK_US) >= 5000);
+    CHECK((TesterDone[PEER_SESSION] == ++done) && (TesterResult[PEER_SESSION] == ISOTP_OK));
+    printf("send:    flow control wait/block size/separation time ok\n");
+
+    // one Flow Control wait too many
+    CHECK(Tester->Send(PEER_SESSION, msg, sizeof(msg)) == ISOTP_OK);
+    Pump(20);
+    for (uint8_t i = 0; i <= ISOTP_MAX_WFT; ++i)
+    {
+        Inject(PEER_TX_ID, fc_wait, sizeof(fc_wait), 20);
+    }
+    CHECK((TesterDone[PEER_SESSION] == ++done) && (TesterResult[PEER_SESSION] == ISOTP_ABORTED));
+
+    // Flow Control overflow
+    CHECK(Tester->Send(PEER_SESSION, msg, sizeof(msg)) == ISOTP_OK);
+    Pump(20);
+    Inject(PEER_TX_ID, fc_ovflw, sizeof(fc_ovflw), 20);
+    CHECK((TesterDone[PEER_SESSION] == ++done) && (TesterResult[PEER_SESSION] == ISOTP_OVERFLOW));
+    printf("send:    flow control abort/overflow ok\n");
+}
+
+// receiving from the external peer
+static void TestReceive(void)
+{
+    uint8_t frame[8] = { 0 };
+    size_t base = Bus->PeerLog.size();
+
+    // First Frame longer than ISOTP_BUF_SIZE - Flow Control overflow
+    frame[0] = ISOTP_PCI_FF | (uint8_t)((ISOTP_BUF_SIZE + 1) >> 8);
+    frame[1] = (uint8_t)(ISOTP_BUF_SIZE + 1);
+    Inject(PEER_TX_ID, frame, 8, 20);
+    CHECK((Bus->PeerLog.size() == (base + 1)) && (Bus->PeerLog[base].can_id == PEER_RX_ID));
+    CHECK(Bus->PeerLog[base].can_data[0] == (ISOTP_PCI_FC | ISOTP_FS_OVFLW));
+    CHECK(!Tester->Busy(PEER_SESSION));
+
+    // 20 byte message - First Frame, Flow Control, Consecutive Frames reassembled
+    TesterRx[PEER_SESSION].clear();
+    frame[0] = ISOTP_PCI_FF;
+    frame[1] = 20;
+    for (uint8_t i = 2; i < 8; ++i)
+    {
+        frame[i] = i - 2;
+    }
+    Inject(PEER_TX_ID, frame, 8, 20);
+    CHECK((Bus->PeerLog.size() == (base + 2)) && Tester->Busy(PEER_SESSION));
+    CHECK((Bus->PeerLog[base + 1].can_data[0] == (ISOTP_PCI_FC | ISOTP_FS_CTS)) &&
+          (Bus->PeerLog[base + 1].can_data[1] == ISOTP_BS) && (Bus->PeerLog[base + 1].can_data[2] == ISOTP_STMIN));
+    for (uint8_t n = 0; n < 2; ++n)
+    {
+        frame[0] = ISOTP_PCI_CF | (n + 1);
+        for (uint8_t i = 1; i < 8; ++i)
+        {
+            frame[i] = 6 + (n * 7) + i - 1;
+        }
+        Inject(PEER_TX_ID, frame, 8, 20);
+    }
+    CHECK(!Tester->Busy(PEER_SESSION) && (TesterRx[PEER_SESSION].size() == 20));
+    for (uint8_t i = 0; i < 20; ++i)
+    {
+        CHECK(TesterRx[PEER_SESSION][i] == i);
+    }
+
+    // wrong sequence number - message dropped
+    TesterRx[PEER_SESSION].clear();
+    frame[0] = ISOTP_PCI_FF;
+    frame[1] = 20;
+    Inject(PEER_TX_ID, frame, 8, 20);
+    CHECK(Tester->Busy(PEER_SESSION));
+    frame[0] = ISOTP_PCI_CF | 2;
+    Inject(PEER_TX_ID, frame, 8, 20);
+    CHECK(!Tester->Busy(PEER_SESSION) && TesterRx[PEER_SESSION].empty());
+
+    // missing Consecutive Frames - message dropped after ISOTP_TIMEOUT_MS
+    frame[0] = ISOTP_PCI_FF;
+    Inject(PEER_TX_ID, frame, 8, 20);
+    CHECK(Tester->Busy(PEER_SESSION));
+    Pump(ISOTP_TIMEOUT_MS * 50);
+    CHECK(!Tester->Busy(PEER_SESSION) && TesterRx[PEER_SESSION].empty());
+
+    // Single Frame
+    frame[0] = ISOTP_PCI_SF | 3;
+    frame[1] = 0x41;
+    frame[2] = 0x0C;
+    frame[3] = 0x99;
+    Inject(PEER_TX_ID, frame, 8, 20);
+    CHECK((TesterRx[PEER_SESSION].size() == 3) && (TesterRx[PEER_SESSION][2] == 0x99));
+    printf("receive: overflow/reassembly/sequence/timeout ok\n");
+}
+
+int main(void)
+{
+    MCP2515_Model dev_ecu(ECU_CS, ECU_INT);
+    MCP2515_Model dev_tester(TESTER_CS, TESTER_INT);
+    MCP2515_Bus bus;
+
+    Host_Reset();
+    bus.Attach(&dev_ecu);
+    bus.Attach(&dev_tester);
+    Host_AddDevice(&dev_ecu);
+    Host_AddDevice(&dev_tester);
+    Bus = &bus;
+
+    DLK_MCP2515 can_ecu(8000000, ECU_CS);
+    DLK_MCP2515 can_tester(8000000, TESTER_CS);
+
+    CHECK(can_ecu.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_tester.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_ecu.MCP2515_OnRxPoll(ECU_INT, nullptr) == MCP2515_OK);
+    CHECK(can_tester.MCP2515_OnRxPoll(TESTER_INT, nullptr) == MCP2515_OK);
+    CanEcu = &can_ecu;
+    CanTester = &can_tester;
+
+    DLK_IsoTp ecu(&can_ecu);
+    DLK_IsoTp tester(&can_tester);
+
+    Ecu = &ecu;
+    Tester = &tester;
+    ecu.OnReceive(EcuReceive);
+    ecu.OnSendDone(EcuSendDone);
+    tester.OnReceive(TesterReceive);
+    tester.OnSendDone(TesterSendDone);
+    for (uint8_t s = 0; s < 2; ++s)
+    {
+        CHECK(ecu.Open(ECU_TX_ID + s, ECU_RX_ID + s) == s);
+        CHECK(tester.Open(ECU_RX_ID + s, ECU_TX_ID + s) == s);
+    }
+    CHECK(ecu.Open(0x100, ECU_RX_ID) == ISOTP_NO_SESSION);      // Rx CAN ID in use
+    CHECK(tester.Open(PEER_RX_ID, PEER_TX_ID) == PEER_SESSION);
+
+    TestConcurrent();
+    TestSend();
+    TestReceive();
+
+    CHECK((tester.Close(PEER_SESSION) == ISOTP_OK) && (tester.Close(PEER_SESSION) == ISOTP_FAIL));
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * NAME: host_routes.cpp
+ *
+ * WHAT:
+ *  Linux host test of DLK_CanRoutes:
+ *   1) ROUTES_MAX random standard and extended CAN ID ranges, compiled in shuffled
+ *      order - every lookup matches a linear scan of the rules
+ *   2) rules tables rejected (overlapping ranges, range ending before its start,
+ *      remapped range past the last CAN ID, too many rules)
+ *   3) block, remap, patch and rate limit actions
+ *   4) a routing table in a DLK_CanGateway between emulated MCP2515s
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Exits with 0 if all checks pass.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+
+#include <string.h>
+
+#include "DLK_CanGateway.h"
+#include "MCP2515_Model.h"
+#include "HostCheck.h"
+
+#define CAN_A_CS        10
+#define CAN_A_INT       2
+#define CAN_B_CS        9
+#define CAN_B_INT       3
+
+#define STD_RULES       (ROUTES_MAX / 2)        // standard CAN ID ranges (rest extended)
+#define EXT_BASE        0x18DA0000              // first extended CAN ID range
+#define EXT_STEP        10                      // extended CAN ID ranges spacing
+
+static CAN_ROUTE Rules[ROUTES_MAX + 1];
+
+// block, remap, patch and rate limit (3 CAN frames per second) rules
+static const CAN_ROUTE Actions[] =
+{
+    { 0x7DF, 0, ROUTE_BLOCK, 0, 0, 0, {}, {} },
+    { 0x100, 0x1FF, ROUTE_REMAP, 0x500, 0, 0, {}, {} },
+    { 0x300, 0, ROUTE_PATCH, 0, 0, 0, { 0xFF, 0x0F }, { 0x00, 0x05 } },
+    { 0x400, 0x4FF, ROUTE_RATE | ROUTE_REMAP, 0x18FF0000 | CAN_EFF_FLAG, 3, 1000, {}, {} },
+};
+#define ACTION_RULES    (sizeof(Actions) / sizeof(Actions[0]))
+
+// repeatable pseudo random number (xorshift32)
+static uint32_t Random(void)
+{
+    static uint32_t state = 0x2545F491;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// rule of CAN ID 'can_id' by linear scan of the first 'cnt' rules (nullptr = none)
+static const CAN_ROUTE * LinearFind(uint32_t can_id, uint16_t cnt)
+{
+    bool ext = (can_id & CAN_EFF_FLAG) != 0;
+    uint32_t id = can_id & (ext ? CAN_EFF_MASK : CAN_SFF_MASK);
+    uint32_t first;
+    uint32_t last;
+
+    for (uint16_t i = 0; i < cnt; ++i)
+    {
+        if (((Rules[i].first & CAN_EFF_FLAG) != 0) != ext)
+        {
+            continue;
+        }
+        first = Rules[i].first & CAN_EFF_MASK;
+        last = (Rules[i].last != 0) ? Rules[i].last : first;
+        if ((id >= first) && (id <= last))
+        {
+            return &Rules[i];
+        }
+    }
+    return nullptr;
+}
+
+// ROUTES_MAX random ranges in shuffled order against linear scan
+static void TestLookup(DLK_CanRoutes * routes)
+{
+    uint16_t cnt = 0;
+    uint32_t id = 0;
+    CAN_ROUTE tmp;
+    uint16_t j;
+
+    memset(Rules, 0, sizeof(Rules));
+
+    // standard CAN ID ranges of 1 to 3 CAN IDs with gaps of 1 to 6 CAN IDs
+    while (cnt < STD_RULES)
+    {
+        id += 1 + (Random() % 6);
+        Rules[cnt].first = id;
+        Rules[cnt].last = (Random() & 1) ? id + (Random() % 3) : 0;
+        Rules[cnt].action = (uint8_t)(Random() & (ROUTE_BLOCK | ROUTE_REMAP | ROUTE_PATCH | ROUTE_RATE));
+        id = (Rules[cnt].last != 0) ? Rules[cnt].last : id;
+        cnt++;
+    }
+    CHECK(id <= CAN_SFF_MASK);
+
+    // extended CAN ID ranges of 6 CAN IDs
+    for (id = EXT_BASE; cnt < ROUTES_MAX; id += EXT_STEP)
+    {
+        Rules[cnt].first = id | CAN_EFF_FLAG;
+        Rules[cnt].last = id + 5;
+        Rules[cnt].action = ROUTE_BLOCK;
+        cnt++;
+    }
+
+    // shuffle (Fisher-Yates)
+    for (uint16_t i = cnt - 1; i > 0; --i)
+    {
+        j = Random() % (i + 1);
+        tmp = Rules[i];
+        Rules[i] = Rules[j];
+        Rules[j] = tmp;
+    }
+
+    CHECK(routes->Compile(Rules, cnt));
+    CHECK(routes->Count() == cnt);
+
+    for (id = 0; id <= CAN_SFF_MASK; ++id)
+    {
+        CHECK(routes->Find(id) == LinearFind(id, cnt));
+        CHECK(routes->Find(id | CAN_RTR_FLAG) == LinearFind(id, cnt));
+    }
+    for (id = EXT_BASE - 20; id < (EXT_BASE + (EXT_STEP * (ROUTES_MAX - STD_RULES)) + 20); ++id)
+    {
+        CHECK(routes->Find(id | CAN_EFF_FLAG) == LinearFind(id | CAN_EFF_FLAG, cnt));
+    }
+    CHECK(routes->Find(CAN_EFF_FLAG) == nullptr);
+    CHECK(routes->Find(CAN_EFF_MASK | CAN_EFF_FLAG) == nullptr);
+    printf("lookup:  %u rules match linear scan\n", cnt);
+
+    // too many rules
+    CHECK(!routes->Compile(Rules, ROUTES_MAX + 1));
+}
+
+// rules tables rejected
+static void TestReject(DLK_CanRoutes * routes)
+{
+    const CAN_ROUTE overlap[] =
+    {
+        { 0x100, 0x110, ROUTE_PASS, 0, 0, 0, {}, {} },
+        { 0x110, 0, ROUTE_BLOCK, 0, 0, 0, {}, {} },
+    };
+    const CAN_ROUTE ext_overlap[] =
+    {
+        { 0x100 | CAN_EFF_FLAG, 0x1FF, ROUTE_PASS, 0, 0, 0, {}, {} },
+        { 0x180 | CAN_EFF_FLAG, 0x280, ROUTE_BLOCK, 0, 0, 0, {}, {} },
+    };
+    const CAN_ROUTE backwards[] =
+    {
+        { 0x120, 0x110, ROUTE_PASS, 0, 0, 0, {}, {} },
+    };
+    const CAN_ROUTE remap_std[] =
+    {
+        { 0x100, 0x10F, ROUTE_REMAP, 0x7F8, 0, 0, {}, {} },
+    };
+    const CAN_ROUTE remap_ext[] =
+    {
+        { 0x100, 0x1FF, ROUTE_REMAP, 0x1FFFFF80 | CAN_EFF_FLAG, 0, 0, {}, {} },
+    };
+    const CAN_ROUTE remap_last[] =
+    {
+        { 0x100, 0x10F, ROUTE_REMAP, 0x7F0, 0, 0, {}, {} },
+    };
+    const CAN_ROUTE std_and_ext[] =
+    {
+        { 0x100, 0x1FF, ROUTE_PASS, 0, 0, 0, {}, {} },
+        { 0x100 | CAN_EFF_FLAG, 0x1FF, ROUTE_BLOCK, 0, 0, 0, {}, {} },
+    };
+
+    CHECK(!routes->Compile(overlap, 2) && (routes->Count() == 0));
+    CHECK(!routes->Compile(ext_overlap, 2) && (routes->Count() == 0));
+    CHECK(!routes->Compile(backwards, 1) && (routes->Count() == 0));
+    CHECK(!routes->Compile(remap_std, 1) && (routes->Count() == 0));
+    CHECK(!routes->Compile(remap_ext, 1) && (routes->Count() == 0));
+
+    // remapped range ending on the last standard CAN ID
+    CHECK(routes->Compile(remap_last, 1) && (routes->Count() == 1));
+
+    // same range of standard and extended CAN IDs do not overlap
+    CHECK(routes->Compile(std_and_ext, 2) && (routes->Count() == 2));
+    CHECK(routes->Find(0x150) == &std_and_ext[0]);
+    CHECK(routes->Find(0x150 | CAN_EFF_FLAG) == &std_and_ext[1]);
+    printf("reject:  ok\n");
+}
+
+// block, remap, patch and rate limit actions
+static void TestActions(DLK_CanRoutes * routes)
+{
+    CAN_FRAME frame;
+    uint8_t passed = 0;
+
+    CHECK(routes->Compile(Actions, ACTION_RULES, ROUTE_BLOCK));
+    memset(&frame, 0, sizeof(frame));
+    frame.can_dlc = 8;
+
+    frame.can_id = 0x7DF;
+    CHECK(!routes->Apply(&frame, 0));
+    frame.can_id = 0x223;                       // no rule - default action
+    CHECK(!routes->Apply(&frame, 0));
+
+    frame.can_id = 0x120 | CAN_RTR_FLAG;        // offset in range kept, RTR flag kept
+    CHECK(routes->Apply(&frame, 0) && (frame.can_id == (0x520 | CAN_RTR_FLAG)));
+
+    frame.can_id = 0x300;
+    memset(frame.can_data, 0xAA, sizeof(frame.can_data));
+    CHECK(routes->Apply(&frame, 0) && (frame.can_id == 0x300));
+    CHECK((frame.can_data[0] == 0x00) && (frame.can_data[1] == 0xA5) && (frame.can_data[2] == 0xAA));
+
+    // 3 CAN frames per second for whole range, remapped to extended CAN IDs
+    for (uint8_t i = 0; i < 10; ++i)
+    {
+        frame.can_id = 0x410 + i;
+        if (routes->Apply(&frame, 5000 + i))
+        {
+            CHECK(frame.can_id == ((0x18FF0010 + i) | CAN_EFF_FLAG));
+            passed++;
+        }
+    }
+    CHECK(passed == 3);
+    frame.can_id = 0x410;                       // next second
+    CHECK(routes->Apply(&frame, 6010));
+
+    printf("actions: blocked %u limited %u\n", routes->BlockedCount(), routes->LimitedCount());
+    CHECK((routes->BlockedCount() == 2) && (routes->LimitedCount() == 7));
+}
+
+// routing table in a CAN gateway
+static void TestGateway(DLK_CanRoutes * routes)
+{
+    const uint32_t ids[] = { 0x7DF, 0x150, 0x300, 0x222, 0x401, 0x402, 0x403, 0x404 };
+    MCP2515_Model dev_a(CAN_A_CS, CAN_A_INT);
+    MCP2515_Model dev_b(CAN_B_CS, CAN_B_INT);
+    MCP2515_Bus bus_a;
+    MCP2515_Bus bus_b;
+    CAN_GW_STATS stats;
+    CAN_FRAME frame;
+
+    Host_Reset();
+    bus_a.Attach(&dev_a);
+    bus_b.Attach(&dev_b);
+    Host_AddDevice(&dev_a);
+    Host_AddDevice(&dev_b);
+
+    DLK_MCP2515 can_a(8000000, CAN_A_CS);
+    DLK_MCP2515 can_b(8000000, CAN_B_CS);
+
+    CHECK(can_a.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_b.MCP2515_Init(CAN_500KBPS) == MCP2515_OK);
+    CHECK(can_a.MCP2515_OnRxInterrupt(CAN_A_INT, nullptr) == MCP2515_OK);
+    CHECK(can_b.MCP2515_OnRxInterrupt(CAN_B_INT, nullptr) == MCP2515_OK);
+
+    DLK_CanGateway gw(&can_a, &can_b);
+
+    CHECK(routes->Compile(Actions, ACTION_RULES));
+    CHECK(gw.SetRoutes(GW_A_TO_B, routes) == MCP2515_OK);
+    CHECK(gw.SetRoutes(GW_N_DIRS, routes) == MCP2515_FAIL);
+
+    memset(&frame, 0, sizeof(frame));
+    frame.can_dlc = 8;
+    for (uint8_t i = 0; i < (sizeof(ids) / sizeof(ids[0])); ++i)
+    {
+        frame.can_id = ids[i];
+        bus_a.Inject(&frame);
+        for (uint8_t n = 0; n < 10; ++n)
+        {
+            gw.Service();
+            Host_Advance(50);
+        }
+    }
+
+    gw.GetStats(GW_A_TO_B, &stats);
+    printf("gateway: forwarded %u filtered %u\n", stats.forwarded, stats.filtered);
+    CHECK((stats.forwarded == 6) && (stats.filtered == 2) && (bus_b.PeerLog.size() == 6));
+    CHECK(bus_b.PeerLog[0].can_id == 0x550);
+    CHECK((bus_b.PeerLog[1].can_id == 0x300) && (bus_b.PeerLog[2].can_id == 0x222));
+    CHECK(bus_b.PeerLog[3].can_id == (0x18FF0001 | CAN_EFF_FLAG));
+}
+
+int main(void)
+{
+    DLK_CanRoutes routes;
+
+    TestLookup(&routes);
+    TestReject(&routes);
+    TestActions(&routes);
+    TestGateway(&routes);
+    printf("ok\n");
+    return 0;
+}
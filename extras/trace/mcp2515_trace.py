@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+NAME: mcp2515_trace.py
+
+WHAT:
+ Decoder for DLK_MCP2515 SPI transaction traces written by
+ DLK_MCP2515::MCP2515_TraceDump() (compiled in with MCP2515_USE_TRACE 1).
+
+SPECIAL CONSIDERATIONS:
+ The input is a raw capture of the serial output (e.g. saved by a terminal
+ program, or 'cat /dev/ttyACM0 > trace.bin'). Any other serial output around
+ the trace dumps is skipped.
+
+ Usage:
+     mcp2515_trace.py [-s] [capture file (default stdin)]
+         -s  only print the summary of each trace dump
+
+ Each SPI transaction is listed with its start time, time since the previous
+ one, duration, instruction, register and length. Application marks
+ (MCP2515_TraceMark()) start a new group, so the SPI transactions made by an
+ API call are counted between marks. The summary gives the count, bytes,
+ total and max duration per instruction.
+
+AUTHOR:
+ D.L. Karmann
+
+"""
+import struct
+import sys
+
+TRACE_VERSION = 1
+HEADER = struct.Struct('<2sBBHBB')     # 'MT', version, entry size, count, CS pin, 0
+ENTRY = struct.Struct('<IHBBB')        # start uS, duration uS, instruction, register, length
+TRACE_MARK = 0x00
+
+INSTRS = {
+    0x02: 'WRITE',
+    0x03: 'READ',
+    0x05: 'BIT MODIFY',
+    0xA0: 'READ STATUS',
+    0xB0: 'RX STATUS',
+    0xC0: 'RESET',
+    0x40: 'LOAD TXB0 SIDH',
+    0x41: 'LOAD TXB0 D0',
+    0x42: 'LOAD TXB1 SIDH',
+    0x43: 'LOAD TXB1 D0',
+    0x44: 'LOAD TXB2 SIDH',
+    0x45: 'LOAD TXB2 D0',
+    0x90: 'READ RXB0 SIDH',
+    0x92: 'READ RXB0 D0',
+    0x94: 'READ RXB1 SIDH',
+    0x96: 'READ RXB1 D0',
+}
+
+# registers at the same address in each 16-register block
+BLOCK_REGS = {0x0C: 'BFPCTRL', 0x0D: 'TXRTSCTRL', 0x0E: 'CANSTAT', 0x0F: 'CANCTRL'}
+TXB_REGS = ['CTRL', 'SIDH', 'SIDL', 'EID8', 'EID0', 'DLC'] + ['D%d' % n for n in range(8)]
+ID_REGS = ['SIDH', 'SIDL', 'EID8', 'EID0']
+
+
+def reg_name(reg):
+    """Name of MCP2515 register at address 'reg'."""
+    low = reg & 0x0F
+    if low in BLOCK_REGS:
+        return BLOCK_REGS[low]
+    if reg < 0x0C:
+        return 'RXF%d%s' % (reg // 4, ID_REGS[reg % 4])
+    if 0x10 <= reg < 0x1C:
+        return 'RXF%d%s' % (3 + (reg - 0x10) // 4, ID_REGS[reg % 4])
+    fixed = {0x1C: 'TEC', 0x1D: 'REC', 0x28: 'CNF3', 0x29: 'CNF2', 0x2A: 'CNF1',
+             0x2B: 'CANINTE', 0x2C: 'CANINTF', 0x2D: 'EFLG'}
+    if reg in fixed:
+        return fixed[reg]
+    if 0x20 <= reg < 0x28:
+        return 'RXM%d%s' % ((reg - 0x20) // 4, ID_REGS[reg % 4])
+    if 0x30 <= reg < 0x60:
+        return 'TXB%d%s' % ((reg >> 4) - 3, TXB_REGS[low])
+    if 0x60 <= reg < 0x80:
+        return 'RXB%d%s' % ((reg >> 4) - 6, TXB_REGS[low])
+    return '0x%02X' % reg
+
+
+def instr_name(instr):
+    """Name of MCP2515 SPI instruction 'instr'."""
+    if instr & 0xF8 == 0x80:
+        return 'RTS ' + '+'.join('TXB%d' % n for n in range(3) if instr & (1 << n))
+    return INSTRS.get(instr, '0x%02X' % instr)
+
+
+def find_dumps(data):
+    """Yield (CS pin, entries) of each trace dump in captured 'data'."""
+    pos = 0
+    while True:
+        pos = data.find(b'MT', pos)
+        if pos < 0 or pos + HEADER.size > len(data):
+            return
+        magic, version, size, count, cs_pin, _ = HEADER.unpack_from(data, pos)
+        end = pos + HEADER.size + count * ENTRY.size
+        if version != TRACE_VERSION or size != ENTRY.size or end > len(data):
+            pos += 2        # not a trace dump header (or dump cut short)
+            continue
+        entries = [ENTRY.unpack_from(data, pos + HEADER.size + n * ENTRY.size) for n in range(count)]
+        yield cs_pin, entries
+        pos = end
+
+
+def print_dump(cs_pin, entries, summary_only):
+    """Print SPI transactions and summary of a trace dump."""
+    totals = {}
+    group = [0, 0, 0]       # transactions, bytes, duration since last mark
+    prev = None
+
+    print('MCP2515 CS pin %d: %d entries' % (cs_pin, len(entries)))
+    for us, dur, instr, reg, length in entries:
+        delta = '' if prev is None else '+%d' % ((us - prev) & 0xFFFFFFFF)
+        prev = us
+        if instr == TRACE_MARK and length == 0:
+            if not summary_only:
+                if group[0]:
+                    print('%34s%d transactions, %d bytes, %d uS' % ('', group[0], group[1], group[2]))
+                print('%10d %8s  ---- mark %d ----' % (us, delta, reg))
+            group = [0, 0, 0]
+            continue
+
+        name = instr_name(instr)
+        if instr in (0x02, 0x03, 0x05):
+            name += ' ' + reg_name(reg)
+        if not summary_only:
+            print('%10d %8s %5d  %-24s %3d' % (us, delta, dur, name, length))
+        group[0] += 1
+        group[1] += length
+        group[2] += dur
+
+        total = totals.setdefault(instr_name(instr), [0, 0, 0, 0])
+        total[0] += 1
+        total[1] += length
+        total[2] += dur
+        total[3] = max(total[3], dur)
+
+    if not summary_only and group[0]:
+        print('%34s%d transactions, %d bytes, %d uS' % ('', group[0], group[1], group[2]))
+
+    print('%-24s %7s %8s %9s %7s' % ('instruction', 'count', 'bytes', 'total uS', 'max uS'))
+    for name, (count, nbytes, total_us, max_us) in sorted(totals.items(), key=lambda t: -t[1][2]):
+        print('%-24s %7d %8d %9d %7d' % (name, count, nbytes, total_us, max_us))
+    print()
+
+
+def main(argv):
+    summary_only = '-s' in argv
+    files = [a for a in argv if a != '-s']
+    if files:
+        with open(files[0], 'rb') as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    found = False
+    for cs_pin, entries in find_dumps(data):
+        print_dump(cs_pin, entries, summary_only)
+        found = True
+    if not found:
+        print('no trace dump found', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,249 @@
+/** \file DLK_BitTiming.h */
+/*
+ * NAME: DLK_BitTiming.h
+ *
+ * WHAT:
+ *  Header file for MCP2515 CAN bit timing (CNF1/CNF2/CNF3) solver.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  The solver functions are C++11 constexpr (single return statement, recursion
+ *  instead of loops), so with constant arguments (e.g. assigned to a constexpr
+ *  variable) the bit timing is calculated by the compiler and costs nothing at
+ *  runtime. Called with non-constant arguments they run on the MCU (64-bit math).
+ *
+ *  Bit time = SyncSeg (1 TQ) + PropSeg + PS1 + PS2 = 5 to 25 TQ,
+ *  TQ = 2 * (BRP + 1) / Fosc.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_BITTIMING_H__
+#define __DLK_BITTIMING_H__
+
+#include <stdint.h>
+
+#include "MCP2515.h"
+
+#define BT_TQ_MIN       5       // min TQ per bit
+#define BT_TQ_MAX       25      // max TQ per bit
+#define BT_BRP_CNT      64      // number of baud rate prescaler values
+#define BT_SEG_MAX      8       // max PropSeg, PS1 and PS2 length (TQ)
+#define BT_PS2_MIN      2       // min PS2 length (TQ)
+#define BT_SJW_MAX      4       // max synchronization jump width (TQ)
+
+/// MCP2515 CAN bit timing configuration
+typedef struct mcp2515_bittiming
+{
+    /// achieved CAN bus speed (bits per second - 0 = no bit timing possible)
+    uint32_t bitrate;
+    /// achieved CAN bus speed error from requested (parts per million, + = faster)
+    int32_t error_ppm;
+    /// achieved sample point (per mille of bit time)
+    uint16_t sample_point;
+    /// CNF1 register value (SJW, BRP)
+    uint8_t cnf1;
+    /// CNF2 register value (BTLMODE, SAM, PHSEG1, PRSEG)
+    uint8_t cnf2;
+    /// CNF3 register value (PHSEG2)
+    uint8_t cnf3;
+} MCP2515_BITTIMING;
+
+/// bit timing solver internals (use \ref MCP2515_CalcBitTiming)
+namespace DLK_BitTiming
+{
+    constexpr uint8_t Max(uint8_t a, uint8_t b)
+    {
+        return (a > b) ? a : b;
+    }
+
+    constexpr uint8_t Min(uint8_t a, uint8_t b)
+    {
+        return (a < b) ? a : b;
+    }
+
+    /// oscillator clocks per bit for a BRP and TQ count
+    constexpr uint32_t Clocks(uint8_t brp, uint8_t tq)
+    {
+        return 2UL * (brp + 1) * tq;
+    }
+
+    /// PS2 length from CNF2/CNF3 register values
+    constexpr uint8_t CnfPs2(uint8_t cnf2, uint8_t cnf3)
+    {
+        return (cnf2 & BTLMODE) ? (cnf3 & PHSEG2_BITS) + 1 :
+                                  Max(((cnf2 & PHSEG1_BITS) >> 3) + 1, BT_PS2_MIN);
+    }
+
+    /// TQ per bit from CNF2/CNF3 register values
+    constexpr uint8_t CnfTq(uint8_t cnf2, uint8_t cnf3)
+    {
+        return 1 + (cnf2 & PRSEG_BITS) + 1 + ((cnf2 & PHSEG1_BITS) >> 3) + 1 + CnfPs2(cnf2, cnf3);
+    }
+
+    constexpr MCP2515_BITTIMING DecodeClocks(uint32_t osc, uint32_t rate, uint8_t cnf1, uint8_t cnf2,
+                                             uint8_t cnf3, uint32_t clocks)
+    {
+        return MCP2515_BITTIMING
+        {
+            (osc + clocks / 2) / clocks,
+            (int32_t)(((int64_t)osc - (int64_t)rate * clocks) * 1000000 / ((int64_t)rate * clocks)),
+            (uint16_t)((CnfTq(cnf2, cnf3) - CnfPs2(cnf2, cnf3)) * 1000UL / CnfTq(cnf2, cnf3)),
+            cnf1,
+            cnf2,
+            cnf3
+        };
+    }
+
+    /// bit timing for CNF1/CNF2/CNF3 register values
+    constexpr MCP2515_BITTIMING Decode(uint32_t osc, uint32_t rate, uint8_t cnf1, uint8_t cnf2, uint8_t cnf3)
+    {
+        return DecodeClocks(osc, rate, cnf1, cnf2, cnf3, Clocks(cnf1 & BRP_BITS, CnfTq(cnf2, cnf3)));
+    }
+
+    /// bit rate error (in oscillator clocks per bit * bitrate)
+    constexpr uint64_t Err(uint32_t osc, uint32_t rate, uint8_t brp, uint8_t tq)
+    {
+        return ((uint64_t)rate * Clocks(brp, tq) > osc) ?
+                    (uint64_t)rate * Clocks(brp, tq) - osc :
+                    osc - (uint64_t)rate * Clocks(brp, tq);
+    }
+
+    /// PS2 length from sample point, within limits (PS2 > SJW)
+    constexpr uint8_t Ps2Lim(uint8_t ps2, uint8_t tq, uint8_t sjw)
+    {
+        return Min(Max(Max(ps2, BT_PS2_MIN), Max(sjw + 1, (tq > 17) ? (tq - 17) : 0)), BT_SEG_MAX);
+    }
+
+    constexpr uint8_t Ps2(uint8_t tq, uint16_t sp, uint8_t sjw)
+    {
+        return Ps2Lim(tq - (uint8_t)(((uint32_t)tq * sp + 500) / 1000), tq, sjw);
+    }
+
+    /// PropSeg + PS1 length
+    constexpr uint8_t Tseg1(uint8_t tq, uint16_t sp, uint8_t sjw)
+    {
+        return tq - 1 - Ps2(tq, sp, sjw);
+    }
+
+    /// PS1 length (at least half of Tseg1 and SJW, leaving PropSeg >= 1)
+    constexpr uint8_t Ps1(uint8_t tq, uint16_t sp, uint8_t sjw)
+    {
+        return Max((Tseg1(tq, sp, sjw) + 1) / 2, Min(sjw, Tseg1(tq, sp, sjw) - 1));
+    }
+
+    /// check that TQ count can be split into segments within limits
+    constexpr bool Valid(uint8_t tq, uint16_t sp, uint8_t sjw)
+    {
+        return (Ps2(tq, sp, sjw) > sjw) &&
+               (Tseg1(tq, sp, sjw) >= Ps2(tq, sp, sjw)) &&
+               (Tseg1(tq, sp, sjw) <= 2 * BT_SEG_MAX) &&
+               (Ps1(tq, sp, sjw) >= sjw);
+    }
+
+    /// sample point distance from target (per mille)
+    constexpr uint16_t SpDist(uint8_t tq, uint16_t sp, uint8_t sjw)
+    {
+        return ((tq - Ps2(tq, sp, sjw)) * 1000UL / tq > sp) ?
+                    (tq - Ps2(tq, sp, sjw)) * 1000UL / tq - sp :
+                    sp - (tq - Ps2(tq, sp, sjw)) * 1000UL / tq;
+    }
+
+    /// compare bit rate errors of candidates 'a' and 'b' (BRP << 8 | TQ)
+    constexpr uint64_t ErrA(uint32_t osc, uint32_t rate, uint16_t a, uint16_t b)
+    {
+        return Err(osc, rate, a >> 8, a & 0xff) * Clocks(b >> 8, b & 0xff);
+    }
+
+    /// candidate 'a' (BRP << 8 | TQ, 0 = none) better than 'b'
+    ///  - least bit rate error, then nearest sample point, then lowest BRP
+    constexpr bool Better(uint32_t osc, uint32_t rate, uint16_t sp, uint8_t sjw, uint16_t a, uint16_t b)
+    {
+        return (b == 0) ||
+               (ErrA(osc, rate, a, b) < ErrA(osc, rate, b, a)) ||
+               ((ErrA(osc, rate, a, b) == ErrA(osc, rate, b, a)) &&
+                (SpDist(a & 0xff, sp, sjw) < SpDist(b & 0xff, sp, sjw)));
+    }
+
+    /// best candidate for a BRP (TQ counts from 'tq' down to BT_TQ_MIN)
+    constexpr uint16_t BestTq(uint32_t osc, uint32_t rate, uint16_t sp, uint8_t sjw,
+                              uint8_t brp, uint8_t tq, uint16_t best)
+    {
+        return (tq < BT_TQ_MIN) ? best :
+               BestTq(osc, rate, sp, sjw, brp, tq - 1,
+                      (Valid(tq, sp, sjw) && Better(osc, rate, sp, sjw, (brp << 8) | tq, best)) ?
+                            (uint16_t)((brp << 8) | tq) : best);
+    }
+
+    /// best candidate for all BRPs (from 'brp' up)
+    constexpr uint16_t Best(uint32_t osc, uint32_t rate, uint16_t sp, uint8_t sjw,
+                            uint8_t brp, uint16_t best)
+    {
+        return (brp >= BT_BRP_CNT) ? best :
+               Best(osc, rate, sp, sjw, brp + 1, BestTq(osc, rate, sp, sjw, brp, BT_TQ_MAX, best));
+    }
+
+    /// bit timing for BRP and TQ count
+    constexpr MCP2515_BITTIMING Make(uint32_t osc, uint32_t rate, uint16_t sp, uint8_t sjw,
+                                     uint8_t brp, uint8_t tq)
+    {
+        return Decode(osc, rate,
+                      (uint8_t)(((sjw - 1) << 6) | brp),
+                      (uint8_t)(BTLMODE | SAMPLE_1X | ((Ps1(tq, sp, sjw) - 1) << 3) |
+                                (Tseg1(tq, sp, sjw) - Ps1(tq, sp, sjw) - 1)),
+                      (uint8_t)(Ps2(tq, sp, sjw) - 1));
+    }
+
+    constexpr MCP2515_BITTIMING Solved(uint32_t osc, uint32_t rate, uint16_t sp, uint8_t sjw,
+                                       uint16_t best)
+    {
+        return (best == 0) ? MCP2515_BITTIMING{ 0, 0, 0, 0, 0, 0 } :
+                             Make(osc, rate, sp, sjw, best >> 8, best & 0xff);
+    }
+}
+
+/**
+ * Calculate MCP2515 CAN bit timing (CNF1/CNF2/CNF3 register values).
+ *
+ * \param osc_hz: the MCP2515 oscillator (crystal) frequency (Hz)
+ * \param bitrate: the CAN bus speed (bits per second)
+ * \param sample_point: the target sample point (per mille of bit time - e.g. 875 = 87.5%)
+ * \param sjw: the synchronization jump width (1 to 4 TQ - PS2 is kept longer than SJW,
+ *             so larger SJWs may move the sample point earlier)
+ *
+ * \return   MCP2515_BITTIMING = the bit timing with the least bit rate error (then
+ *           nearest sample point, then lowest BRP), with its achieved bit rate,
+ *           bit rate error and sample point \n
+ *           bitrate = 0 if no bit timing is possible
+ *
+ *  \note Use with constant arguments in a constexpr variable to calculate at compile
+ *        time, e.g.: constexpr MCP2515_BITTIMING bt = MCP2515_CalcBitTiming(16000000, 500000);
+ */
+constexpr MCP2515_BITTIMING MCP2515_CalcBitTiming(uint32_t osc_hz, uint32_t bitrate,
+                                                  uint16_t sample_point = 875, uint8_t sjw = 1)
+{
+    return ((bitrate == 0) || (sjw < 1) || (sjw > BT_SJW_MAX) || (sample_point >= 1000)) ?
+                MCP2515_BITTIMING{ 0, 0, 0, 0, 0, 0 } :
+                DLK_BitTiming::Solved(osc_hz, bitrate, sample_point, sjw,
+                    DLK_BitTiming::Best(osc_hz, bitrate, sample_point, sjw, 0, 0));
+}
+
+/**
+ * Get MCP2515 CAN bit timing achieved by CNF1/CNF2/CNF3 register values.
+ *
+ * \param osc_hz: the MCP2515 oscillator (crystal) frequency (Hz)
+ * \param bitrate: the requested CAN bus speed (bits per second - for bit rate error)
+ * \param cnf1: the CNF1 register value
+ * \param cnf2: the CNF2 register value
+ * \param cnf3: the CNF3 register value
+ *
+ * \return   MCP2515_BITTIMING = the bit timing with its achieved bit rate, bit rate
+ *           error and sample point
+ */
+constexpr MCP2515_BITTIMING MCP2515_DecodeBitTiming(uint32_t osc_hz, uint32_t bitrate,
+                                                    uint8_t cnf1, uint8_t cnf2, uint8_t cnf3)
+{
+    return DLK_BitTiming::Decode(osc_hz, bitrate, cnf1, cnf2, cnf3);
+}
+
+#endif  // __DLK_BITTIMING_H__
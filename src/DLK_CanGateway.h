@@ -0,0 +1,309 @@
+/** \file DLK_CanGateway.h */
+/*
+ * NAME: DLK_CanGateway.h
+ *
+ * WHAT:
+ *  Header file for CAN gateway class forwarding CAN frames both ways between two MCP2515s.
+ *
+ *  CAN A <=====> Gateway <=====> CAN B
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Each Service() call moves the received CAN frames of each MCP2515 into the gateway
+ *  queue of its direction (Rx ring buffer with an Int line or polled Int pin, else
+ *  MCP2515_Recv()), then hands queued CAN frames to the other MCP2515 for asynchronous
+ *  transmission (MCP2515_SendAsync()) - nothing blocks.
+ *
+ *  TX backpressure: at most GW_TX_INFLIGHT CAN frames are handed to the destination
+ *  MCP2515 at a time (its 3 Tx buffers, plus one queued to refill a Tx buffer from the
+ *  Tx interrupt), the rest wait in the gateway queue. A CAN frame received with the
+ *  gateway queue full is dropped (counted).
+ *
+ *  A routing table (DLK_CanRoutes) per direction may block, rate limit, remap or patch
+ *  the CAN frames received, before they take a place in the gateway queue.
+ *
+ *  Received CAN frames must not be taken by the application (no MCP2515_Pop()), Rx
+ *  callbacks still get them.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_CANGATEWAY_H__
+#define __DLK_CANGATEWAY_H__
+
+#include "DLK_MCP2515.h"
+#include "DLK_CanRoutes.h"
+
+#define GW_A_TO_B       0       // CAN frames received by MCP2515 A, sent by MCP2515 B
+#define GW_B_TO_A       1       // CAN frames received by MCP2515 B, sent by MCP2515 A
+#define GW_N_DIRS       2
+
+// gateway queue size per direction - must be a power of 2 (may be predefined to override)
+#ifndef GW_QUEUE_CNT
+#if defined(__AVR__)
+#define GW_QUEUE_CNT    8
+#else
+#define GW_QUEUE_CNT    32
+#endif
+#endif
+
+// max CAN frames handed to the destination MCP2515 and not yet transmitted
+// (may be predefined to override - up to MCP2515_N_TXBUFFERS + TX_QUEUE_CNT)
+#ifndef GW_TX_INFLIGHT
+#define GW_TX_INFLIGHT  (MCP2515_N_TXBUFFERS + 1)
+#endif
+
+/// CAN gateway statistics of one direction (see DLK_CanGateway::GetStats())
+typedef struct can_gw_stats
+{
+    /// CAN frames forwarded (handed to the destination MCP2515)
+    uint32_t forwarded;
+    /// CAN frames dropped due to gateway queue full
+    uint32_t dropped;
+    /// CAN frames refused by the destination MCP2515 (bus-off or invalid 'can_dlc')
+    uint32_t failed;
+    /// CAN frames not forwarded by the routing table (blocked or over rate limit)
+    uint32_t filtered;
+    /// total time in gateway queue of CAN frames forwarded (uS)
+    uint32_t latency_us;
+    /// longest time in gateway queue of a CAN frame forwarded (uS)
+    uint32_t latency_max_us;
+    /// highest number of CAN frames ever in gateway queue (of GW_QUEUE_CNT)
+    uint8_t queue_hwm;
+} CAN_GW_STATS;
+
+/// CAN frame in gateway queue
+typedef struct can_gw_entry
+{
+    /// CAN frame received
+    CAN_FRAME frame;
+    /// time received by gateway (uS)
+    uint32_t us;
+} CAN_GW_ENTRY;
+
+/**
+ * CAN gateway forwarding CAN frames both ways between two MCP2515s.
+ */
+class DLK_CanGateway
+{
+    public:
+        /**
+         * \param can_a: the MCP2515 of CAN bus A (after \ref DLK_MCP2515::MCP2515_Init)
+         * \param can_b: the MCP2515 of CAN bus B (after \ref DLK_MCP2515::MCP2515_Init)
+         *
+         *  \note An MCP2515 with an Int line interrupt (\ref DLK_MCP2515::MCP2515_OnRxInterrupt)
+         *        or polled Int pin (\ref DLK_MCP2515::MCP2515_OnRxPoll) costs no SPI
+         *        operations while idle, else each Service() polls it with
+         *        \ref DLK_MCP2515::MCP2515_Recv.
+         */
+        DLK_CanGateway(DLK_MCP2515 * can_a, DLK_MCP2515 * can_b)
+        {
+            Can[GW_A_TO_B] = can_a;
+            Can[GW_B_TO_A] = can_b;
+            Routes[GW_A_TO_B] = nullptr;
+            Routes[GW_B_TO_A] = nullptr;
+            ResetStats();
+        }
+
+        /**
+         * Set routing table of one direction.
+         *
+         * \param dir: the direction (\ref GW_A_TO_B or \ref GW_B_TO_A)
+         * \param routes: the compiled routing table (\ref DLK_CanRoutes::Compile), or
+         *                nullptr to forward all CAN frames unchanged
+         *
+         * \return   MCP2515_FAIL = invalid \b dir
+         * \return   MCP2515_OK = routing table set
+         */
+        uint8_t SetRoutes(uint8_t dir, DLK_CanRoutes * routes)
+        {
+            if (dir >= GW_N_DIRS)
+            {
+                return MCP2515_FAIL;
+            }
+            Routes[dir] = routes;
+            return MCP2515_OK;
+        }
+
+        /**
+         * Forward the CAN frames received by both MCP2515s.
+         *  - call often from loop()
+         *
+         * \return   uint8_t = the number of CAN frames forwarded
+         *
+         *  \note Also services both MCP2515s (\ref DLK_MCP2515::MCP2515_Service, and
+         *        \ref DLK_MCP2515::MCP2515_ServiceTx without an Int pin).
+         */
+        uint8_t Service(void)
+        {
+            uint8_t cnt = 0;
+
+            for (uint8_t dir = 0; dir < GW_N_DIRS; ++dir)
+            {
+                ServiceCan(Can[dir]);
+            }
+            for (uint8_t dir = 0; dir < GW_N_DIRS; ++dir)
+            {
+                Receive(dir);
+                cnt += Forward(dir);
+            }
+            return cnt;
+        }
+
+        /**
+         * Get number of CAN frames waiting in gateway queue.
+         *
+         * \param dir: the direction (\ref GW_A_TO_B or \ref GW_B_TO_A)
+         *
+         * \return   uint8_t = the number of CAN frames not yet forwarded
+         */
+        uint8_t Pending(uint8_t dir)
+        {
+            return (dir < GW_N_DIRS) ? Queue[dir].Available() : 0;
+        }
+
+        /**
+         * Get statistics snapshot of one direction.
+         *
+         * \param dir: the direction (\ref GW_A_TO_B or \ref GW_B_TO_A)
+         * \param stats: the place to store the statistics
+         *
+         * \return   MCP2515_FAIL = invalid \b dir
+         * \return   MCP2515_OK = statistics stored
+         *
+         *  \note The average latency is \b latency_us / \b forwarded.
+         */
+        uint8_t GetStats(uint8_t dir, CAN_GW_STATS * stats)
+        {
+            if ((dir >= GW_N_DIRS) || (stats == nullptr))
+            {
+                return MCP2515_FAIL;
+            }
+            *stats = Stats[dir];
+            stats->dropped = Queue[dir].Overflows;
+            stats->queue_hwm = Queue[dir].HighWater;
+            return MCP2515_OK;
+        }
+
+        /**
+         * Reset statistics of both directions.
+         *
+         *  \return None.
+         */
+        void ResetStats(void)
+        {
+            for (uint8_t dir = 0; dir < GW_N_DIRS; ++dir)
+            {
+                memset(&Stats[dir], 0, sizeof(Stats[dir]));
+                Queue[dir].Overflows = 0;
+                Queue[dir].HighWater = Queue[dir].Available();
+            }
+        }
+
+    private:
+        /// Service MCP2515 interrupts (deferred mode or polled Int pin), Tx without Int pin,
+        /// or Tx timeouts and error polls with immediate mode Int pin
+        void ServiceCan(DLK_MCP2515 * can)
+        {
+            can->MCP2515_Service();
+            if (((can->IntPin < 0) && can->MCP2515_TxPending()) ||
+                (((can->IntPin < 0) || !can->IntDeferred) && can->MCP2515_PollDue()))
+            {
+                can->MCP2515_ServiceTx();
+            }
+        }
+
+        /// Move CAN frames received by source MCP2515 of direction into its gateway queue
+        void Receive(uint8_t dir)
+        {
+            DLK_MCP2515 * can = Can[dir];
+            CAN_GW_ENTRY * entry;
+            CAN_FRAME * rx;
+            CAN_FRAME frame;
+            uint8_t status;
+
+            // bounded - CAN frames may keep arriving while receiving
+            for (uint8_t n = 0; n < GW_QUEUE_CNT; ++n)
+            {
+                entry = Queue[dir].Reserve();
+                rx = (entry != nullptr) ? &entry->frame : &frame;
+                if (can->IntPin >= 0)
+                {
+                    status = can->MCP2515_Pop(rx);
+                }
+                else
+                {
+                    status = can->MCP2515_Recv(rx);
+                }
+                if (status != MCP2515_OK)
+                {
+                    return;
+                }
+                if ((Routes[dir] != nullptr) && !Routes[dir]->Apply(rx, millis()))
+                {
+                    Stats[dir].filtered++;      // place in gateway queue not used
+                    continue;
+                }
+                if (entry == nullptr)
+                {
+                    Queue[dir].Drop();          // gateway queue full
+                    continue;
+                }
+                entry->us = micros();
+                Queue[dir].Commit();
+            }
+        }
+
+        /// Hand queued CAN frames of direction to destination MCP2515 (up to GW_TX_INFLIGHT)
+        uint8_t Forward(uint8_t dir)
+        {
+            DLK_MCP2515 * can = Can[dir ^ 1];
+            CAN_GW_ENTRY * entry;
+            CAN_GW_ENTRY done;
+            uint8_t pending = can->MCP2515_TxPending();
+            uint8_t cnt = 0;
+            uint8_t status;
+            uint32_t us;
+
+            while ((pending < GW_TX_INFLIGHT) && ((entry = Queue[dir].Peek()) != nullptr))
+            {
+                status = can->MCP2515_SendAsync(&entry->frame);
+                if (status == MCP2515_OK)
+                {
+                    us = micros() - entry->us;
+                    Stats[dir].forwarded++;
+                    Stats[dir].latency_us += us;
+                    if (us > Stats[dir].latency_max_us)
+                    {
+                        Stats[dir].latency_max_us = us;
+                    }
+                    pending++;
+                    cnt++;
+                }
+                else if (status == MCP2515_ALLTXBUSY)
+                {
+                    break;                      // Tx queue full - keep for next Service()
+                }
+                else
+                {
+                    Stats[dir].failed++;        // bus-off or invalid CAN frame
+                }
+                Queue[dir].Pop(&done);
+            }
+            return cnt;
+        }
+
+        /// MCP2515s (indexed by direction they receive for)
+        DLK_MCP2515 * Can[GW_N_DIRS];
+
+        /// routing table of each direction (nullptr = forward all)
+        DLK_CanRoutes * Routes[GW_N_DIRS];
+
+        /// gateway queue of each direction
+        DLK_RingBuffer<CAN_GW_ENTRY, GW_QUEUE_CNT> Queue[GW_N_DIRS];
+
+        /// statistics of each direction ('dropped' and 'queue_hwm' kept by gateway queue)
+        CAN_GW_STATS Stats[GW_N_DIRS];
+};
+
+#endif  // __DLK_CANGATEWAY_H__
@@ -0,0 +1,331 @@
+/** \file DLK_CanRoutes.h */
+/*
+ * NAME: DLK_CanRoutes.h
+ *
+ * WHAT:
+ *  Header file for CAN routing table class (per-ID rules of a CAN gateway direction).
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  The application's table of rules (CAN ID ranges, not overlapping) is compiled once
+ *  at setup into an index sorted by CAN ID, so each CAN frame is looked up with a binary
+ *  search - at most 9 rule compares for \ref ROUTES_MAX 256 rules, whatever the number
+ *  of rules.
+ *
+ *  The rules table is not copied (keep it unchanged while compiled), only the sort index
+ *  and the rate limit state of each rule are kept.
+ *
+ *  Rule actions (ROUTE_xxx flags, applied in this order):
+ *   - ROUTE_BLOCK - CAN frame not forwarded
+ *   - ROUTE_RATE  - at most 'rate_cnt' CAN frames forwarded in each 'rate_ms' interval
+ *   - ROUTE_REMAP - CAN ID replaced ('new_id' for 'first', same offset for rest of range)
+ *   - ROUTE_PATCH - CAN data bits set in 'mask' replaced by 'data' (zero 'data' masks
+ *                   them off)
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_CANROUTES_H__
+#define __DLK_CANROUTES_H__
+
+#include <stdint.h>
+
+#include "can.h"
+
+#define ROUTE_PASS      0x00    // forward CAN frame unchanged
+#define ROUTE_BLOCK     0x01    // do not forward CAN frame
+#define ROUTE_REMAP     0x02    // forward with CAN ID 'new_id' (plus offset in range)
+#define ROUTE_PATCH     0x04    // forward with CAN data bits in 'mask' replaced by 'data'
+#define ROUTE_RATE      0x08    // forward at most 'rate_cnt' CAN frames per 'rate_ms'
+
+// max number of rules in routing table (may be predefined to override)
+#ifndef ROUTES_MAX
+#if defined(__AVR__)
+#define ROUTES_MAX      16
+#else
+#define ROUTES_MAX      256
+#endif
+#endif
+
+/// CAN routing rule (see DLK_CanRoutes::Compile())
+typedef struct can_route
+{
+    /// first CAN ID of range (CAN_EFF_FLAG set for extended CAN IDs)
+    uint32_t first;
+    /// last CAN ID of range (0 = only 'first')
+    uint32_t last;
+    /// ROUTE_xxx actions (ROUTE_PASS = forward unchanged)
+    uint8_t action;
+    /// ROUTE_REMAP: the CAN ID to forward 'first' with (CAN_EFF_FLAG set for extended)
+    uint32_t new_id;
+    /// ROUTE_RATE: max CAN frames forwarded per interval (for whole range)
+    uint16_t rate_cnt;
+    /// ROUTE_RATE: the rate limit interval (mS)
+    uint16_t rate_ms;
+    /// ROUTE_PATCH: the CAN data bits to replace
+    uint8_t mask[8];
+    /// ROUTE_PATCH: the replacement CAN data bits
+    uint8_t data[8];
+} CAN_ROUTE;
+
+/**
+ * CAN routing table (compiled table of per-ID rules).
+ */
+class DLK_CanRoutes
+{
+    static_assert((ROUTES_MAX >= 1) && (ROUTES_MAX <= 32767), "ROUTES_MAX must be 1 to 32767");
+
+    public:
+        DLK_CanRoutes(void)
+        {
+        }
+
+        /**
+         * Compile rules table (sort index for CAN ID lookup).
+         *
+         * \param rules: the rules table (kept in use - not copied)
+         * \param cnt: the number of rules
+         * \param default_action: the action for CAN IDs without a rule (ROUTE_PASS or
+         *                        ROUTE_BLOCK) {optional}
+         *
+         * \return   true = rules table compiled
+         * \return   false = too many rules (\ref ROUTES_MAX), a range ending before its
+         *                   start, overlapping ranges, or a remapped range passing the
+         *                   last CAN ID of its 'new_id' type - no rules used
+         *
+         *  \note Resets the rate limits and counters.
+         */
+        bool Compile(const CAN_ROUTE * rules, uint16_t cnt, uint8_t default_action = ROUTE_PASS)
+        {
+            uint16_t idx;
+            uint16_t j;
+
+            Cnt = 0;
+            Rules = rules;
+            Default = default_action;
+            Blocked = 0;
+            Limited = 0;
+            if ((cnt > ROUTES_MAX) || ((cnt > 0) && (rules == nullptr)))
+            {
+                return false;
+            }
+
+            // insertion sort of rule indexes by first CAN ID (setup only)
+            for (uint16_t i = 0; i < cnt; ++i)
+            {
+                if (LastKey(&rules[i]) < FirstKey(&rules[i]))
+                {
+                    return false;
+                }
+                if ((rules[i].action & ROUTE_REMAP) && !RemapFits(&rules[i]))
+                {
+                    return false;
+                }
+                for (j = i; (j > 0) && (FirstKey(&rules[Order[j - 1]]) > FirstKey(&rules[i])); --j)
+                {
+                    Order[j] = Order[j - 1];
+                }
+                Order[j] = i;
+            }
+            for (uint16_t i = 1; i < cnt; ++i)
+            {
+                if (FirstKey(&rules[Order[i]]) <= LastKey(&rules[Order[i - 1]]))
+                {
+                    return false;               // overlapping ranges
+                }
+            }
+
+            for (idx = 0; idx < cnt; ++idx)
+            {
+                RateStart[idx] = 0;
+                RateCnt[idx] = 0;
+            }
+            Cnt = cnt;
+            return true;
+        }
+
+        /**
+         * Get number of rules compiled.
+         *
+         * \return   uint16_t = the number of rules
+         */
+        uint16_t Count(void) const
+        {
+            return Cnt;
+        }
+
+        /**
+         * Find rule for CAN ID.
+         *
+         * \param can_id: the CAN ID (with EFF/RTR flags)
+         *
+         * \return   CAN_ROUTE * = the rule of the CAN ID range containing \b can_id \n
+         *           nullptr = no rule for \b can_id
+         */
+        const CAN_ROUTE * Find(uint32_t can_id) const
+        {
+            int16_t idx = Lookup(Key(can_id));
+
+            return (idx >= 0) ? &Rules[idx] : nullptr;
+        }
+
+        /**
+         * Apply rule of CAN ID to CAN frame.
+         *
+         * \param frame: the CAN frame (CAN ID and data changed by ROUTE_REMAP/ROUTE_PATCH)
+         * \param now_ms: the current time (mS - millis()) for ROUTE_RATE
+         *
+         * \return   true = forward CAN frame
+         * \return   false = do not forward CAN frame (blocked or over rate limit)
+         */
+        bool Apply(CAN_FRAME * frame, uint32_t now_ms)
+        {
+            uint32_t key = Key(frame->can_id);
+            int16_t idx = Lookup(key);
+            const CAN_ROUTE * rule;
+
+            if (idx < 0)
+            {
+                if (Default & ROUTE_BLOCK)
+                {
+                    Blocked++;
+                    return false;
+                }
+                return true;
+            }
+            rule = &Rules[idx];
+
+            if (rule->action & ROUTE_BLOCK)
+            {
+                Blocked++;
+                return false;
+            }
+            if (rule->action & ROUTE_RATE)
+            {
+                if ((uint32_t)(now_ms - RateStart[idx]) >= rule->rate_ms)
+                {
+                    RateStart[idx] = now_ms;    // new rate limit interval
+                    RateCnt[idx] = 0;
+                }
+                if (RateCnt[idx] >= rule->rate_cnt)
+                {
+                    Limited++;
+                    return false;
+                }
+                RateCnt[idx]++;
+            }
+            if (rule->action & ROUTE_REMAP)
+            {
+                frame->can_id = (rule->new_id + (key - FirstKey(rule))) | (frame->can_id & CAN_RTR_FLAG);
+            }
+            if (rule->action & ROUTE_PATCH)
+            {
+                for (uint8_t i = 0; i < 8; ++i)
+                {
+                    frame->can_data[i] = (frame->can_data[i] & ~rule->mask[i]) | (rule->data[i] & rule->mask[i]);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Get number of CAN frames blocked (ROUTE_BLOCK, or no rule with ROUTE_BLOCK default).
+         *
+         * \return   uint32_t = the number of CAN frames blocked
+         */
+        uint32_t BlockedCount(void) const
+        {
+            return Blocked;
+        }
+
+        /**
+         * Get number of CAN frames over their rate limit (ROUTE_RATE).
+         *
+         * \return   uint32_t = the number of CAN frames not forwarded due to rate limit
+         */
+        uint32_t LimitedCount(void) const
+        {
+            return Limited;
+        }
+
+    private:
+        /// lookup key of CAN ID (standard IDs sort before extended IDs)
+        static uint32_t Key(uint32_t can_id)
+        {
+            return (can_id & CAN_EFF_FLAG) ? ((can_id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (can_id & CAN_SFF_MASK);
+        }
+
+        /// lookup key of first CAN ID of rule
+        static uint32_t FirstKey(const CAN_ROUTE * rule)
+        {
+            return Key(rule->first);
+        }
+
+        /// lookup key of last CAN ID of rule (same CAN ID type as first)
+        static uint32_t LastKey(const CAN_ROUTE * rule)
+        {
+            return (rule->last == 0) ? Key(rule->first) : Key(rule->last | (rule->first & CAN_EFF_FLAG));
+        }
+
+        /// remapped CAN ID range of rule within its 'new_id' CAN ID type
+        static bool RemapFits(const CAN_ROUTE * rule)
+        {
+            uint32_t mask = (rule->new_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK;
+
+            return (LastKey(rule) - FirstKey(rule)) <= (mask - (rule->new_id & mask));
+        }
+
+        /// binary search of sorted rules for rule index of CAN ID range containing 'key'
+        int16_t Lookup(uint32_t key) const
+        {
+            uint16_t lo = 0;
+            uint16_t hi = Cnt;
+            uint16_t mid;
+            const CAN_ROUTE * rule;
+
+            while (lo < hi)
+            {
+                mid = (lo + hi) / 2;
+                rule = &Rules[Order[mid]];
+                if (key < FirstKey(rule))
+                {
+                    hi = mid;
+                }
+                else if (key > LastKey(rule))
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    return (int16_t)Order[mid];
+                }
+            }
+            return -1;
+        }
+
+        /// rules table compiled
+        const CAN_ROUTE * Rules = nullptr;
+
+        /// rule indexes sorted by first CAN ID
+        uint16_t Order[ROUTES_MAX];
+
+        /// number of rules compiled
+        uint16_t Cnt = 0;
+
+        /// action for CAN IDs without a rule
+        uint8_t Default = ROUTE_PASS;
+
+        /// rate limit interval start time of each rule (mS)
+        uint32_t RateStart[ROUTES_MAX];
+
+        /// CAN frames forwarded in rate limit interval of each rule
+        uint16_t RateCnt[ROUTES_MAX];
+
+        /// CAN frames blocked
+        uint32_t Blocked = 0;
+
+        /// CAN frames over their rate limit
+        uint32_t Limited = 0;
+};
+
+#endif  // __DLK_CANROUTES_H__
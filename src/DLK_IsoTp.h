@@ -0,0 +1,623 @@
+/** \file DLK_IsoTp.h */
+/*
+ * NAME: DLK_IsoTp.h
+ *
+ * WHAT:
+ *  Header file for non-blocking ISO 15765-2 (ISO-TP) transport class with several
+ *  simultaneous sessions on one MCP2515.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Event driven - nothing blocks. The application passes each CAN frame it receives
+ *  to Input() (CAN frames of no session are left to the application) and calls Service()
+ *  often from loop() for the Consecutive Frame pacing (STmin) and timeouts. CAN frames
+ *  are sent with MCP2515_SendAsync(), so other CAN traffic runs interleaved.
+ *
+ *  Each session is keyed by its CAN ID pair (Tx CAN ID, Rx CAN ID), normal addressing,
+ *  CAN frames padded to 8 bytes with ISOTP_PADDING. A session is half-duplex: a Single
+ *  Frame is always received, but a First Frame received while sending is refused (Flow
+ *  Control overflow).
+ *
+ *  Without an Int line (MCP2515_OnRxInterrupt() or MCP2515_OnRxPoll()), call
+ *  MCP2515_ServiceTx() from loop() as for any MCP2515_SendAsync() usage.
+ *
+ *  See: https://en.wikipedia.org/wiki/ISO_15765-2
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_ISOTP_H__
+#define __DLK_ISOTP_H__
+
+#include <stddef.h>
+
+#include "DLK_MCP2515.h"
+
+// max number of simultaneous sessions (may be predefined to override)
+#ifndef ISOTP_MAX_SESSIONS
+#if defined(__AVR__)
+#define ISOTP_MAX_SESSIONS  2
+#else
+#define ISOTP_MAX_SESSIONS  8
+#endif
+#endif
+
+// max message length of a session (may be predefined to override - up to 4095)
+#ifndef ISOTP_BUF_SIZE
+#if defined(__AVR__)
+#define ISOTP_BUF_SIZE      64
+#else
+#define ISOTP_BUF_SIZE      512
+#endif
+#endif
+
+// Flow Control parameters sent when receiving (may be predefined to override)
+#ifndef ISOTP_BS
+#define ISOTP_BS            0       // Block Size (0 = no further Flow Control)
+#endif
+#ifndef ISOTP_STMIN
+#define ISOTP_STMIN         0       // Separation Time min (0x00-0x7F mS, 0xF1-0xF9 100-900 uS)
+#endif
+
+#define ISOTP_TIMEOUT_MS    1000    // max time without progress (N_As/N_Bs/N_Cs/N_Cr)
+#define ISOTP_MAX_WFT       10      // max Flow Control waits in a row
+#define ISOTP_PADDING       0xCC    // unused CAN data bytes
+
+// Protocol Control Information (PCI) frame types
+#define ISOTP_PCI_SF        0x00    // Single Frame
+#define ISOTP_PCI_FF        0x10    // First Frame
+#define ISOTP_PCI_CF        0x20    // Consecutive Frame
+#define ISOTP_PCI_FC        0x30    // Flow Control frame
+
+// Flow Control flow status
+#define ISOTP_FS_CTS        0       // Continue To Send
+#define ISOTP_FS_WAIT       1       // Wait
+#define ISOTP_FS_OVFLW      2       // Overflow/abort
+
+// session states
+#define ISOTP_IDLE          0
+#define ISOTP_TX_SF         1       // Single Frame to send
+#define ISOTP_TX_FF         2       // First Frame to send
+#define ISOTP_TX_WAIT_FC    3       // waiting for Flow Control
+#define ISOTP_TX_CF         4       // sending Consecutive Frames
+#define ISOTP_RX_CF         5       // receiving Consecutive Frames
+
+// results
+#define ISOTP_OK            0       // message sent (last CAN frame queued for transmission)
+#define ISOTP_FAIL          1       // invalid session or message length
+#define ISOTP_BUSY          2       // session already sending or receiving
+#define ISOTP_TIMEOUT       3       // no progress for ISOTP_TIMEOUT_MS
+#define ISOTP_OVERFLOW      4       // receiver refused message (Flow Control overflow)
+#define ISOTP_ABORTED       5       // invalid Flow Control, too many waits or session closed
+
+#define ISOTP_NO_SESSION    0xFF
+
+/// ISO-TP session
+typedef struct isotp_session
+{
+    /// CAN ID of CAN frames sent (CAN_EFF_FLAG set for extended)
+    uint32_t tx_id;
+    /// CAN ID of CAN frames received (CAN_EFF_FLAG set for extended)
+    uint32_t rx_id;
+    /// session open
+    bool open;
+    /// ISOTP_xxx session state
+    uint8_t state;
+    /// Flow Control frame to send
+    bool fc_pending;
+    /// ISOTP_FS_xxx flow status of Flow Control frame to send
+    uint8_t fc_status;
+    /// next Consecutive Frame sequence number
+    uint8_t seq;
+    /// Block Size of Flow Control received (sending)
+    uint8_t bs;
+    /// Consecutive Frames left in block
+    uint8_t bs_cnt;
+    /// Flow Control waits in a row
+    uint8_t wait_cnt;
+    /// Separation Time min of Flow Control received (uS)
+    uint32_t st_us;
+    /// time next Consecutive Frame may be sent (uS)
+    uint32_t next_us;
+    /// time of last progress (mS)
+    uint32_t timer_ms;
+    /// message length
+    uint16_t len;
+    /// message bytes sent or received
+    uint16_t pos;
+    /// message
+    uint8_t buf[ISOTP_BUF_SIZE];
+} ISOTP_SESSION;
+
+/**
+ * Non-blocking ISO 15765-2 (ISO-TP) transport with several simultaneous sessions.
+ */
+class DLK_IsoTp
+{
+    static_assert((ISOTP_BUF_SIZE >= 8) && (ISOTP_BUF_SIZE <= 4095), "ISOTP_BUF_SIZE must be 8 to 4095");
+    static_assert((ISOTP_MAX_SESSIONS >= 1) && (ISOTP_MAX_SESSIONS < ISOTP_NO_SESSION), "ISOTP_MAX_SESSIONS must be 1 to 254");
+
+    public:
+        /**
+         * \param can: the MCP2515 to send and receive with (after \ref DLK_MCP2515::MCP2515_Init)
+         */
+        DLK_IsoTp(DLK_MCP2515 * can)
+        {
+            Can = can;
+            for (uint8_t i = 0; i < ISOTP_MAX_SESSIONS; ++i)
+            {
+                Sessions[i].open = false;
+            }
+        }
+
+        /**
+         * Open session.
+         *
+         * \param tx_id: the CAN ID to send with (CAN_EFF_FLAG set for extended)
+         * \param rx_id: the CAN ID to receive (CAN_EFF_FLAG set for extended)
+         *
+         * \return   uint8_t = the session number \n
+         *           ISOTP_NO_SESSION = all sessions (\ref ISOTP_MAX_SESSIONS) in use, or
+         *                              \b rx_id already received by another session
+         */
+        uint8_t Open(uint32_t tx_id, uint32_t rx_id)
+        {
+            uint8_t free = ISOTP_NO_SESSION;
+
+            for (uint8_t i = 0; i < ISOTP_MAX_SESSIONS; ++i)
+            {
+                if (!Sessions[i].open)
+                {
+                    if (free == ISOTP_NO_SESSION)
+                    {
+                        free = i;
+                    }
+                }
+                else if (Sessions[i].rx_id == rx_id)
+                {
+                    return ISOTP_NO_SESSION;    // Rx CAN ID already in use
+                }
+            }
+            if (free != ISOTP_NO_SESSION)
+            {
+                memset(&Sessions[free], 0, offsetof(ISOTP_SESSION, buf));     // all but message
+                Sessions[free].tx_id = tx_id;
+                Sessions[free].rx_id = rx_id;
+                Sessions[free].open = true;
+            }
+            return free;
+        }
+
+        /**
+         * Close session (any message being sent or received is dropped).
+         *
+         * \param session: the session number
+         *
+         * \return   ISOTP_FAIL = session not open
+         * \return   ISOTP_OK = session closed
+         */
+        uint8_t Close(uint8_t session)
+        {
+            if (!IsOpen(session))
+            {
+                return ISOTP_FAIL;
+            }
+            Sessions[session].open = false;
+            return ISOTP_OK;
+        }
+
+        /**
+         * Setup callback for messages received.
+         *
+         * \param callback: the application callback function to call with the session number
+         *                  and message (valid during the callback only)
+         *
+         *  \return None.
+         *
+         *  \note The callback may send a reply on the session with \ref Send.
+         */
+        void OnReceive(void (* callback)(uint8_t, uint8_t *, uint16_t))
+        {
+            RxHandler = callback;
+        }
+
+        /**
+         * Setup callback for message send completion.
+         *
+         * \param callback: the application callback function to call with the session number
+         *                  and result (ISOTP_OK, ISOTP_TIMEOUT, ISOTP_OVERFLOW or ISOTP_ABORTED)
+         *
+         *  \return None.
+         */
+        void OnSendDone(void (* callback)(uint8_t, uint8_t))
+        {
+            TxDoneHandler = callback;
+        }
+
+        /**
+         * Send message on session (non-blocking).
+         *
+         * \param session: the session number
+         * \param data: the message (copied)
+         * \param len: the message length (1 to \ref ISOTP_BUF_SIZE)
+         *
+         * \return   ISOTP_FAIL = session not open or invalid \b len
+         * \return   ISOTP_BUSY = session already sending or receiving a message
+         * \return   ISOTP_OK = message sending started (see \ref OnSendDone)
+         */
+        uint8_t Send(uint8_t session, const uint8_t * data, uint16_t len)
+        {
+            ISOTP_SESSION * s;
+
+            if (!IsOpen(session) || (len == 0) || (len > ISOTP_BUF_SIZE))
+            {
+                return ISOTP_FAIL;
+            }
+            s = &Sessions[session];
+            if (s->state != ISOTP_IDLE)
+            {
+                return ISOTP_BUSY;
+            }
+            memcpy(s->buf, data, len);
+            s->len = len;
+            s->pos = 0;
+            s->state = (len <= 7) ? ISOTP_TX_SF : ISOTP_TX_FF;
+            s->timer_ms = millis();
+            ServiceSession(session);
+            return ISOTP_OK;
+        }
+
+        /**
+         * Check if session is sending or receiving a message.
+         *
+         * \param session: the session number
+         *
+         * \return   true = message in progress
+         * \return   false = session idle (or not open)
+         */
+        bool Busy(uint8_t session)
+        {
+            return IsOpen(session) && ((Sessions[session].state != ISOTP_IDLE) || Sessions[session].fc_pending);
+        }
+
+        /**
+         * Process received CAN frame.
+         *
+         * \param frame: the CAN frame received
+         *
+         * \return   true = CAN frame of a session (taken)
+         * \return   false = CAN frame of no session (for the application)
+         */
+        bool Input(CAN_FRAME * frame)
+        {
+            ISOTP_SESSION * s;
+            uint8_t * d = frame->can_data;
+            uint8_t session;
+            uint16_t n;
+
+            for (session = 0; session < ISOTP_MAX_SESSIONS; ++session)
+            {
+                if (Sessions[session].open && (Sessions[session].rx_id == frame->can_id))
+                {
+                    break;
+                }
+            }
+            if (session >= ISOTP_MAX_SESSIONS)
+            {
+                return false;
+            }
+            s = &Sessions[session];
+            if (frame->can_dlc < 1)
+            {
+                return true;                    // no PCI - ignored
+            }
+
+            switch (d[0] & 0xF0)
+            {
+                case ISOTP_PCI_SF:
+                    n = d[0] & 0x0F;
+                    if ((n == 0) || (n > frame->can_dlc - 1))
+                    {
+                        break;                  // invalid length - ignored
+                    }
+                    if (s->state == ISOTP_RX_CF)
+                    {
+                        s->state = ISOTP_IDLE;  // new message ends message being received
+                    }
+                    if (RxHandler != nullptr)
+                    {
+                        RxHandler(session, &d[1], n);
+                    }
+                    break;
+
+                case ISOTP_PCI_FF:
+                    n = ((uint16_t)(d[0] & 0x0F) << 8) | d[1];
+                    if ((frame->can_dlc < 8) || (n < 8))
+                    {
+                        break;                  // invalid length - ignored
+                    }
+                    if ((n > ISOTP_BUF_SIZE) || ((s->state != ISOTP_IDLE) && (s->state != ISOTP_RX_CF)))
+                    {
+                        if (s->state == ISOTP_RX_CF)
+                        {
+                            s->state = ISOTP_IDLE;
+                        }
+                        s->fc_status = ISOTP_FS_OVFLW;  // too long, or busy sending
+                        s->fc_pending = true;
+                        ServiceSession(session);
+                        break;
+                    }
+                    memcpy(s->buf, &d[2], 6);
+                    s->len = n;
+                    s->pos = 6;
+                    s->seq = 1;
+                    s->bs_cnt = ISOTP_BS;
+                    s->state = ISOTP_RX_CF;
+                    s->timer_ms = millis();
+                    s->fc_status = ISOTP_FS_CTS;
+                    s->fc_pending = true;
+                    ServiceSession(session);
+                    break;
+
+                case ISOTP_PCI_CF:
+                    if (s->state != ISOTP_RX_CF)
+                    {
+                        break;                  // not receiving - ignored
+                    }
+                    if ((d[0] & 0x0F) != s->seq)
+                    {
+                        s->state = ISOTP_IDLE;  // wrong sequence number - message dropped
+                        break;
+                    }
+                    n = s->len - s->pos;
+                    if (n > 7)
+                    {
+                        n = 7;
+                    }
+                    if (n > frame->can_dlc - 1)
+                    {
+                        n = frame->can_dlc - 1;
+                    }
+                    memcpy(&s->buf[s->pos], &d[1], n);
+                    s->pos += n;
+                    s->seq = (s->seq + 1) & 0x0F;
+                    s->timer_ms = millis();
+                    if (s->pos >= s->len)
+                    {
+                        s->state = ISOTP_IDLE;
+                        if (RxHandler != nullptr)
+                        {
+                            RxHandler(session, s->buf, s->len);
+                        }
+                    }
+                    else if ((ISOTP_BS > 0) && (--s->bs_cnt == 0))
+                    {
+                        s->bs_cnt = ISOTP_BS;   // end of block - next Flow Control
+                        s->fc_status = ISOTP_FS_CTS;
+                        s->fc_pending = true;
+                        ServiceSession(session);
+                    }
+                    break;
+
+                case ISOTP_PCI_FC:
+                    if ((s->state != ISOTP_TX_WAIT_FC) || (frame->can_dlc < 3))
+                    {
+                        break;                  // not waiting for Flow Control - ignored
+                    }
+                    s->timer_ms = millis();
+                    switch (d[0] & 0x0F)
+                    {
+                        case ISOTP_FS_CTS:
+                            if (s->pos > 6)
+                            {
+                                // next block - Separation Time also after last CF of block
+                                s->next_us = s->next_us - s->st_us + StMinUs(d[2]);
+                            }
+                            else
+                            {
+                                s->next_us = micros();
+                            }
+                            s->bs = d[1];
+                            s->bs_cnt = d[1];
+                            s->st_us = StMinUs(d[2]);
+                            s->wait_cnt = 0;
+                            s->state = ISOTP_TX_CF;
+                            ServiceSession(session);
+                            break;
+
+                        case ISOTP_FS_WAIT:
+                            if (++s->wait_cnt > ISOTP_MAX_WFT)
+                            {
+                                TxDone(session, ISOTP_ABORTED);
+                            }
+                            break;
+
+                        case ISOTP_FS_OVFLW:
+                            TxDone(session, ISOTP_OVERFLOW);
+                            break;
+
+                        default:
+                            TxDone(session, ISOTP_ABORTED);
+                            break;
+                    }
+                    break;
+
+                default:
+                    break;                      // unknown frame type - ignored
+            }
+            return true;
+        }
+
+        /**
+         * Service all sessions (Flow Control and Consecutive Frame sending, timeouts).
+         *  - call often from loop()
+         *
+         * \return   uint8_t = the number of sessions sending or receiving a message
+         */
+        uint8_t Service(void)
+        {
+            uint8_t active = 0;
+
+            for (uint8_t session = 0; session < ISOTP_MAX_SESSIONS; ++session)
+            {
+                if (Sessions[session].open)
+                {
+                    ServiceSession(session);
+                    if (Busy(session))
+                    {
+                        active++;
+                    }
+                }
+            }
+            return active;
+        }
+
+    private:
+        /// Check for valid open session number
+        bool IsOpen(uint8_t session)
+        {
+            return (session < ISOTP_MAX_SESSIONS) && Sessions[session].open;
+        }
+
+        /// Separation Time min (STmin) in uS (reserved values as max 127 mS)
+        static uint32_t StMinUs(uint8_t st_min)
+        {
+            if (st_min <= 0x7F)
+            {
+                return (uint32_t)st_min * 1000;
+            }
+            if ((st_min >= 0xF1) && (st_min <= 0xF9))
+            {
+                return (uint32_t)(st_min - 0xF0) * 100;
+            }
+            return 127000UL;
+        }
+
+        /// End message sending of session and report result
+        void TxDone(uint8_t session, uint8_t result)
+        {
+            Sessions[session].state = ISOTP_IDLE;
+            if (TxDoneHandler != nullptr)
+            {
+                TxDoneHandler(session, result);
+            }
+        }
+
+        /// Queue CAN frame of session with PCI/data bytes 'data' (padded to 8 bytes)
+        bool SendFrame(ISOTP_SESSION * s, const uint8_t * data, uint8_t len)
+        {
+            CAN_FRAME frame;
+
+            frame.can_id = s->tx_id;
+            frame.can_dlc = 8;
+            memcpy(frame.can_data, data, len);
+            memset(&frame.can_data[len], ISOTP_PADDING, 8 - len);
+            return Can->MCP2515_SendAsync(&frame) == MCP2515_OK;
+        }
+
+        /// Send what is due for session (Tx queue full - retried on next Service())
+        void ServiceSession(uint8_t session)
+        {
+            ISOTP_SESSION * s = &Sessions[session];
+            uint8_t data[8];
+            uint16_t n;
+
+            if (s->fc_pending)
+            {
+                data[0] = ISOTP_PCI_FC | s->fc_status;
+                data[1] = ISOTP_BS;
+                data[2] = ISOTP_STMIN;
+                if (SendFrame(s, data, 3))
+                {
+                    s->fc_pending = false;
+                }
+            }
+
+            switch (s->state)
+            {
+                case ISOTP_TX_SF:
+                    data[0] = ISOTP_PCI_SF | (uint8_t)s->len;
+                    memcpy(&data[1], s->buf, s->len);
+                    if (SendFrame(s, data, 1 + s->len))
+                    {
+                        TxDone(session, ISOTP_OK);
+                        return;
+                    }
+                    break;
+
+                case ISOTP_TX_FF:
+                    data[0] = ISOTP_PCI_FF | (uint8_t)(s->len >> 8);
+                    data[1] = (uint8_t)s->len;
+                    memcpy(&data[2], s->buf, 6);
+                    if (SendFrame(s, data, 8))
+                    {
+                        s->pos = 6;
+                        s->seq = 1;
+                        s->timer_ms = millis();
+                        s->state = ISOTP_TX_WAIT_FC;
+                    }
+                    break;
+
+                case ISOTP_TX_CF:
+                    while ((int32_t)(micros() - s->next_us) >= 0)
+                    {
+                        n = s->len - s->pos;
+                        if (n > 7)
+                        {
+                            n = 7;
+                        }
+                        data[0] = ISOTP_PCI_CF | s->seq;
+                        memcpy(&data[1], &s->buf[s->pos], n);
+                        if (!SendFrame(s, data, 1 + n))
+                        {
+                            break;
+                        }
+                        s->pos += n;
+                        s->seq = (s->seq + 1) & 0x0F;
+                        s->timer_ms = millis();
+                        s->next_us = micros() + s->st_us;
+                        if (s->pos >= s->len)
+                        {
+                            TxDone(session, ISOTP_OK);
+                            return;
+                        }
+                        if ((s->bs > 0) && (--s->bs_cnt == 0))
+                        {
+                            s->state = ISOTP_TX_WAIT_FC;    // end of block - wait for Flow Control
+                            break;
+                        }
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+
+            // no progress for ISOTP_TIMEOUT_MS - message dropped
+            if ((s->state != ISOTP_IDLE) && ((millis() - s->timer_ms) >= ISOTP_TIMEOUT_MS))
+            {
+                if (s->state == ISOTP_RX_CF)
+                {
+                    s->state = ISOTP_IDLE;
+                }
+                else
+                {
+                    TxDone(session, ISOTP_TIMEOUT);
+                }
+            }
+        }
+
+        /// MCP2515 to send and receive with
+        DLK_MCP2515 * Can;
+
+        /// sessions
+        ISOTP_SESSION Sessions[ISOTP_MAX_SESSIONS];
+
+        /// application callback for messages received
+        void (* RxHandler)(uint8_t, uint8_t *, uint16_t) = nullptr;
+
+        /// application callback for message send completion
+        void (* TxDoneHandler)(uint8_t, uint8_t) = nullptr;
+};
+
+#endif  // __DLK_ISOTP_H__
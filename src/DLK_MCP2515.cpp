@@ -18,18 +18,118 @@
 #include <SPI.h>
 #include "DLK_MCP2515.h"
 
+// statistics update (nothing if statistics not compiled in)
+#if MCP2515_USE_STATS
+#define MCP2515_STAT_ADD(field, n)  do { Stats.field += (n); } while (0)
+#define MCP2515_STAT_MAX(field, v)  do { if ((v) > Stats.field) { Stats.field = (v); } } while (0)
+#else
+#define MCP2515_STAT_ADD(field, n)  do { } while (0)
+#define MCP2515_STAT_MAX(field, v)  do { } while (0)
+#endif
+
 // outside of DLK_MCP2515 class
 
+// Tx buffer transmit order ranks (TXP * 3 + n - higher rank is transmitted first)
+#define TX_RANK_CNT     ((TXP_P3 + 1) * MCP2515_N_TXBUFFERS)
+#define TX_RANK_START   ((TXP_P2 * MCP2515_N_TXBUFFERS) + TXB2)
+#define TX_RANK_NONE    0xff
+
+// CAN bus speeds (CAN_5KBPS to CAN_1000KBPS) bit rates
+#define BT_SPEED_CNT    CAN_1000KBPS
+static constexpr uint32_t BitRates[BT_SPEED_CNT] PROGMEM =
+{
+    5000, 10000, 20000, 31250, 33333, 40000, 50000, 80000,
+    83333, 95000, 100000, 125000, 200000, 250000, 500000, 1000000
+};
+
+// CAN bus speed CNF3, CNF2, CNF1 register values (in register address order)
+typedef struct bt_cnf
+{
+    uint8_t cnf[3];
+
+    // from bit timing, else from alternate bit timing if not within BT_TOLERANCE_PPM (0s if neither)
+    //  - CNF3 SOF bit set, as in previous fixed 8 MHz settings
+    constexpr bt_cnf(MCP2515_BITTIMING bt, MCP2515_BITTIMING alt) :
+        cnf
+        {
+            (uint8_t)(BT_Ok(bt) ? (bt.cnf3 | SOF_ENABLE) : BT_Ok(alt) ? (alt.cnf3 | SOF_ENABLE) : 0),
+            BT_Ok(bt) ? bt.cnf2 : BT_Ok(alt) ? alt.cnf2 : (uint8_t)0,
+            BT_Ok(bt) ? bt.cnf1 : BT_Ok(alt) ? alt.cnf1 : (uint8_t)0
+        }
+    {
+    }
+
+    static constexpr bool BT_Ok(MCP2515_BITTIMING bt)
+    {
+        return (bt.bitrate != 0) && (bt.error_ppm <= BT_TOLERANCE_PPM) && (bt.error_ppm >= -BT_TOLERANCE_PPM);
+    }
+} BT_CNF;
+
+#define BT_NONE             MCP2515_BITTIMING{ 0, 0, 0, 0, 0, 0 }
+#define BT_SOLVE(osc, n)    BT_CNF(MCP2515_CalcBitTiming(osc, BitRates[n], BT_SAMPLE_POINT, BT_SJW), BT_NONE)
+#define BT_TABLE(osc, alt_1000k)                                                    \
+    {                                                                               \
+        BT_SOLVE(osc, 0),  BT_SOLVE(osc, 1),  BT_SOLVE(osc, 2),  BT_SOLVE(osc, 3),  \
+        BT_SOLVE(osc, 4),  BT_SOLVE(osc, 5),  BT_SOLVE(osc, 6),  BT_SOLVE(osc, 7),  \
+        BT_SOLVE(osc, 8),  BT_SOLVE(osc, 9),  BT_SOLVE(osc, 10), BT_SOLVE(osc, 11), \
+        BT_SOLVE(osc, 12), BT_SOLVE(osc, 13), BT_SOLVE(osc, 14),                    \
+        BT_CNF(MCP2515_CalcBitTiming(osc, BitRates[15], BT_SAMPLE_POINT, BT_SJW), alt_1000k) \
+    }
+
+// CAN bus speed bit timings for 8, 16 and 20 MHz oscillators (calculated at compile time)
+//  - 8 MHz 1Mbps needs 4 TQ per bit (below the 5 TQ minimum) - keep previous fixed setting
+#define BT_OSC_CNT      3
+static constexpr BT_CNF BitTimings[BT_OSC_CNT][BT_SPEED_CNT] PROGMEM =
+{
+    BT_TABLE(8000000, MCP2515_DecodeBitTiming(8000000, 1000000, MCP_8MHz_1000kBPS_CFG1,
+                                              MCP_8MHz_1000kBPS_CFG2, MCP_8MHz_1000kBPS_CFG3)),
+    BT_TABLE(16000000, BT_NONE),
+    BT_TABLE(20000000, BT_NONE)
+};
+
 // define a non-class pointer to DLK_MCP2515 class using private static class variable
 #if (MAX_INTS > 0)
-DLK_MCP2515 * DLK_MCP2515::instance1;
-#if (MAX_INTS > 1)
-DLK_MCP2515 * DLK_MCP2515::instance2;
-#if (MAX_INTS > 2)
-DLK_MCP2515 * DLK_MCP2515::instance3;
-DLK_MCP2515 * DLK_MCP2515::instance4;
-#endif
-#endif
+DLK_MCP2515 * DLK_MCP2515::IntSlot[MAX_INTS];
+uint8_t DLK_MCP2515::IntFreeSlot[MAX_INTS];
+uint8_t DLK_MCP2515::IntFreeCnt = 0;
+uint8_t DLK_MCP2515::IntUsedCnt = 0;
+
+// This *must* be a static function to be used in attachInterrupt()
+//  - one generated per Int line slot N, invokes every MCP2515 sharing the Int line
+template <uint8_t N>
+void DLK_MCP2515::MCP2515_OnInterrupt(void)
+{
+    for (DLK_MCP2515 * mcp = IntSlot[N]; mcp != nullptr; mcp = mcp->IntNext)
+    {
+        mcp->MCP2515_HandleInterrupt();     // invoke class-based handler
+    }
+}
+
+// table of static interrupt handler functions for Int line slots Ns...
+template <uint8_t... Ns>
+struct DLK_MCP2515::IntHandlers
+{
+    static void (* const Isr[sizeof...(Ns)])(void);
+};
+
+template <uint8_t... Ns>
+void (* const DLK_MCP2515::IntHandlers<Ns...>::Isr[sizeof...(Ns)])(void) =
+{
+    &DLK_MCP2515::MCP2515_OnInterrupt<Ns>...
+};
+
+// IntHandlersOf<N>::Table = IntHandlers<0, 1, ... N - 1>
+template <uint8_t N, uint8_t... Ns>
+struct DLK_MCP2515::IntHandlersOf
+{
+    typedef typename IntHandlersOf<N - 1, N - 1, Ns...>::Table Table;
+};
+
+template <uint8_t... Ns>
+struct DLK_MCP2515::IntHandlersOf<0, Ns...>
+{
+    typedef IntHandlers<Ns...> Table;
+};
 #endif
 
 // private static class variable must be initialized outside of class
@@ -42,6 +142,8 @@ bool DLK_MCP2515::SPI0_initted = false;
 bool DLK_MCP2515::SPI1_initted = false;
 #endif
 
+volatile bool DLK_MCP2515::IntsDisabled = false;
+
 #if defined(ESP32)
 SPIClass SPIH = SPIClass(HSPI); // SPI1 appears to be used somewhere and crashes ESP32 code if used here!!!
 #endif
@@ -54,6 +156,7 @@ DLK_MCP2515::DLK_MCP2515(uint32_t spi_speed, uint8_t cs_pin, bool hw_cs_pin, uin
     CS_pin = cs_pin;
     HW_CS_pin = hw_cs_pin;
     WhichSPI = which_spi;
+    SPI_speed = spi_speed;
 
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     HW_CS_pin = false;
@@ -74,37 +177,79 @@ DLK_MCP2515::DLK_MCP2515(uint32_t spi_speed, uint8_t cs_pin, bool hw_cs_pin, uin
         SPI_Settings = spi_settings;
     }
 
-#if (MAX_INTS > 0)
-    instance1 = nullptr;
-#if (MAX_INTS > 1)
-    instance2 = nullptr;
-#if (MAX_INTS > 2)
-    instance3 = nullptr;
-    instance4 = nullptr;
-#endif
-#endif
-#endif
+    MCP2515_InterruptHandler = nullptr;
+    MCP2515_TxDoneHandler = nullptr;
+    MCP2515_ErrorHandler = nullptr;
+    MCP2515_RxOverrunHandler = nullptr;
 }
 
 #if 1
-// Initiate MCP2515 SPI transaction
-inline void DLK_MCP2515::MCP2515_StartSPI(void)
+// Initiate MCP2515 SPI transaction of instruction 'instr' (at register 'reg')
+//  - 'instr' and 'reg' only used for SPI transaction trace
+//  - no beginTransaction() while a DLK_SpiBus service pass holds the SPI transaction
+inline void DLK_MCP2515::MCP2515_StartSPI(uint8_t instr, uint8_t reg)
 {
-    SPI_dev->beginTransaction(SPI_Settings);
+    if (!SpiHeld)
+    {
+        SPI_dev->beginTransaction(SPI_Settings);
+    }
+#if MCP2515_USE_TRACE
+    TraceStart = micros();
+    TraceInstr = instr;
+    TraceReg = reg;
+#else
+    (void)instr;
+    (void)reg;
+#endif
     if (!HW_CS_pin)
     {
         digitalWrite(CS_pin, LOW);
     }
 }
 
-// Terminate MCP2515 SPI transaction
-inline void DLK_MCP2515::MCP2515_EndSPI(void)
+// Terminate MCP2515 SPI transaction of 'bytes' bytes
+//  - counted (and traced) before ending the SPI transaction, while an Int pin
+//    interrupt using the SPI is still held off
+inline void DLK_MCP2515::MCP2515_EndSPI(uint8_t bytes)
 {
     if (!HW_CS_pin)
     {
         digitalWrite(CS_pin, HIGH);
     }
-    SPI_dev->endTransaction();
+    MCP2515_STAT_ADD(spi_transactions, 1);
+    MCP2515_STAT_ADD(spi_bytes, bytes);
+#if MCP2515_USE_TRACE
+    MCP2515_TraceAdd(TraceInstr, TraceReg, bytes, TraceStart);
+#elif !MCP2515_USE_STATS
+    (void)bytes;
+#endif
+    if (!SpiHeld)
+    {
+        SPI_dev->endTransaction();
+    }
+}
+
+// Enter critical section (interrupts disabled) if not already in one
+//  - returns true if critical section entered (must be exited by MCP2515_Unlock())
+inline bool DLK_MCP2515::MCP2515_Lock(void)
+{
+    if (IntsDisabled)
+    {
+        return false;       // already inside interrupt handler or critical section
+    }
+    noInterrupts();
+    IntsDisabled = true;
+    return true;
+}
+
+// Exit critical section entered by MCP2515_Lock()
+inline void DLK_MCP2515::MCP2515_Unlock(bool locked)
+{
+    if (locked)
+    {
+        IntsDisabled = false;
+        interrupts();
+    }
 }
 
 // Read from specified MCP2515 register
@@ -112,7 +257,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadRegister(uint8_t reg)
 {
     uint8_t ret;
 
-    MCP2515_StartSPI();
+    MCP2515_StartSPI(MCP2515_READ, reg);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     SPI_dev->transfer(MCP2515_READ);
     SPI_dev->transfer(reg);
@@ -127,7 +272,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadRegister(uint8_t reg)
     SPI_dev->transfer(spi_txdata, spi_rxdata, sizeof(spi_txdata));
     ret = spi_rxdata[2];
 #endif
-    MCP2515_EndSPI();
+    MCP2515_EndSPI(3);
 
     return ret;
 }
@@ -135,7 +280,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadRegister(uint8_t reg)
 // Read from specified MCP2515 registers
 void DLK_MCP2515::MCP2515_ReadRegisters(uint8_t reg, uint8_t values[], uint8_t cnt)
 {
-    MCP2515_StartSPI();
+    MCP2515_StartSPI(MCP2515_READ, reg);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     SPI_dev->transfer(MCP2515_READ);
     SPI_dev->transfer(reg);
@@ -145,8 +290,8 @@ void DLK_MCP2515::MCP2515_ReadRegisters(uint8_t reg, uint8_t values[], uint8_t c
     SPI_dev->transfer(values, cnt);
 #else
 
-    uint8_t spi_txdata[11];
-    uint8_t spi_rxdata[11];
+    uint8_t spi_txdata[2 + SPI_BURST_MAX];
+    uint8_t spi_rxdata[2 + SPI_BURST_MAX];
 
     spi_txdata[0] = MCP2515_READ;
     spi_txdata[1] = reg;
@@ -154,13 +299,13 @@ void DLK_MCP2515::MCP2515_ReadRegisters(uint8_t reg, uint8_t values[], uint8_t c
     SPI_dev->transfer(spi_txdata, spi_rxdata, cnt + 2);
     memcpy(values, &spi_rxdata[2], cnt);
 #endif
-    MCP2515_EndSPI();
+    MCP2515_EndSPI(2 + cnt);
 }
 
 // Write specified value to specified MCP2515 register
 void DLK_MCP2515::MCP2515_WriteRegister(uint8_t reg, uint8_t val)
 {
-    MCP2515_StartSPI();
+    MCP2515_StartSPI(MCP2515_WRITE, reg);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     SPI_dev->transfer(MCP2515_WRITE);
     SPI_dev->transfer(reg);
@@ -173,7 +318,7 @@ void DLK_MCP2515::MCP2515_WriteRegister(uint8_t reg, uint8_t val)
     spi_data[2] = val;
     SPI_dev->transfer(spi_data, nullptr, sizeof(spi_data));
 #endif
-    MCP2515_EndSPI();
+    MCP2515_EndSPI(3);
 }
 
 // Write specified values to starting at specified MCP2515 register
@@ -181,27 +326,27 @@ void DLK_MCP2515::MCP2515_WriteRegisters(uint8_t reg, uint8_t vals[], uint8_t cn
 {
     if (cnt)
     {
-        MCP2515_StartSPI();
+        MCP2515_StartSPI(MCP2515_WRITE, reg);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
         SPI_dev->transfer(MCP2515_WRITE);
         SPI_dev->transfer(reg);
         SPI_dev->transfer(vals, cnt);
 #else
-        uint8_t spi_data[11];
+        uint8_t spi_data[2 + SPI_BURST_MAX];
 
         spi_data[0] = MCP2515_WRITE;
         spi_data[1] = reg;
         memcpy(&spi_data[2], vals, cnt);
         SPI_dev->transfer(spi_data, nullptr, cnt + 2);
 #endif
-        MCP2515_EndSPI();
+        MCP2515_EndSPI(2 + cnt);
     }
 }
 
 // Modify specified MCP2515 register with specified mask and specified data
 void DLK_MCP2515::MCP2515_ModifyRegister(uint8_t reg, uint8_t mask, uint8_t data)
 {
-    MCP2515_StartSPI();
+    MCP2515_StartSPI(MCP2515_BITMOD, reg);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     SPI_dev->transfer(MCP2515_BITMOD);
     SPI_dev->transfer(reg);
@@ -216,7 +361,7 @@ void DLK_MCP2515::MCP2515_ModifyRegister(uint8_t reg, uint8_t mask, uint8_t data
     spi_data[3] = data;
     SPI_dev->transfer(spi_data, nullptr, sizeof(spi_data));
 #endif
-    MCP2515_EndSPI();
+    MCP2515_EndSPI(4);
 }
 
 // Check if specified MCP2515 register is writable
@@ -276,12 +421,43 @@ uint8_t DLK_MCP2515::MCP2515_CheckRegisterWritable(uint8_t reg)
 }
 
 // Reset MCP2515
+//  - waits for CANSTAT to report Configuration mode with CANCTRL at its reset value,
+//    instead of a fixed 10 mS delay
 void DLK_MCP2515::MCP2515_Reset(void)
 {
-    MCP2515_StartSPI();
+    uint8_t regs[2];
+    uint32_t start;
+
+    MCP2515_StartSPI(MCP2515_RESET, 0);
     SPI_dev->transfer(MCP2515_RESET);
-    MCP2515_EndSPI();
-    delay(10);
+    MCP2515_EndSPI(1);
+
+    start = micros();
+    do
+    {
+        MCP2515_ReadRegisters(MCP2515_CANSTAT, regs, 2);    // CANSTAT, CANCTRL
+        if (((regs[0] & MODE_MASK) == MODE_CONFIG) && (regs[1] == CANCTRL_RESET))
+        {
+            break;
+        }
+    } while ((micros() - start) < RESET_TIMEOUT_US);
+}
+
+// Wait until MCP2515 operation mode (CANSTAT OPMOD) is 'mode', up to 'timeout_us' uS
+bool DLK_MCP2515::MCP2515_WaitMode(uint8_t mode, uint32_t timeout_us)
+{
+    uint32_t start;
+
+    start = micros();
+    do
+    {
+        if ((MCP2515_ReadRegister(MCP2515_CANSTAT) & MODE_MASK) == mode)
+        {
+            return true;
+        }
+    } while ((micros() - start) < timeout_us);
+
+    return false;
 }
 
 // Read and return MCP2515 Status
@@ -289,7 +465,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadStatus(void)
 {
     uint8_t ret;
 
-    MCP2515_StartSPI();
+    MCP2515_StartSPI(MCP2515_READ_STATUS, 0);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     SPI_dev->transfer(MCP2515_READ_STATUS);
     ret = SPI_dev->transfer(SPI_DUMMY_BYTE);
@@ -302,7 +478,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadStatus(void)
     SPI_dev->transfer(spi_txdata, spi_rxdata, sizeof(spi_txdata));
     ret = spi_rxdata[1];
 #endif
-    MCP2515_EndSPI();
+    MCP2515_EndSPI(2);
 
     return ret;
 }
@@ -312,7 +488,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadRxStatus(void)
 {
     uint8_t ret;
 
-    MCP2515_StartSPI();
+    MCP2515_StartSPI(MCP2515_RX_STATUS, 0);
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
     SPI_dev->transfer(MCP2515_RX_STATUS);
     ret = SPI_dev->transfer(SPI_DUMMY_BYTE);
@@ -325,7 +501,7 @@ uint8_t DLK_MCP2515::MCP2515_ReadRxStatus(void)
     SPI_dev->transfer(spi_txdata, spi_rxdata, sizeof(spi_txdata));
     ret = spi_rxdata[1];
 #endif
-    MCP2515_EndSPI();
+    MCP2515_EndSPI(2);
 
     return ret;
 }
@@ -334,13 +510,19 @@ uint8_t DLK_MCP2515::MCP2515_ReadRxStatus(void)
 uint8_t DLK_MCP2515::MCP2515_SetMode(uint8_t newMode)
 {
     uint8_t wakeIntEnabled;
+    uint8_t mode;
+
+    mode = MCP2515_ReadRegister(MCP2515_CANSTAT) & MODE_MASK;
+    if (mode == newMode)
+    {
+        return MCP2515_OK;      // already in mode - no mode change wait
+    }
 
     // If the chip is asleep and we want to change mode, then a manual wake needs to be done
     // This is done by setting the wake up interrupt flag
     // This undocumented trick was found at:
     //      https://github.com/mkleemann/can/blob/master/can_sleep_mcp2515.c
-    if (((MCP2515_ReadRegister(MCP2515_CANCTRL) & MODE_MASK) == MODE_SLEEP) &&
-         (newMode != MODE_SLEEP))
+    if (mode == MODE_SLEEP)
     {
         // Make sure wake interrupt is enabled
         wakeIntEnabled = (MCP2515_ReadRegister(MCP2515_CANINTE) & MCP2515_WAKIF);
@@ -359,7 +541,7 @@ uint8_t DLK_MCP2515::MCP2515_SetMode(uint8_t newMode)
         // will stay in SLEEP mode instead of automatically switching to LISTENONLY mode.
         // In this situation the mode needs to be manually set to LISTENONLY.
         MCP2515_ModifyRegister(MCP2515_CANCTRL, MODE_MASK, MODE_LISTENONLY);
-        if ((MCP2515_ReadRegister(MCP2515_CANCTRL) & MODE_MASK) != MODE_LISTENONLY)
+        if (!MCP2515_WaitMode(MODE_LISTENONLY, MODE_TIMEOUT_US))
         {
             return MCP2515_SET_MODE_FAIL;
         }
@@ -385,16 +567,12 @@ uint8_t DLK_MCP2515::MCP2515_SetMode(uint8_t newMode)
         MCP2515_ModifyRegister(MCP2515_CANINTE, MCP2515_WAKIF, 0);
     }
 
-    // try multiple times - if need be
-    for (uint8_t i = 0; i < 10; ++i)
+    // request mode, then poll CANSTAT until mode change is done
+    // (may have to wait for end of CAN frame in progress, especially at lower CAN speeds)
+    MCP2515_ModifyRegister(MCP2515_CANCTRL, MODE_MASK, newMode);
+    if (MCP2515_WaitMode(newMode, MODE_TIMEOUT_US))
     {
-        MCP2515_ModifyRegister(MCP2515_CANCTRL, MODE_MASK, newMode);
-        delay(1);           // allow mode change to propagate! (especially at lower CAN speeds)
-
-        if ((MCP2515_ReadRegister(MCP2515_CANCTRL) & MODE_MASK) == newMode)
-        {
-            return MCP2515_OK;
-        }
+        return MCP2515_OK;
     }
     return MCP2515_SET_MODE_FAIL;
 }
@@ -402,114 +580,106 @@ uint8_t DLK_MCP2515::MCP2515_SetMode(uint8_t newMode)
 // Set specified MCP2515 CAN speed
 uint8_t DLK_MCP2515::MCP2515_SetBitrate(uint8_t canSpeed)
 {
-    uint8_t mode;
-    uint8_t rslt;
-    uint8_t cfg1;
-    uint8_t cfg2;
-    uint8_t cfg3;
+    uint8_t cnf[3];
 
-    mode = MCP2515_ReadRegister(MCP2515_CANCTRL) & MODE_MASK;   // get mode
-    rslt = MCP2515_SetMode(MODE_CONFIG);    // must be in Configuration mode to write CNFn registers
-    if (rslt != MCP2515_OK)
+    if (MCP2515_LookupBitTiming(canSpeed, cnf) != MCP2515_OK)
     {
-        return rslt;    // could not set Configuration mode
+        return MCP2515_FAIL;    // CAN speed not possible with oscillator
     }
+    return MCP2515_WriteBitTiming(cnf);
+}
 
-    switch (canSpeed)   // assume 8 Mhz MCP2515 clock
-    {
-        case (CAN_5KBPS):               //   5KBPS
-            cfg1 = MCP_8MHz_5kBPS_CFG1;
-            cfg2 = MCP_8MHz_5kBPS_CFG2;
-            cfg3 = MCP_8MHz_5kBPS_CFG3;
-            break;
+// Set MCP2515 oscillator frequency used for CAN speeds
+//  - oscillator unchanged if it has no CAN speeds table
+uint8_t DLK_MCP2515::MCP2515_SetOscillator(uint32_t osc_hz)
+{
+    uint8_t cnf[3];
+    uint32_t old_hz = OscHz;
 
-        case (CAN_10KBPS):              //  10KBPS
-            cfg1 = MCP_8MHz_10kBPS_CFG1;
-            cfg2 = MCP_8MHz_10kBPS_CFG2;
-            cfg3 = MCP_8MHz_10kBPS_CFG3;
-            break;
+    OscHz = osc_hz;
+    if (MCP2515_LookupBitTiming(CAN_500KBPS, cnf) != MCP2515_OK)
+    {
+        OscHz = old_hz;
+        return MCP2515_FAIL;
+    }
+    return MCP2515_OK;
+}
 
-        case (CAN_20KBPS):              //  20KBPS
-            cfg1 = MCP_8MHz_20kBPS_CFG1;
-            cfg2 = MCP_8MHz_20kBPS_CFG2;
-            cfg3 = MCP_8MHz_20kBPS_CFG3;
-            break;
+// Set specified MCP2515 CAN bit timing
+uint8_t DLK_MCP2515::MCP2515_SetBitTiming(const MCP2515_BITTIMING * bt)
+{
+    uint8_t cnf[3] = { bt->cnf3, bt->cnf2, bt->cnf1 };
 
-        case (CAN_31K25BPS):            //  31.25KBPS
-            cfg1 = MCP_8MHz_31k25BPS_CFG1;
-            cfg2 = MCP_8MHz_31k25BPS_CFG2;
-            cfg3 = MCP_8MHz_31k25BPS_CFG3;
-            break;
+    if (bt->bitrate == 0)
+    {
+        return MCP2515_FAIL;    // no bit timing
+    }
+    return MCP2515_WriteBitTiming(cnf);
+}
 
-        case (CAN_33KBPS):              //  33.333KBPS
-            cfg1 = MCP_8MHz_33k3BPS_CFG1;
-            cfg2 = MCP_8MHz_33k3BPS_CFG2;
-            cfg3 = MCP_8MHz_33k3BPS_CFG3;
-            break;
+// Get MCP2515 CAN bit timing used for specified CAN speed
+uint8_t DLK_MCP2515::MCP2515_GetBitTiming(uint8_t canSpeed, MCP2515_BITTIMING * bt)
+{
+    uint8_t cnf[3];
+    uint32_t rate;
 
-        case (CAN_40KBPS):              //  40Kbps
-            cfg1 = MCP_8MHz_40kBPS_CFG1;
-            cfg2 = MCP_8MHz_40kBPS_CFG2;
-            cfg3 = MCP_8MHz_40kBPS_CFG3;
-            break;
+    if (MCP2515_LookupBitTiming(canSpeed, cnf) != MCP2515_OK)
+    {
+        return MCP2515_FAIL;    // CAN speed not possible with oscillator
+    }
+    memcpy_P(&rate, &BitRates[canSpeed - 1], sizeof(rate));
+    *bt = MCP2515_DecodeBitTiming(OscHz, rate, cnf[2], cnf[1], cnf[0]);
+    return MCP2515_OK;
+}
 
-        case (CAN_50KBPS):              //  50Kbps
-            cfg1 = MCP_8MHz_50kBPS_CFG1;
-            cfg2 = MCP_8MHz_50kBPS_CFG2;
-            cfg3 = MCP_8MHz_50kBPS_CFG3;
-            break;
+// Get CNF3, CNF2, CNF1 register values for CAN speed with MCP2515 oscillator
+uint8_t DLK_MCP2515::MCP2515_LookupBitTiming(uint8_t canSpeed, uint8_t cnf[])
+{
+    uint8_t osc;
 
-        case (CAN_80KBPS):              //  80Kbps
-            cfg1 = MCP_8MHz_80kBPS_CFG1;
-            cfg2 = MCP_8MHz_80kBPS_CFG2;
-            cfg3 = MCP_8MHz_80kBPS_CFG3;
+    switch (OscHz)
+    {
+        case 8000000:
+            osc = 0;
             break;
-
-        case (CAN_100KBPS):             // 100Kbps
-            cfg1 = MCP_8MHz_100kBPS_CFG1;
-            cfg2 = MCP_8MHz_100kBPS_CFG2;
-            cfg3 = MCP_8MHz_100kBPS_CFG3;
+        case 16000000:
+            osc = 1;
             break;
-
-        case (CAN_125KBPS):             // 125Kbps
-            cfg1 = MCP_8MHz_125kBPS_CFG1;
-            cfg2 = MCP_8MHz_125kBPS_CFG2;
-            cfg3 = MCP_8MHz_125kBPS_CFG3;
+        case 20000000:
+            osc = 2;
             break;
-
-        case (CAN_200KBPS):             // 200Kbps
-            cfg1 = MCP_8MHz_200kBPS_CFG1;
-            cfg2 = MCP_8MHz_200kBPS_CFG2;
-            cfg3 = MCP_8MHz_200kBPS_CFG3;
+        default:
+            return MCP2515_FAIL;    // no bit timings for oscillator
             break;
+    }
 
-        case (CAN_250KBPS):             // 250Kbps
-            cfg1 = MCP_8MHz_250kBPS_CFG1;
-            cfg2 = MCP_8MHz_250kBPS_CFG2;
-            cfg3 = MCP_8MHz_250kBPS_CFG3;
-            break;
+    if ((canSpeed < CAN_5KBPS) || (canSpeed > CAN_1000KBPS))
+    {
+        return MCP2515_FAIL;
+    }
 
-        case (CAN_500KBPS):             // 500Kbps
-            cfg1 = MCP_8MHz_500kBPS_CFG1;
-            cfg2 = MCP_8MHz_500kBPS_CFG2;
-            cfg3 = MCP_8MHz_500kBPS_CFG3;
-            break;
+    memcpy_P(cnf, &BitTimings[osc][canSpeed - 1], 3);
+    if (cnf[1] == 0)
+    {
+        return MCP2515_FAIL;    // CAN speed not possible with oscillator
+    }
+    return MCP2515_OK;
+}
 
-        case (CAN_1000KBPS):            //   1Mbps
-            cfg1 = MCP_8MHz_1000kBPS_CFG1;
-            cfg2 = MCP_8MHz_1000kBPS_CFG2;
-            cfg3 = MCP_8MHz_1000kBPS_CFG3;
-            break;
+// Write CNF3, CNF2, CNF1 register values
+uint8_t DLK_MCP2515::MCP2515_WriteBitTiming(uint8_t cnf[])
+{
+    uint8_t mode;
+    uint8_t rslt;
 
-        default:
-            return MCP2515_FAIL;
-            break;
+    mode = MCP2515_ReadRegister(MCP2515_CANCTRL) & MODE_MASK;   // get mode
+    rslt = MCP2515_SetMode(MODE_CONFIG);    // must be in Configuration mode to write CNFn registers
+    if (rslt != MCP2515_OK)
+    {
+        return rslt;    // could not set Configuration mode
     }
 
-    MCP2515_WriteRegister(MCP2515_CNF1, cfg1);
-    MCP2515_WriteRegister(MCP2515_CNF2, cfg2);
-    MCP2515_WriteRegister(MCP2515_CNF3, cfg3);
-//    MCP2515_WriteRegister(MCP2515_CNF3, cfg3 & 0x7f);   // ensure CLKOUT != SOF signal
+    MCP2515_WriteRegisters(MCP2515_CNF3, cnf, 3);  // CNF3, CNF2, CNF1
     // Note: When CLKEN bit is enabled in CANCTRL register (as is default after reset), the
     //       SOF bit in CNF3 register enables outputting SOF signal instead of CLKOUT signal.
 
@@ -653,136 +823,538 @@ void DLK_MCP2515::MCP2515_SetExtMask(uint8_t mask_num, uint32_t mask_id)
     MCP2515_SetMode(mode);          // restore mode
 }
 
-// Initialize MCP2515
-uint8_t DLK_MCP2515::MCP2515_Init(uint8_t canSpeed)
+// Set all MCP2515 masks, filters and Rx buffer operating modes at once
+//  - RXF0 to RXF2 (0x00 - 0x0B), RXF3 to RXF5 (0x10 - 0x1B) and RXM0 to RXM1 (0x20 - 0x27)
+//    are each contiguous, so are written as 3 WRITE bursts in a single Configuration mode entry
+uint8_t DLK_MCP2515::MCP2515_ConfigureAcceptance(const MCP2515_ACCEPTANCE * acc)
 {
+    uint8_t mode;
     uint8_t rslt;
+    uint8_t regs_data[3 * 4];
+    uint8_t n;
 
-   // setup SPI
-#if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266)
-    SPI_dev = &SPI;
-
-    if (!SPI_initted)
-    {
-        SPI_dev->begin();
-        SPI_initted = true;
-    }
-#endif
-
-#ifdef PHILHOWER_RP2040
-    if (WhichSPI == SPI1_NUM)
-    {
-        SPI_dev = &SPI1;        // SPI1
-    }
-    else    // SPI0_NUM
+    mode = MCP2515_ReadRegister(MCP2515_CANCTRL) & MODE_MASK;   // get mode
+    rslt = MCP2515_SetMode(MODE_CONFIG);    // must be in Configuration mode to write Mask and Filter registers
+    if (rslt != MCP2515_OK)
     {
-        SPI_dev = &SPI;         // SPI0
+        return rslt;    // could not set Configuration mode
     }
 
-    if (SPI_dev == &SPI)
+    // RXFnSIDH, RXFnSIDL, RXFnEID8, RXFnEID0 of RXF0 to RXF2, then of RXF3 to RXF5
+    for (n = RXF0; n < MCP2515_N_FILTERS; ++n)
     {
-        if (!SPI0_initted)
+        if (acc->filter_ext & (1 << n))
         {
-            if (HW_CS_pin)
-            {
-                if (!SPI_dev->setCS(CS_pin))
-                {
-                    return MCP2515_FAIL;    // invalid CS pin for SPI port
-                }
-            }
-            SPI_dev->begin(HW_CS_pin);
-            SPI0_initted = true;
+            MCP2515_PrepareExtFilter(&regs_data[(n % 3) * 4], acc->filter[n]);
         }
-    }
-    else if (SPI_dev == &SPI1)
-    {
-        if (!SPI1_initted)
+        else
         {
-            if (HW_CS_pin)
-            {
-                if (!SPI_dev->setCS(CS_pin))
-                {
-                    return MCP2515_FAIL;    // invalid CS pin for SPI port
-                }
-            }
-            SPI_dev->begin(HW_CS_pin);
-            SPI1_initted = true;
+            MCP2515_PrepareId(&regs_data[(n % 3) * 4], acc->filter[n]);
+        }
+        if (n == RXF2)
+        {
+            MCP2515_WriteRegisters(MCP2515_RXF0SIDH, regs_data, 3 * 4);
+        }
+        else if (n == RXF5)
+        {
+            MCP2515_WriteRegisters(MCP2515_RXF3SIDH, regs_data, 3 * 4);
         }
-    }
-#endif
-
-#ifdef ESP32
-    if (WhichSPI == SPI1_NUM)
-    {
-        SPI_dev = &SPIH;        // HSPI
-    }
-    else    // SPI0_NUM
-    {
-        SPI_dev = &SPI;         // VSPI
     }
 
-    if (SPI_dev == &SPI)
+    // RXMnSIDH, RXMnSIDL, RXMnEID8, RXMnEID0 of RXM0 and RXM1
+    for (n = RXM0; n < MCP2515_N_MASKS; ++n)
     {
-        if (!SPI0_initted)
+        if (acc->mask_ext & (1 << n))
         {
-            SPI_dev->begin(SCK, MISO, MOSI, CS_pin);
-            SPI0_initted = true;
+            MCP2515_PrepareExtMask(&regs_data[n * 4], acc->mask[n]);
         }
-    }
-    else if (SPI_dev == &SPIH)
-    {
-        if (!SPI1_initted)
+        else
         {
-            SPI_dev->begin();   // use default HSPI SPI pins
-            SPI1_initted = true;
+            MCP2515_PrepareId(&regs_data[n * 4], acc->mask[n]);
         }
     }
-#endif
+    MCP2515_WriteRegisters(MCP2515_RXM0SIDH, regs_data, MCP2515_N_MASKS * 4);
 
-    if (!HW_CS_pin)
+    MCP2515_ModifyRegister(MCP2515_RXB0CTRL, RXM_MASK, acc->rx_mode[RXB0]);
+    MCP2515_ModifyRegister(MCP2515_RXB1CTRL, RXM_MASK, acc->rx_mode[RXB1]);
+
+    return MCP2515_SetMode(mode);   // restore mode
+}
+
+// Rx acceptance optimizer key of wanted CAN ID 'id' (with CAN_EFF_FLAG if extended)
+//  - extended mask: 29-bit ID, standard mask: ID or SID of extended ID (bits 10:0)
+static uint32_t AccKey(uint32_t id, bool ext_mask)
+{
+    if (ext_mask || !(id & CAN_EFF_FLAG))
     {
-        pinMode(CS_pin, OUTPUT);
-        digitalWrite(CS_pin, HIGH);
+        return id;
     }
+    return (id >> (CAN_EFF_ID_BITS - CAN_SFF_ID_BITS)) | CAN_EFF_FLAG;
+}
 
-    MCP2515_Reset();
+// Number of CAN IDs accepted by filters 'keys' (n) with 'mask' bits
+//  - an extended frame filter with a standard mask does not compare extended ID bits 17:0
+static uint32_t AccCnt(const uint32_t keys[], uint8_t n, bool ext_mask, uint32_t mask)
+{
+    uint8_t bits = __builtin_popcountl(mask & (ext_mask ? CAN_EFF_MASK : CAN_SFF_MASK));
+    uint32_t cnt = 0;
 
-    rslt = MCP2515_SetBitrate(canSpeed);
-    if (rslt != MCP2515_OK)
+    for (uint8_t i = 0; i < n; ++i)
     {
-        return rslt;    // setting bit rate mode change failed
+        cnt += 1UL << (((keys[i] & CAN_EFF_FLAG) ? CAN_EFF_ID_BITS : CAN_SFF_ID_BITS) - bits);
     }
+    return cnt;
+}
 
-    rslt = MCP2515_SetMode(MODE_NORMAL);
-//    rslt = MCP2515_SetMode(MODE_LOOPBACK);  // for communications testing
-    if (rslt != MCP2515_OK)
+// Sorted unique keys (filters) of wanted CAN IDs 'ids' (n) with 'mask' bits
+static uint8_t AccKeys(const uint32_t ids[], uint8_t n, bool ext_mask, uint32_t mask, uint32_t keys[])
+{
+    uint32_t key;
+    uint8_t k = 0;
+    uint8_t i;
+
+    for (uint8_t j = 0; j < n; ++j)
     {
-        return rslt;
+        key = AccKey(ids[j], ext_mask) & (mask | CAN_EFF_FLAG);
+        for (i = k; (i > 0) && (keys[i - 1] > key); --i)    // insertion sort
+        {
+        }
+        if ((i > 0) && (keys[i - 1] == key))
+        {
+            continue;   // duplicate
+        }
+        memmove(&keys[i + 1], &keys[i], (k - i) * sizeof(uint32_t));
+        keys[i] = key;
+        k++;
     }
+    return k;
+}
 
-    // enable Rx rollover from RXB0 to RXB1 when RXB0 is full
-    MCP2515_ModifyRegister(MCP2515_RXB0CTRL, BUKT_BIT, BUKT_BIT);
+// Check if 'key' is one of the sorted keys 'keys' (n)
+static bool AccHasKey(const uint32_t keys[], uint8_t n, uint32_t key)
+{
+    uint8_t lo = 0;
+    uint8_t hi = n;
+    uint8_t mid;
 
-#if 0   // testing
-    // disable all Rx filters to receive any CAN message in either Rx Buffer
-    MCP2515_SetRxMode(RXB0, RXM_M3);
-    MCP2515_SetRxMode(RXB1, RXM_M3);
-#else   // recommended
-    // unmask all Rx filters to receive any CAN message in either Rx Buffer
-    for (uint8_t i = RXM0; i <= RXM1; ++i)
+    while (lo < hi)
     {
-        MCP2515_SetMask(i, MASK_ANY_ID, MASK_ANY_DATA, MASK_ANY_DATA);
+        mid = (lo + hi) / 2;
+        if (keys[mid] < key)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
     }
+    return (lo < n) && (keys[lo] == key);
+}
 
-    // also ensure NO extended frame filters are enabled
-    for (uint8_t i = RXF0; i <= RXF5; ++i)
+// Find mask for wanted CAN IDs 'ids' (n) sharing an Rx buffer with 'cap' filters
+//  - starting with all mask bits, repeatedly drop the mask bit merging the most filters
+//    (keys differing only in that bit), keeping the mask accepting the fewest CAN IDs
+//    with at most 'cap' filters
+//  - extended mask if all extended, else standard mask (a standard frame filter would
+//    compare extended ID mask bits with data bytes)
+//  - returns number of CAN IDs accepted ('keys' is scratch for n keys)
+static uint32_t AccGroup(const uint32_t ids[], uint8_t n, uint8_t cap, uint32_t keys[],
+                         uint32_t * best_mask, bool * ext_mask)
+{
+    uint32_t mask;
+    uint32_t cnt;
+    uint32_t best = 0xffffffff;
+    uint32_t bit;
+    uint32_t drop;
+    uint8_t merges;
+    uint8_t most;
+    uint8_t k;
+
+    *ext_mask = true;
+    for (uint8_t i = 0; i < n; ++i)
     {
-        MCP2515_SetFilter(i, 0, 0, 0);
+        *ext_mask = *ext_mask && (ids[i] & CAN_EFF_FLAG);
     }
-#endif
+    mask = *ext_mask ? CAN_EFF_MASK : CAN_SFF_MASK;
+    *best_mask = mask;
 
-    // enable MCP2515 Rx interrupts (even if not using interrupt ISR - allows polling interrupt pin)
-    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_RX1IF | MCP2515_RX0IF), (MCP2515_RX1IF | MCP2515_RX0IF));
+    while (true)
+    {
+        k = AccKeys(ids, n, *ext_mask, mask, keys);
+        cnt = AccCnt(keys, k, *ext_mask, mask);
+        if ((k <= cap) && (cnt < best))
+        {
+            best = cnt;
+            *best_mask = mask;
+        }
+        if ((mask == 0) || (k == 1))
+        {
+            break;
+        }
+
+        // drop mask bit merging the most filters
+        drop = 0;
+        most = 0;
+        for (bit = 1; bit <= mask; bit <<= 1)
+        {
+            if (!(mask & bit))
+            {
+                continue;
+            }
+            merges = 0;
+            for (uint8_t i = 0; i < k; ++i)
+            {
+                if (!(keys[i] & bit) && AccHasKey(keys, k, keys[i] | bit))
+                {
+                    merges++;
+                }
+            }
+            if ((drop == 0) || (merges > most))
+            {
+                drop = bit;
+                most = merges;
+            }
+        }
+        if ((k <= cap) && (most * 2 <= k))
+        {
+            break;      // fewer filters no longer make up for doubling the CAN IDs per filter
+        }
+        mask &= ~drop;
+    }
+    return best;
+}
+
+// Wanted CAN IDs 'ids' (cnt) of classes 'sel' (bit n = class keys 'cls[n]' with 'cls_mask')
+//  - returns number of wanted CAN IDs stored in 'grp'
+static uint8_t AccClassIds(const uint32_t ids[], uint8_t cnt, const uint32_t cls[], bool cls_ext,
+                           uint32_t cls_mask, uint8_t sel, uint32_t grp[])
+{
+    uint8_t n = 0;
+    uint8_t i;
+
+    for (uint8_t j = 0; j < cnt; ++j)
+    {
+        for (i = 0; (AccKey(ids[j], cls_ext) & (cls_mask | CAN_EFF_FLAG)) != cls[i]; ++i)
+        {
+        }
+        if (sel & (1 << i))
+        {
+            grp[n++] = ids[j];
+        }
+    }
+    return n;
+}
+
+// Calculate MCP2515 masks and filters accepting the fewest unwanted CAN IDs
+/*
+    1) Find a mask for all wanted CAN IDs as if sharing one Rx buffer with 6 filters,
+       giving up to 6 classes of wanted CAN IDs (one per filter)
+    2) Try every split of the classes into RXB0 (up to 2 filters) and RXB1 (up to 4
+       filters), finding the mask of each Rx buffer for its own wanted CAN IDs
+    3) Keep the split accepting the fewest CAN IDs
+
+    Finding a mask repeatedly drops the mask bit merging the most filters, so a few
+    hundred uS on 32-bit MCUs, up to about a second on AVR (for 11-bit CAN IDs).
+*/
+uint8_t DLK_MCP2515::MCP2515_OptimizeAcceptance(const uint32_t ids[], uint8_t cnt,
+                                                MCP2515_ACCEPTANCE * acc,
+                                                MCP2515_ACCEPT_RESULT * result)
+{
+    uint32_t keys[ACC_OPT_MAX_IDS];
+    uint32_t grp[ACC_OPT_MAX_IDS];
+    uint32_t cls[MCP2515_N_FILTERS];
+    uint32_t cls_mask;
+    uint32_t mask[MCP2515_N_MASKS];
+    uint32_t best_mask[MCP2515_N_MASKS];
+    bool ext[MCP2515_N_MASKS];
+    bool best_ext[MCP2515_N_MASKS] = { false, false };
+    bool cls_ext;
+    uint32_t best_cnt = 0xffffffff;
+    uint32_t total;
+    uint8_t best_sel = 0;
+    uint8_t ncls;
+    uint8_t all;
+    uint8_t sel;
+    uint8_t wanted = 0;
+    uint8_t n;
+    uint8_t k;
+    uint8_t i;
+
+    if ((cnt == 0) || (cnt > ACC_OPT_MAX_IDS))
+    {
+        return MCP2515_FAIL;
+    }
+
+    // number of unique wanted CAN IDs
+    for (uint8_t j = 0; j < cnt; ++j)
+    {
+        for (i = 0; (i < j) && (AccKey(ids[i], true) != AccKey(ids[j], true)); ++i)
+        {
+        }
+        wanted += (i == j) ? 1 : 0;
+    }
+
+    // 1) classes of wanted CAN IDs sharing one mask with 6 filters
+    AccGroup(ids, cnt, MCP2515_N_FILTERS, keys, &cls_mask, &cls_ext);
+    ncls = AccKeys(ids, cnt, cls_ext, cls_mask, cls);
+
+    // 2) and 3) best split of classes into RXB0 (sel) and RXB1
+    all = (uint8_t)((1 << ncls) - 1);
+    for (sel = 0; sel <= all; ++sel)
+    {
+        if ((__builtin_popcount(sel) > (RXF1 - RXF0 + 1)) ||
+            ((ncls - __builtin_popcount(sel)) > (RXF5 - RXF2 + 1)))
+        {
+            continue;   // too many filters for Rx buffer
+        }
+
+        total = 0;
+        for (uint8_t m = RXM0; m < MCP2515_N_MASKS; ++m)
+        {
+            // wanted CAN IDs of classes for Rx buffer
+            n = AccClassIds(ids, cnt, cls, cls_ext, cls_mask, (m == RXM0) ? sel : (all & ~sel), grp);
+            if (n != 0)
+            {
+                total += AccGroup(grp, n, (m == RXM0) ? (RXF1 - RXF0 + 1) : (RXF5 - RXF2 + 1),
+                                  keys, &mask[m], &ext[m]);
+            }
+            else
+            {
+                mask[m] = 0;    // no wanted CAN IDs (see below)
+                ext[m] = false;
+            }
+        }
+        if (total < best_cnt)
+        {
+            best_cnt = total;
+            best_sel = sel;
+            memcpy(best_mask, mask, sizeof(mask));
+            memcpy(best_ext, ext, sizeof(ext));
+        }
+    }
+
+    // RXM0 with RXF0, RXF1 and RXM1 with RXF2 to RXF5
+    acc->mask_ext = 0;
+    acc->filter_ext = 0;
+    for (uint8_t m = RXM0; m < MCP2515_N_MASKS; ++m)
+    {
+        uint8_t first = (m == RXM0) ? RXF0 : RXF2;
+        uint8_t last = (m == RXM0) ? RXF1 : RXF5;
+        uint8_t f;
+
+        n = AccClassIds(ids, cnt, cls, cls_ext, cls_mask, (m == RXM0) ? best_sel : (all & ~best_sel), grp);
+        if (n == 0)
+        {
+            // no wanted CAN IDs - only accept a wanted CAN ID exactly (already accepted by other Rx buffer)
+            grp[n++] = ids[0];
+            best_ext[m] = (ids[0] & CAN_EFF_FLAG) != 0;
+            best_mask[m] = best_ext[m] ? CAN_EFF_MASK : CAN_SFF_MASK;
+        }
+
+        // filters from keys (unused filters repeat the first one)
+        k = AccKeys(grp, n, best_ext[m], best_mask[m], keys);
+        for (f = first; f <= last; ++f)
+        {
+            i = (f - first < k) ? (f - first) : 0;
+            if (keys[i] & CAN_EFF_FLAG)
+            {
+                // extended ID (or SID of extended ID for standard mask)
+                acc->filter[f] = best_ext[m] ? (keys[i] & CAN_EFF_MASK) :
+                                 ((keys[i] & CAN_SFF_MASK) << (CAN_EFF_ID_BITS - CAN_SFF_ID_BITS));
+                acc->filter_ext |= (1 << f);
+            }
+            else
+            {
+                acc->filter[f] = keys[i];
+            }
+        }
+        acc->mask[m] = best_mask[m];
+        acc->mask_ext |= best_ext[m] ? (1 << m) : 0;
+        acc->rx_mode[m] = RXM_M0;   // (RXBn number same as RXMn number)
+    }
+
+    if (result != nullptr)
+    {
+        result->accepted = best_cnt;
+        result->false_accepts = best_cnt - wanted;
+        result->false_ratio = (uint16_t)(1000 - ((uint32_t)wanted * 1000) / best_cnt);
+    }
+    return MCP2515_OK;
+}
+
+// Initialize MCP2515
+uint8_t DLK_MCP2515::MCP2515_Init(uint8_t canSpeed)
+{
+    uint8_t cnf[3];
+
+    if (MCP2515_LookupBitTiming(canSpeed, cnf) != MCP2515_OK)
+    {
+        return MCP2515_FAIL;    // CAN speed not possible with oscillator
+    }
+    return MCP2515_InitCnf(cnf);
+}
+
+// Initialize MCP2515 with specified CAN bit timing
+uint8_t DLK_MCP2515::MCP2515_Init(const MCP2515_BITTIMING * bt)
+{
+    uint8_t cnf[3] = { bt->cnf3, bt->cnf2, bt->cnf1 };
+
+    if (bt->bitrate == 0)
+    {
+        return MCP2515_FAIL;    // no bit timing
+    }
+    return MCP2515_InitCnf(cnf);
+}
+
+// Initialize MCP2515 with CNF3, CNF2, CNF1 register values
+uint8_t DLK_MCP2515::MCP2515_InitCnf(uint8_t cnf[])
+{
+    // unmask all Rx filters to receive any CAN message in either Rx Buffer
+    //  - each Rx buffer gets a standard and an extended frame filter, as the filter
+    //    EXIDE bit always selects the frame type (even with masks all don't care)
+    const MCP2515_ACCEPTANCE accept_all =
+    {
+        { MASK_ANY_ID, MASK_ANY_ID },                           // masks all don't care
+        { 0, 0, 0, 0, 0, 0 },
+        0,
+        (1 << RXF1) | (1 << RXF3) | (1 << RXF5),                // extended frame filters
+#if 0   // testing
+        { RXM_M3, RXM_M3 }      // disable all Rx filters to receive any CAN message in either Rx Buffer
+#else   // recommended
+        { RXM_M0, RXM_M0 }
+#endif
+    };
+    uint8_t rslt;
+
+   // setup SPI
+#if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266)
+    SPI_dev = &SPI;
+
+    if (!SPI_initted)
+    {
+        SPI_dev->begin();
+        SPI_initted = true;
+    }
+#endif
+
+#ifdef PHILHOWER_RP2040
+    if (WhichSPI == SPI1_NUM)
+    {
+        SPI_dev = &SPI1;        // SPI1
+    }
+    else    // SPI0_NUM
+    {
+        SPI_dev = &SPI;         // SPI0
+    }
+
+    if (SPI_dev == &SPI)
+    {
+        if (!SPI0_initted)
+        {
+            if (HW_CS_pin)
+            {
+                if (!SPI_dev->setCS(CS_pin))
+                {
+                    return MCP2515_FAIL;    // invalid CS pin for SPI port
+                }
+            }
+            SPI_dev->begin(HW_CS_pin);
+            SPI0_initted = true;
+        }
+    }
+    else if (SPI_dev == &SPI1)
+    {
+        if (!SPI1_initted)
+        {
+            if (HW_CS_pin)
+            {
+                if (!SPI_dev->setCS(CS_pin))
+                {
+                    return MCP2515_FAIL;    // invalid CS pin for SPI port
+                }
+            }
+            SPI_dev->begin(HW_CS_pin);
+            SPI1_initted = true;
+        }
+    }
+#endif
+
+#ifdef ESP32
+    if (WhichSPI == SPI1_NUM)
+    {
+        SPI_dev = &SPIH;        // HSPI
+    }
+    else    // SPI0_NUM
+    {
+        SPI_dev = &SPI;         // VSPI
+    }
+
+    if (SPI_dev == &SPI)
+    {
+        if (!SPI0_initted)
+        {
+            SPI_dev->begin(SCK, MISO, MOSI, CS_pin);
+            SPI0_initted = true;
+        }
+    }
+    else if (SPI_dev == &SPIH)
+    {
+        if (!SPI1_initted)
+        {
+            SPI_dev->begin();   // use default HSPI SPI pins
+            SPI1_initted = true;
+        }
+    }
+#endif
+
+    if (!HW_CS_pin)
+    {
+        pinMode(CS_pin, OUTPUT);
+        digitalWrite(CS_pin, HIGH);
+    }
+
+    MCP2515_Reset();
+    RxB1Older = false;          // Rx buffers reset
+    TxIntsEnabled = false;      // MCP2515 interrupts disabled by reset
+    ErrState = ERR_ACTIVE;      // error counters reset
+    BusOffHold = false;
+    BusOffDelay = 0;
+
+    // discard any asynchronous transmissions (Tx buffers reset)
+    TxQueueCnt = 0;
+    TxBufLoaded = 0;
+    TxBufPreempt = 0;
+    for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        TxBufTxp[i] = TXP_P0;
+    }
+
+    // (still in Configuration mode after reset - set everything before leaving it once)
+    rslt = MCP2515_WriteBitTiming(cnf);
+    if (rslt != MCP2515_OK)
+    {
+        return rslt;    // setting bit rate mode change failed
+    }
+
+    // enable Rx rollover from RXB0 to RXB1 when RXB0 is full
+    MCP2515_ModifyRegister(MCP2515_RXB0CTRL, BUKT_BIT, BUKT_BIT);
+
+    rslt = MCP2515_ConfigureAcceptance(&accept_all);
+    if (rslt != MCP2515_OK)
+    {
+        return rslt;
+    }
+
+    rslt = MCP2515_SetMode(MODE_NORMAL);
+//    rslt = MCP2515_SetMode(MODE_LOOPBACK);  // for communications testing
+    if (rslt != MCP2515_OK)
+    {
+        return rslt;
+    }
+
+    // enable MCP2515 Rx interrupts (even if not using interrupt ISR - allows polling interrupt pin)
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_RX1IF | MCP2515_RX0IF), (MCP2515_RX1IF | MCP2515_RX0IF));
 
     return rslt;
 }
@@ -841,433 +1413,1686 @@ uint8_t DLK_MCP2515::MCP2515_ExtRtrSend(uint32_t id, uint8_t len)
     return MCP2515_SendMessage(&can_data);
 }
 
-// Send specified CAN frame to MCP2515 for CAN transmission
-//  - supports both standard 11-bit and extended 29-bit CAN data frames
-//  - RTR (Remote Transmission Request) supported
-uint8_t DLK_MCP2515::MCP2515_SendMessage(CAN_FRAME * frame)
+// Send specified CAN frame to MCP2515 for CAN transmission
+//  - supports both standard 11-bit and extended 29-bit CAN data frames
+//  - RTR (Remote Transmission Request) supported
+//  - the wait is bounded by a pass count, not millis(), so it also ends when called with
+//    interrupts off (from an immediate mode Rx callback or a Tx done callback)
+//  - fails when a blocking send is already in progress (it would overwrite its result)
+uint8_t DLK_MCP2515::MCP2515_SendMessage(CAN_FRAME * frame)
+{
+    TX_ENTRY entry;
+    uint32_t cnt = 0;
+    bool locked;
+
+    if (frame->can_dlc > CAN_MAX_MESSAGE_LENGTH)
+    {
+        return MCP2515_FAIL;
+    }
+
+    // fail at once while bus-off (instead of waiting for TX_TIMEOUT_MS)
+    MCP2515_ServiceErrors();
+    if (ErrState == ERR_BUSOFF)
+    {
+        return MCP2515_BUS_OFF;
+    }
+
+    // queue CAN frame in transmit order (by CAN ID) with any asynchronous CAN frames
+    //  - never aborts a higher priority CAN frame pending in a Tx buffer
+    entry.key = MCP2515_TxKey(frame, TXP_P0);
+    entry.flags = TX_ENTRY_SYNC;
+    entry.frame = *frame;
+
+    locked = MCP2515_Lock();
+    if (TxSyncResult == TX_RESULT_PENDING)
+    {
+        MCP2515_Unlock(locked);
+        return MCP2515_FAIL;            // nested blocking send (from a callback)
+    }
+    if ((TxQueueCnt + (TxBufPreempt ? 1 : 0)) >= TX_QUEUE_CNT)
+    {
+        MCP2515_Unlock(locked);
+        return MCP2515_ALLTXBUSY;
+    }
+    TxSyncResult = TX_RESULT_PENDING;
+    MCP2515_QueueTx(&entry, false);
+    MCP2515_FillTx();
+    MCP2515_Unlock(locked);
+
+    // Note: In order for the MCP2515 to consider a CAN data transmission to be
+    //       complete, it *must* see a dominant (low) ACK response from some other
+    //       CAN device on the attached CAN bus!
+    //       This other device(s) *must* be operating at the same CAN speed as this
+    //       sending CAN device!
+    //       If no responding CAN device is on the CAN bus when the MCP2515 does a
+    //       transmission, the MCP2515 will continuously forever repeat the transmission 
+    //       until it gets a response or the MCU aborts the transmission. This is considered
+    //       to be an "Acknowledge Error" and results in a TXERR being set in the TBnCTRL[3]
+    //       register for the Tx buffer being transmitted. Error counts will also be
+    //       indicated in the Transmit Error Counter (TEC) and associated error and warning
+    //       bits in the EFLG register.
+
+#if MCP2515_USE_STATS
+    uint32_t wait_start = micros();
+    uint32_t wait_us;
+#endif
+    while (TxSyncResult == TX_RESULT_PENDING)
+    {
+        delayMicroseconds(10);
+        ++cnt;
+
+        // check for transmission complete
+        locked = MCP2515_Lock();
+        MCP2515_HandleTx();
+        if ((TxSyncResult == TX_RESULT_PENDING) && (cnt == TX_WAIT_LOOPS))
+        {
+            // give up on CAN frame still queued behind higher priority CAN frames
+            for (uint8_t i = 0; i < TxQueueCnt; ++i)
+            {
+                if (TxQueue[i].flags & TX_ENTRY_SYNC)
+                {
+                    MCP2515_UnqueueTx(i);
+                    TxSyncResult = MCP2515_FAIL;
+                    MCP2515_STAT_ADD(tx_failures, 1);
+                    MCP2515_STAT_ADD(tx_timeouts, 1);
+                    break;
+                }
+            }
+
+            // or stop its transmission (completed as failed by MCP2515_HandleTx())
+            for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+            {
+                if ((TxBufLoaded & (1 << i)) && (TxBuf[i].flags & TX_ENTRY_SYNC))
+                {
+                    MCP2515_ModifyRegister(MCP2515_TXB0CTRL + (i << 4), TXB_TXREQ_BIT, 0);
+                }
+            }
+        }
+        else if ((TxSyncResult == TX_RESULT_PENDING) && (cnt >= (2 * TX_WAIT_LOOPS)))
+        {
+            // abort not completed - give up waiting, CAN frame completes as asynchronous
+            // (its result must not end a later blocking transmission)
+            for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+            {
+                TxBuf[i].flags &= ~TX_ENTRY_SYNC;
+            }
+            for (uint8_t i = 0; i < TxQueueCnt; ++i)
+            {
+                TxQueue[i].flags &= ~TX_ENTRY_SYNC;
+            }
+            TxSyncResult = MCP2515_FAIL;
+        }
+        MCP2515_Unlock(locked);
+
+        // detect bus-off (aborts the CAN frame) when not reported by error interrupts
+        if ((TxSyncResult == TX_RESULT_PENDING) && ((millis() - ErrPollTime) >= ERR_POLL_MS))
+        {
+            MCP2515_CheckErrors();
+        }
+    }
+#if MCP2515_USE_STATS
+    wait_us = micros() - wait_start;
+    MCP2515_STAT_ADD(send_waits, 1);
+    MCP2515_STAT_ADD(send_wait_us, wait_us);
+    MCP2515_STAT_MAX(send_wait_max_us, wait_us);
+#endif
+
+    if ((TxSyncResult != MCP2515_OK) && (ErrState == ERR_BUSOFF))
+    {
+        return MCP2515_BUS_OFF;
+    }
+    return TxSyncResult;
+}
+
+// Load ID, DLC and CAN data of CAN frame into specified Tx buffer
+//  - single LOAD TX BUFFER instruction transaction starting at TXBnSIDH
+//    (instead of separate ID, DLC and data register writes)
+void DLK_MCP2515::MCP2515_LoadTxBuffer(uint8_t tx_num, CAN_FRAME * frame)
+{
+   /* MCP2515 Registers for Transmitting CAN Frame
+    --------------------------------------------------------------------------------------
+    | TXBnCTRL | TXBnSIDH | TXBnSIDL | TXBnEID8 | TXBnEID0 | TXBnDLC | TXBnD0 ... TXBnD7 |
+    --------------------------------------------------------------------------------------
+               |<---------------- ID/EID ----------------->|<- DLC ->|<----- Data ------>|
+   */
+    const uint8_t loadinstrs[MCP2515_N_TXBUFFERS] = { MCP2515_LOAD_TX0H, MCP2515_LOAD_TX1H, MCP2515_LOAD_TX2H };
+    uint8_t tx_data[MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH + CAN_MAX_DLEN];
+    uint8_t cnt;
+
+    // prepare ID fields
+    if (frame->can_id & CAN_EFF_FLAG)
+    {
+        MCP2515_PrepareExtId(tx_data, frame->can_id);   // Extended frame
+    }
+    else
+    {
+        MCP2515_PrepareId(tx_data, frame->can_id);      // Standard frame
+    }
+
+    // prepare DLC field
+    tx_data[MCP2515_BUF_DLC - MCP2515_BUF_SIDH] = frame->can_dlc;
+    if (frame->can_id & CAN_RTR_FLAG)
+    {
+        tx_data[MCP2515_BUF_DLC - MCP2515_BUF_SIDH] |= MCP2515_RTR_MASK;  // indicate is RTR message
+    }
+
+    // prepare CAN data fields
+    memcpy(&tx_data[MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH], frame->can_data, frame->can_dlc);
+    cnt = (MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH) + frame->can_dlc;
+
+    MCP2515_StartSPI(loadinstrs[tx_num], 0);
+#if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
+    SPI_dev->transfer(loadinstrs[tx_num]);
+    SPI_dev->transfer(tx_data, cnt);
+#else
+    uint8_t spi_data[1 + sizeof(tx_data)];
+
+    spi_data[0] = loadinstrs[tx_num];
+    memcpy(&spi_data[1], tx_data, cnt);
+    SPI_dev->transfer(spi_data, nullptr, cnt + 1);
+#endif
+    MCP2515_EndSPI(1 + cnt);
+}
+
+// Request transmission of specified Tx buffers (bit n = TXBn)
+//  - single RTS instruction byte (instead of TXBnCTRL.TXREQ bit modify per Tx buffer)
+void DLK_MCP2515::MCP2515_RequestToSend(uint8_t tx_bits)
+{
+    uint8_t rts = (uint8_t)((MCP2515_RTS_ALL & ~0x07) | (tx_bits & 0x07));  // RTS Instruction
+
+    MCP2515_StartSPI(rts, 0);
+    SPI_dev->transfer(rts);
+    MCP2515_EndSPI(1);
+}
+
+// Queue specified CAN frame for asynchronous CAN transmission
+uint8_t DLK_MCP2515::MCP2515_SendAsync(CAN_FRAME * frame, uint8_t prio)
+{
+    TX_ENTRY entry;
+    uint8_t rslt = MCP2515_OK;
+    bool locked;
+
+    if (frame->can_dlc > CAN_MAX_MESSAGE_LENGTH)
+    {
+        return MCP2515_FAIL;
+    }
+    if (ErrState == ERR_BUSOFF)
+    {
+        return MCP2515_BUS_OFF;
+    }
+
+    entry.key = MCP2515_TxKey(frame, prio);
+    entry.flags = 0;
+    entry.frame = *frame;
+
+    if (!TxIntsEnabled && (IntPin >= 0))
+    {
+        // refill Tx buffers from interrupt handler on Tx buffer empty interrupts
+        MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_TX2IF | MCP2515_TX1IF | MCP2515_TX0IF),
+                                                (MCP2515_TX2IF | MCP2515_TX1IF | MCP2515_TX0IF));
+        TxIntsEnabled = true;
+    }
+
+    locked = MCP2515_Lock();
+    // (room is kept for re-queue of an aborted lower priority CAN frame)
+    if ((TxQueueCnt + (TxBufPreempt ? 1 : 0)) >= TX_QUEUE_CNT)
+    {
+        rslt = MCP2515_ALLTXBUSY;       // Tx queue full
+    }
+    else
+    {
+        MCP2515_QueueTx(&entry, false);
+        MCP2515_FillTx();
+    }
+    MCP2515_Unlock(locked);
+
+    return rslt;
+}
+
+// Service asynchronous CAN transmissions
+void DLK_MCP2515::MCP2515_ServiceTx(void)
+{
+    bool locked;
+
+    MCP2515_ServiceErrors();
+
+    locked = MCP2515_Lock();
+    MCP2515_HandleTx();
+    MCP2515_Unlock(locked);
+}
+
+// Get number of asynchronous CAN frames not yet completed
+uint8_t DLK_MCP2515::MCP2515_TxPending(void)
+{
+    uint8_t cnt;
+
+    cnt = TxQueueCnt;
+    for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        if (TxBufLoaded & (1 << i))
+        {
+            ++cnt;
+        }
+    }
+    return cnt;
+}
+
+// Setup callback for asynchronous CAN transmission completion
+void DLK_MCP2515::MCP2515_OnTxDone(void (* callback)(CAN_FRAME *, uint8_t))
+{
+    MCP2515_TxDoneHandler = callback;
+}
+
+// Get transmit order key of CAN frame - lowest key is transmitted first
+//  - priority (TXP_P3 first), then CAN bus arbitration order of the CAN ID
+//    (11-bit base ID, standard before extended frame, 18-bit extended ID)
+uint32_t DLK_MCP2515::MCP2515_TxKey(CAN_FRAME * frame, uint8_t prio)
+{
+    uint32_t key;
+
+    if (frame->can_id & CAN_EFF_FLAG)
+    {
+        key = ((frame->can_id & CAN_EFF_MASK) >> 18) << 19;    // base ID
+        key |= (1UL << 18) | (frame->can_id & 0x3ffffUL);       // IDE, extended ID
+    }
+    else
+    {
+        key = (frame->can_id & CAN_SFF_MASK) << 19;
+    }
+    return ((uint32_t)(TXP_P3 - (prio & TXP_MASK)) << 30) | key;
+}
+
+// Insert CAN frame into Tx queue in transmit order
+//  - after queued CAN frames of equal key (queued order), or
+//    ahead of them (re-queue of aborted CAN frame)
+void DLK_MCP2515::MCP2515_QueueTx(TX_ENTRY * entry, bool ahead)
+{
+    uint8_t i = TxQueueCnt;
+
+    while ((i > 0) && ((TxQueue[i - 1].key > entry->key) || (ahead && (TxQueue[i - 1].key == entry->key))))
+    {
+        TxQueue[i] = TxQueue[i - 1];
+        --i;
+    }
+    TxQueue[i] = *entry;
+    ++TxQueueCnt;
+}
+
+// Remove CAN frame from Tx queue
+void DLK_MCP2515::MCP2515_UnqueueTx(uint8_t ndx)
+{
+    --TxQueueCnt;
+    for (uint8_t i = ndx; i < TxQueueCnt; ++i)
+    {
+        TxQueue[i] = TxQueue[i + 1];
+    }
+}
+
+// Select rank of free Tx buffer for CAN frame to be transmitted after Tx buffers
+// ranked 'hi' and higher, and before Tx buffers ranked 'lo' and lower
+//  - ranks at or below TX_RANK_START are preferred (highest first) so that
+//    runs of CAN frames leave the ranks above for higher priority CAN frames
+uint8_t DLK_MCP2515::MCP2515_SelectTxRank(uint8_t freebits, int8_t lo, int8_t hi)
+{
+    int8_t r;
+
+    r = (hi > TX_RANK_START) ? TX_RANK_START : (hi - 1);
+    for ( ; r > lo; --r)
+    {
+        if (freebits & (1 << (r % MCP2515_N_TXBUFFERS)))
+        {
+            return r;
+        }
+    }
+    r = (lo < TX_RANK_START) ? (TX_RANK_START + 1) : (lo + 1);
+    for ( ; r < hi; ++r)
+    {
+        if (freebits & (1 << (r % MCP2515_N_TXBUFFERS)))
+        {
+            return r;
+        }
+    }
+    return TX_RANK_NONE;
+}
+
+// Load queued CAN frames into free Tx buffers, keeping transmit order
+// Note: When several Tx buffers are pending, the MCP2515 transmits the one with
+//       the highest TXP priority first, and the highest buffer number among equal
+//       TXP priorities. Each loaded CAN frame gets a rank (TXP * 3 + n) below the
+//       pending Tx buffers to be transmitted before it and above those to be
+//       transmitted after it. If no free Tx buffer fits, the lowest priority loaded
+//       CAN frame (never one of same or higher priority) is aborted to make room.
+void DLK_MCP2515::MCP2515_FillTx(void)
+{
+    const uint8_t txreqbits[MCP2515_N_TXBUFFERS] = { STAT_TX0REQ, STAT_TX1REQ, STAT_TX2REQ };
+    uint8_t freebits = 0;
+    uint8_t rtsbits = 0;
+    uint8_t status;
+    uint8_t worst;
+    uint8_t rank;
+    uint8_t txn;
+    int8_t lo;
+    int8_t hi;
+
+    if ((TxQueueCnt == 0) || BusOffHold)
+    {
+        return;                         // nothing queued (or held off the CAN bus)
+    }
+
+    // find free Tx buffers (all TXREQ bits from one READ STATUS instruction)
+    status = MCP2515_ReadStatus();
+    for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        if (((TxBufLoaded & (1 << i)) == 0) && ((status & txreqbits[i]) == 0))
+        {
+            freebits |= (1 << i);
+        }
+    }
+
+    while (TxQueueCnt != 0)
+    {
+        // find ranks of loaded CAN frames to be transmitted before (hi) and
+        // after (lo) the next queued CAN frame, and the lowest priority one
+        lo = -1;
+        hi = TX_RANK_CNT;
+        worst = MCP2515_N_TXBUFFERS;
+        for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+        {
+            if ((TxBufLoaded & (1 << i)) == 0)
+            {
+                continue;
+            }
+            if (TxBuf[i].key <= TxQueue[0].key)
+            {
+                if (TxBufRank[i] < hi)
+                {
+                    hi = TxBufRank[i];
+                }
+            }
+            else
+            {
+                if (TxBufRank[i] > lo)
+                {
+                    lo = TxBufRank[i];
+                }
+                if ((worst == MCP2515_N_TXBUFFERS) || (TxBuf[i].key > TxBuf[worst].key) ||
+                    ((TxBuf[i].key == TxBuf[worst].key) && (TxBufRank[i] < TxBufRank[worst])))
+                {
+                    worst = i;
+                }
+            }
+        }
+
+        rank = (freebits != 0) ? MCP2515_SelectTxRank(freebits, lo, hi) : TX_RANK_NONE;
+        if (rank == TX_RANK_NONE)
+        {
+            if ((worst != MCP2515_N_TXBUFFERS) && (TxBufPreempt == 0) && (TxQueueCnt < TX_QUEUE_CNT))
+            {
+                // abort lowest priority loaded CAN frame (re-queued when Tx buffer is free)
+                MCP2515_ModifyRegister(MCP2515_TXB0CTRL + (worst << 4), TXB_TXREQ_BIT, 0);
+                TxBufPreempt = (1 << worst);
+            }
+            break;                      // wait for Tx buffers to drain
+        }
+        txn = rank % MCP2515_N_TXBUFFERS;
+
+        // set TXP priority (only writable while Tx buffer not pending)
+        if (TxBufTxp[txn] != (rank / MCP2515_N_TXBUFFERS))
+        {
+            TxBufTxp[txn] = rank / MCP2515_N_TXBUFFERS;
+            MCP2515_WriteRegister(MCP2515_TXB0CTRL + (txn << 4), TxBufTxp[txn]);
+        }
+
+        TxBuf[txn] = TxQueue[0];
+        MCP2515_UnqueueTx(0);
+        MCP2515_LoadTxBuffer(txn, &TxBuf[txn].frame);
+
+        TxBufRank[txn] = rank;
+        TxBufStart[txn] = millis();
+        TxBufLoaded |= (1 << txn);
+        freebits &= ~(1 << txn);
+        rtsbits |= (1 << txn);
+    }
+
+    if (rtsbits != 0)
+    {
+        // initiate MCP2515 CAN data transmission of all loaded Tx buffers
+        MCP2515_RequestToSend(rtsbits);
+    }
+}
+
+// Report completed and abort timed out CAN frames, then refill Tx buffers
+//  - a loaded Tx buffer no longer pending is completed: successful if its TXnIF
+//    is set, else aborted (re-queued if aborted to make room, else failed)
+void DLK_MCP2515::MCP2515_HandleTx(void)
+{
+    MCP2515_HandleTx(MCP2515_ReadStatus());
+}
+
+// Report completed and abort timed out asynchronous CAN frames, then refill Tx buffers
+//  - 'status' is the READ STATUS already read
+void DLK_MCP2515::MCP2515_HandleTx(uint8_t status)
+{
+    const uint8_t txreqbits[MCP2515_N_TXBUFFERS] = { STAT_TX0REQ, STAT_TX1REQ, STAT_TX2REQ };
+    const uint8_t txifbits[MCP2515_N_TXBUFFERS] = { STAT_TX0IF, STAT_TX1IF, STAT_TX2IF };
+    uint8_t donebits = 0;
+    uint8_t rslt;
+
+    for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        if ((TxBufLoaded & (1 << i)) == 0)
+        {
+            continue;
+        }
+        if (status & txreqbits[i])
+        {
+            if ((millis() - TxBufStart[i]) >= TX_TIMEOUT_MS)
+            {
+                // stop failed MCP2515 CAN data transmission (completed on later service)
+                MCP2515_ModifyRegister(MCP2515_TXB0CTRL + (i << 4), TXB_TXREQ_BIT, 0);
+            }
+            continue;
+        }
+        donebits |= (1 << i);
+    }
+    if (donebits == 0)
+    {
+        MCP2515_FillTx();
+        return;
+    }
+
+    // clear Tx buffer empty interrupts (before any callback can refill Tx buffers)
+    MCP2515_ModifyRegister(MCP2515_CANINTF, (uint8_t)(donebits * MCP2515_TX0IF), 0);
+
+    for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        if ((donebits & (1 << i)) == 0)
+        {
+            continue;
+        }
+        rslt = (status & txifbits[i]) ? MCP2515_OK : MCP2515_FAIL;
+
+        // Tx buffer kept loaded during callback so it is not refilled
+        if ((rslt != MCP2515_OK) && (TxBufPreempt & (1 << i)))
+        {
+            MCP2515_QueueTx(&TxBuf[i], true);   // aborted to make room - re-queue
+        }
+        else
+        {
+            if (rslt == MCP2515_OK)
+            {
+                MCP2515_STAT_ADD(tx_frames, 1);
+            }
+            else
+            {
+                MCP2515_STAT_ADD(tx_failures, 1);
+                if ((millis() - TxBufStart[i]) >= TX_TIMEOUT_MS)
+                {
+                    MCP2515_STAT_ADD(tx_timeouts, 1);
+                }
+            }
+
+            if (TxBuf[i].flags & TX_ENTRY_SYNC)
+            {
+                TxSyncResult = rslt;
+            }
+            else if (MCP2515_TxDoneHandler != nullptr)
+            {
+                MCP2515_TxDoneHandler(&TxBuf[i].frame, rslt);
+            }
+        }
+        TxBufPreempt &= ~(1 << i);
+        TxBufLoaded &= ~(1 << i);
+    }
+
+    MCP2515_FillTx();
+}
+
+// Prepare ID field data 
+//  - supports standard 11-bit CAN data frames
+void DLK_MCP2515::MCP2515_PrepareId(uint8_t id_data[], uint32_t can_id)
+{
+    uint32_t canid;
+
+    canid = (can_id & CAN_SFF_MASK);
+    id_data[MCP2515_SIDH] = (canid >> 3);
+    id_data[MCP2515_SIDL] = ((canid & 0x07 ) << 5);
+
+    canid = (can_id & 0xffff0000);
+    id_data[MCP2515_EID8] = canid >> 16;    // Data0
+    id_data[MCP2515_EID0] = canid >> 24;    // Data1
+}
+
+// Prepare Extended ID field data 
+//  - supports extended 29-bit CAN data frames
+void DLK_MCP2515::MCP2515_PrepareExtId(uint8_t id_data[], uint32_t can_id)
+{
+    uint32_t canid;
+
+    canid = (can_id & CAN_EFF_MASK);
+
+    id_data[MCP2515_EID0] = (canid & 0xFF);
+    id_data[MCP2515_EID8] = (canid >> 8);
+
+    canid = (can_id >> 16);
+    id_data[MCP2515_SIDL] = (canid & 0x03);
+    id_data[MCP2515_SIDL] += ((canid & 0x1C) << 3);
+    id_data[MCP2515_SIDL] |= MCP2515_RXB_IDE;
+    id_data[MCP2515_SIDH] = (canid >> 5 );
+}
+
+// Receive CAN data from MCP2515
+/*
+    1) Determine if CAN message has been received
+        - RX Status[7:6] or Read Status[1:0]  (either will indicate message available)
+    2) Determine Rx buffer containing CAN message
+    3) Get ID/EID and RTR from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
+    4) Get DLC (and extended RTR) from RXBnDLC
+    5) Get CAN data from RXBnD0 to RXBnD7
+    6) Notify MCP2515 that CAN message has been retrieved
+       (RXnIF in CANINTF register auto-cleared when ~CS raised)
+
+    SPI cost per received 8-byte frame:
+        - RX STATUS (2 bytes) + READ RX BUFFER (1 + 5 + 8 bytes) = 2 transactions, 16 bytes
+        - (previously RX STATUS, READ ID, READ RXBnCTRL, READ DLC, READ data, BIT MODIFY
+           CANINTF = 6 transactions, 28 bytes)
+        - rejected by software filter: RX STATUS + READ RX BUFFER (1 + 5 bytes) = 8 bytes
+        - both Rx buffers full: + READ EFLG (3 bytes) for Rx buffer overruns
+
+    CAN messages rejected by the software filter are skipped (at most RX_DRAIN_MAX).
+*/
+uint8_t DLK_MCP2515::MCP2515_Recv(CAN_FRAME * frame)
+{
+    uint8_t status;
+
+    for (uint8_t i = 0; i < RX_DRAIN_MAX; ++i)
+    {
+        // 1) Determine if CAN message has been received
+        // 2) Determine Rx buffer(s) containing CAN message
+        status = MCP2515_CheckCAN_Rx();
+        if (status == MCP2515_NO_RX_MSG)
+        {
+            return status;
+        }
+        if (status == RXM_RXBOTH_MSG)
+        {
+            // Rx buffers overrun only while both are full
+            MCP2515_CheckRxOverrun(MCP2515_ReadRegister(MCP2515_EFLG));
+        }
+
+        // 3) to 6) Get ID/EID, RTR, DLC and CAN data from oldest Rx buffer (clears RXnIF)
+        if (MCP2515_ReadCAN_Msg(MCP2515_OldestRxBuf(status), frame))
+        {
+            MCP2515_STAT_ADD(rx_frames, 1);
+            return MCP2515_OK;
+        }
+        RxRejects = RxRejects + 1;
+    }
+
+    return MCP2515_NO_RX_MSG;
+}
+
+// 1) Determine if CAN message has been received
+// 2) Determine Rx buffer(s) containing CAN message
+//  - returns RXM_RXB0_MSG, RXM_RXB1_MSG, RXM_RXBOTH_MSG or MCP2515_NO_RX_MSG
+uint8_t DLK_MCP2515::MCP2515_CheckCAN_Rx(void)
+{
+    uint8_t status;
+
+#if 1
+    status = MCP2515_ReadRxStatus() & RXMS_MASK;      // get RX Status
+#else
+    // get Read Status (RX1IF, RX0IF moved to RX Status[7:6] positions)
+    status = (uint8_t)((MCP2515_ReadStatus() & (STAT_RX1IF | STAT_RX0IF)) << 6);
+#endif
+    if (status == RXM_NO_MSG)
+    {
+        return MCP2515_NO_RX_MSG;
+    }
+    return status;
+}
+
+// Select Rx buffer holding the oldest CAN message for Rx status 'status'
+//  - with rollover (BUKT) a CAN message only goes into RXB1 when RXB0 is full, so
+//    RXB0 holds the older one, unless RXB0 was read (and refilled) while RXB1 stayed full
+uint8_t DLK_MCP2515::MCP2515_OldestRxBuf(uint8_t status)
+{
+    uint8_t rx_num;
+
+    if (status == RXM_RXBOTH_MSG)
+    {
+        rx_num = RxB1Older ? RXB1 : RXB0;
+        RxB1Older = (rx_num == RXB0);   // CAN message left in RXB1 is older than next one in RXB0
+    }
+    else
+    {
+        rx_num = (status == RXM_RXB1_MSG) ? RXB1 : RXB0;
+        RxB1Older = false;              // other Rx buffer is empty
+    }
+
+    return rx_num;
+}
+
+// 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 field data (includes IDE and SRR bits)
+uint32_t DLK_MCP2515::MCP2515_ParseCAN_ID(const uint8_t id_data[])
+{
+    uint32_t id;
+
+    // accumulate ID
+    id = ((uint32_t)id_data[MCP2515_SIDH] << 3) + (id_data[MCP2515_SIDL] >> 5);
+
+    // accumulate Extended frame ID
+    if (id_data[MCP2515_SIDL] & MCP2515_RXB_IDE)
+    {
+        id = (id << 2) + (id_data[MCP2515_SIDL] & 0x03);
+        id = (id << 8) + id_data[MCP2515_EID8];
+        id = (id << 8) + id_data[MCP2515_EID0];
+        id |= CAN_EFF_FLAG;             // merge in indication is Extended frame
+    }
+    else if (id_data[MCP2515_SIDL] & MCP2515_RXB_SRR)
+    {
+        id |= CAN_RTR_FLAG;             // merge in indication was standard RTR request
+    }
+
+    return id;
+}
+
+// 3) Get ID/EID and RTR from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
+// 4) Get DLC (and extended RTR) from RXBnDLC
+// 5) Get CAN data from RXBnD0 to RXBnD7
+// 6) Notify MCP2515 that CAN message has been retrieved
+//  - all done with a single READ RX BUFFER instruction transaction, which
+//    starts at RXBnSIDH and auto-clears RXnIF in CANINTF when ~CS is raised
+//  - a CAN message rejected by the software filter is dropped after its ID (the
+//    transaction is ended early, still clearing RXnIF)
+bool DLK_MCP2515::MCP2515_ReadCAN_Msg(uint8_t rx_num, CAN_FRAME * frame)
+{
+   /* MCP2515 Registers for Receiving CAN Frame
+    --------------------------------------------------------------------------
+    | RXBnSIDH | RXBnSIDL | RXBnEID8 | RXBnEID0 | RXBnDLC | RXBnD0 ... RXBnD7 |
+    --------------------------------------------------------------------------
+    |<---------------- ID/EID ----------------->|<- DLC ->|<----- Data ------>|
+   */
+    uint8_t instr = (rx_num == RXB1) ? MCP2515_READ_RX1H : MCP2515_READ_RX0H;
+    uint8_t dlc;
+
+    MCP2515_StartSPI(instr, 0);
+#if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
+    uint8_t rx_data[MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH];
+
+    SPI_dev->transfer(instr);
+    memset(rx_data, SPI_DUMMY_BYTE, sizeof(rx_data));   // optional
+    SPI_dev->transfer(rx_data, sizeof(rx_data));        // RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0, RXBnDLC
+
+    // 3) Get ID/EID (and standard RTR from SRR)
+    frame->can_id = MCP2515_ParseCAN_ID(rx_data);
+    if ((SoftFilter != nullptr) && !SoftFilter->Accept(frame->can_id))
+    {
+        MCP2515_EndSPI(1 + sizeof(rx_data));    // raising ~CS clears RXnIF
+        return false;
+    }
+
+    dlc = rx_data[MCP2515_BUF_DLC - MCP2515_BUF_SIDH] & MCP2515_DLC_MASK;
+    if (dlc > CAN_MAX_DLEN)
+    {
+        dlc = CAN_MAX_DLEN;
+    }
+
+    // only clock out the data bytes actually present
+    memset(frame->can_data, SPI_DUMMY_BYTE, dlc);       // optional
+    SPI_dev->transfer(frame->can_data, dlc);
+#else
+    // single fixed-length transfer (keeps HW CS asserted for entire instruction)
+    uint8_t spi_txdata[1 + MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH + CAN_MAX_DLEN];
+    uint8_t spi_rxdata[1 + MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH + CAN_MAX_DLEN];
+    uint8_t * rx_data = &spi_rxdata[1];
+
+    spi_txdata[0] = instr;
+    memset(&spi_txdata[1], SPI_DUMMY_BYTE, sizeof(spi_txdata) - 1);    // optional
+    SPI_dev->transfer(spi_txdata, spi_rxdata, sizeof(spi_txdata));
+
+    dlc = rx_data[MCP2515_BUF_DLC - MCP2515_BUF_SIDH] & MCP2515_DLC_MASK;
+    if (dlc > CAN_MAX_DLEN)
+    {
+        dlc = CAN_MAX_DLEN;
+    }
+    memcpy(frame->can_data, &rx_data[MCP2515_BUF_DATA0 - MCP2515_BUF_SIDH], dlc);
+#endif
+#if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
+    MCP2515_EndSPI(1 + sizeof(rx_data) + dlc);  // raising ~CS clears RXnIF
+#else
+    MCP2515_EndSPI(sizeof(spi_txdata));         // raising ~CS clears RXnIF
+#endif
+
+#if !(defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32))
+    // 3) Get ID/EID (and standard RTR from SRR)
+    frame->can_id = MCP2515_ParseCAN_ID(rx_data);
+    if ((SoftFilter != nullptr) && !SoftFilter->Accept(frame->can_id))
+    {
+        return false;
+    }
+#endif
+
+    // 4) Get DLC (and extended RTR)
+    if ((frame->can_id & CAN_EFF_FLAG) && (rx_data[MCP2515_BUF_DLC - MCP2515_BUF_SIDH] & MCP2515_RTR_MASK))
+    {
+        frame->can_id |= CAN_RTR_FLAG;      // merge in indication was extended RTR request
+    }
+    frame->can_dlc = dlc;
+    frame->can_rxb = rx_num;
+    return true;
+}
+
+// Setup callback for MCP2515 receive interrupts
+// Note: Handling of interrupt callbacks from inside a C++ class is tricky!
+//       The interrupt handler attached to the interrupt pin *must* be a static function
+//       (or a non-class function outside of the class)!
+//       To call the application callback, the 'this' pointer to the current
+//       class object must be saved and in the interrupt handler is used to then call
+//       a class function that is then able to call the application callback function.
+//       See: https://www.onetransistor.eu/2019/05/arduino-class-interrupts-and-callbacks.html
+//       See: https://github.com/adafruit/Adafruit_MCP2515
+//       Note: This is only supported with MAX_INTS Int lines with interrupts!
+//             (a static handler per Int line slot is generated by template MCP2515_OnInterrupt<N>)
+//             Without them (MAX_INTS 0), the Int pin is polled by MCP2515_Service() instead.
+uint8_t DLK_MCP2515::MCP2515_OnRxInterrupt(int int_pin, void (* callback)(CAN_FRAME *), bool deferred)
+{
+#if (MAX_INTS > 0)
+    if (digitalPinToInterrupt(int_pin) == NOT_AN_INTERRUPT)
+    {
+        return MCP2515_INVALID_INT;     // not a valid interrupt pin!
+    }
+
+    // deferred mode - falling edge only (no re-triggering while Int pin held low until serviced)
+    int trigger = deferred ? FALLING : LOW;
+    uint8_t slot;
+
+    MCP2515_DetachInterrupt();          // release any Int line already attached
+
+    // get free Int line slot - reuse a released one, else next never used one
+    if (IntFreeCnt > 0)
+    {
+        slot = IntFreeSlot[--IntFreeCnt];
+    }
+    else if (IntUsedCnt < MAX_INTS)
+    {
+        slot = IntUsedCnt++;
+    }
+    else
+    {
+        return MCP2515_NO_AVAIL_INTS;   // all supported Int lines already in use!
+    }
+
+    // init MCP2515 Int input pin
+    pinMode(int_pin, INPUT_PULLUP);
+
+    // notify SPI driver that SPI operations will be occurring inside an interrupt handler
+    SPI_dev->usingInterrupt(digitalPinToInterrupt(int_pin));
+
+    // disable MCP2515 Rx and error interrupts
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF), 0);
+
+    RxRing.Clear();
+
+    // save the interrupt callback function
+    MCP2515_InterruptHandler = callback;
+    IntPin = int_pin;
+    IntDeferred = deferred;
+    IntPending = false;
+    IntNext = nullptr;
+    IntSlotNum = slot;
+    IntSlot[slot] = this;
+
+    // attach MCP2515 Interrupt pin interrupt to static interrupt handler function of Int line slot
+    attachInterrupt(digitalPinToInterrupt(int_pin), IntHandlersOf<MAX_INTS>::Table::Isr[slot], trigger);
+
+    // clear any pending MCP2515 interrupts
+    MCP2515_WriteRegister(MCP2515_CANINTF, 0);
+
+    // enable MCP2515 Rx and error interrupts
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF),
+                                            (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF));
+
+    return MCP2515_OK;
+#else
+    (void)deferred;                     // polled Int pin is always serviced as in deferred mode
+    return MCP2515_OnRxPoll(int_pin, callback);
+#endif
+}
+
+// Setup callback for MCP2515 receive interrupts on the Int line of another MCP2515
+//  - the MCP2515 Int outputs are wired-OR (open drain) on one Int pin
+uint8_t DLK_MCP2515::MCP2515_ShareRxInterrupt(DLK_MCP2515 * owner, void (* callback)(CAN_FRAME *))
+{
+#if (MAX_INTS > 0)
+    bool locked;
+
+    if ((owner == nullptr) || (owner == this) || (owner->IntSlotNum < 0))
+    {
+        return MCP2515_INVALID_INT;     // no Int line to share!
+    }
+
+    MCP2515_DetachInterrupt();          // release any Int line already attached
+
+    // notify SPI driver that SPI operations will be occurring inside an interrupt handler
+    SPI_dev->usingInterrupt(digitalPinToInterrupt(owner->IntPin));
+
+    // disable MCP2515 Rx and error interrupts
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF), 0);
+
+    RxRing.Clear();
+
+    // save the interrupt callback function
+    MCP2515_InterruptHandler = callback;
+    IntPin = owner->IntPin;
+    IntDeferred = owner->IntDeferred;
+    IntPending = false;
+    IntSlotNum = owner->IntSlotNum;
+
+    // add to MCP2515s serviced by Int line's interrupt handler
+    locked = MCP2515_Lock();
+    IntNext = IntSlot[IntSlotNum];
+    IntSlot[IntSlotNum] = this;
+    MCP2515_Unlock(locked);
+
+    // clear any pending MCP2515 interrupts
+    MCP2515_WriteRegister(MCP2515_CANINTF, 0);
+
+    // enable MCP2515 Rx and error interrupts
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF),
+                                            (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF));
+
+    return MCP2515_OK;
+#else
+    return MCP2515_NO_AVAIL_INTS;       // all supported Int lines already in use!
+#endif
+}
+
+// Setup callback for MCP2515 receive with the Int pin polled by MCP2515_Service()
+//  - no interrupt needed (any digital input pin, and boards without MAX_INTS Int lines)
+//  - a high Int pin costs one pin read per MCP2515_Service() call and no SPI operations
+uint8_t DLK_MCP2515::MCP2515_OnRxPoll(int int_pin, void (* callback)(CAN_FRAME *))
+{
+    if (int_pin < 0)
+    {
+        return MCP2515_INVALID_INT;     // no Int pin to poll!
+    }
+
+    MCP2515_DetachInterrupt();          // release any Int line already attached
+
+    return MCP2515_AttachPolled(int_pin, callback);
+}
+
+// Release MCP2515 interrupts and the Int line attached
+uint8_t DLK_MCP2515::MCP2515_DetachInterrupt(void)
+{
+    if ((IntSlotNum < 0) && (IntPin >= 0))
+    {
+        MCP2515_DetachPolled();         // Int pin polled (no Int line interrupt)
+        return MCP2515_OK;
+    }
+
+#if (MAX_INTS > 0)
+    DLK_MCP2515 ** link;
+    bool locked;
+
+    if (IntSlotNum < 0)
+    {
+        return MCP2515_FAIL;            // no Int line attached
+    }
+
+    // disable all MCP2515 interrupts (asynchronous transmissions now need MCP2515_ServiceTx())
+    MCP2515_WriteRegister(MCP2515_CANINTE, 0);
+    TxIntsEnabled = false;
+
+    // remove from MCP2515s serviced by Int line's interrupt handler
+    locked = MCP2515_Lock();
+    for (link = &IntSlot[IntSlotNum]; *link != nullptr; link = &(*link)->IntNext)
+    {
+        if (*link == this)
+        {
+            *link = IntNext;
+            break;
+        }
+    }
+    if (IntSlot[IntSlotNum] == nullptr)
+    {
+        // last MCP2515 on Int line - release Int line slot
+        detachInterrupt(digitalPinToInterrupt(IntPin));
+        IntFreeSlot[IntFreeCnt++] = IntSlotNum;
+    }
+    MCP2515_Unlock(locked);
+
+    SPI_dev->notUsingInterrupt(digitalPinToInterrupt(IntPin));
+
+    IntSlotNum = -1;
+    IntNext = nullptr;
+    IntPin = -1;
+    IntDeferred = false;
+    IntPending = false;
+
+    return MCP2515_OK;
+#else
+    return MCP2515_FAIL;                // no Int line attached
+#endif
+}
+
+// Get statistics snapshot
+uint8_t DLK_MCP2515::MCP2515_GetStats(MCP2515_STATS * stats)
+{
+#if MCP2515_USE_STATS
+    bool locked;
+
+    locked = MCP2515_Lock();
+    *stats = Stats;
+    MCP2515_Unlock(locked);
+    return MCP2515_OK;
+#else
+    memset(stats, 0, sizeof(MCP2515_STATS));
+    return MCP2515_FAIL;
+#endif
+}
+
+// Reset all statistics to zero
+void DLK_MCP2515::MCP2515_ResetStats(void)
+{
+#if MCP2515_USE_STATS
+    bool locked;
+
+    locked = MCP2515_Lock();
+    memset(&Stats, 0, sizeof(Stats));
+    MCP2515_Unlock(locked);
+#endif
+}
+
+#if MCP2515_USE_TRACE
+// Add entry to SPI transaction trace (oldest entry overwritten when full)
+void DLK_MCP2515::MCP2515_TraceAdd(uint8_t instr, uint8_t reg, uint8_t len, uint32_t start)
+{
+    MCP2515_TRACE_ENTRY * entry;
+    uint32_t dur;
+
+    if (!TraceOn)
+    {
+        return;
+    }
+
+    dur = micros() - start;
+    entry = &Trace[TraceHead];
+    entry->us = start;
+    entry->dur_us = (dur < 0xffff) ? (uint16_t)dur : 0xffff;
+    entry->instr = instr;
+    entry->reg = reg;
+    entry->len = len;
+
+    TraceHead = (TraceHead + 1) & (TRACE_CNT - 1);
+    if (TraceCnt < TRACE_CNT)
+    {
+        ++TraceCnt;
+    }
+}
+#endif
+
+// Start or stop SPI transaction trace
+void DLK_MCP2515::MCP2515_TraceEnable(bool on)
+{
+#if MCP2515_USE_TRACE
+    TraceOn = on;
+#else
+    (void)on;
+#endif
+}
+
+// Add application mark to SPI transaction trace
+void DLK_MCP2515::MCP2515_TraceMark(uint8_t tag)
+{
+#if MCP2515_USE_TRACE
+    bool locked;
+
+    locked = MCP2515_Lock();
+    MCP2515_TraceAdd(TRACE_MARK, tag, 0, micros());
+    MCP2515_Unlock(locked);
+#else
+    (void)tag;
+#endif
+}
+
+// Write SPI transaction trace in binary to 'out', oldest first, then clear it
+/*
+    Header (8 bytes):
+        'M', 'T', TRACE_VERSION, entry size (9), entry count (16-bit), CS pin, 0
+    Entry (9 bytes):
+        start time uS (32-bit), duration uS (16-bit), instruction, register, length
+    - multi-byte values little-endian
+    - tracing paused while writing (SPI transactions meanwhile not traced)
+*/
+uint16_t DLK_MCP2515::MCP2515_TraceDump(Print & out)
+{
+#if MCP2515_USE_TRACE
+    uint8_t buf[9];
+    MCP2515_TRACE_ENTRY entry;
+    uint16_t cnt;
+    uint16_t ndx;
+    bool was_on;
+    bool locked;
+
+    locked = MCP2515_Lock();
+    was_on = TraceOn;
+    TraceOn = false;
+    cnt = TraceCnt;
+    MCP2515_Unlock(locked);
+
+    buf[0] = 'M';
+    buf[1] = 'T';
+    buf[2] = TRACE_VERSION;
+    buf[3] = sizeof(buf);
+    buf[4] = (uint8_t)cnt;
+    buf[5] = (uint8_t)(cnt >> 8);
+    buf[6] = CS_pin;
+    buf[7] = 0;
+    out.write(buf, 8);
+
+    ndx = (TraceHead - cnt) & (TRACE_CNT - 1);
+    for (uint16_t i = 0; i < cnt; ++i)
+    {
+        entry = Trace[ndx];
+        buf[0] = (uint8_t)entry.us;
+        buf[1] = (uint8_t)(entry.us >> 8);
+        buf[2] = (uint8_t)(entry.us >> 16);
+        buf[3] = (uint8_t)(entry.us >> 24);
+        buf[4] = (uint8_t)entry.dur_us;
+        buf[5] = (uint8_t)(entry.dur_us >> 8);
+        buf[6] = entry.instr;
+        buf[7] = entry.reg;
+        buf[8] = entry.len;
+        out.write(buf, sizeof(buf));
+        ndx = (ndx + 1) & (TRACE_CNT - 1);
+    }
+
+    locked = MCP2515_Lock();
+    TraceCnt = 0;
+    TraceOn = was_on;
+    MCP2515_Unlock(locked);
+
+    return cnt;
+#else
+    (void)out;
+    return 0;
+#endif
+}
+
+// Get number of received CAN frames in the Rx ring buffer
+uint8_t DLK_MCP2515::MCP2515_Available(void)
+{
+    return RxRing.Available();
+}
+
+// Retrieve oldest received CAN frame from the Rx ring buffer
+uint8_t DLK_MCP2515::MCP2515_Pop(CAN_FRAME * frame)
+{
+    if (!RxRing.Pop(frame))
+    {
+        return MCP2515_NO_RX_MSG;
+    }
+    return MCP2515_OK;
+}
+
+// Get number of received CAN frames lost due to the Rx ring buffer being full
+//  - re-read until stable, as the interrupt handler may update it mid-read
+uint32_t DLK_MCP2515::MCP2515_RxOverflows(void)
+{
+    uint32_t cnt;
+
+    do
+    {
+        cnt = RxRing.Overflows;
+    } while (cnt != RxRing.Overflows);
+    return cnt;
+}
+
+// Get highest number of CAN frames ever waiting in the Rx ring buffer
+uint8_t DLK_MCP2515::MCP2515_RxHighWater(void)
+{
+    return RxRing.HighWater;
+}
+
+// Get number of MCP2515 Rx buffer overruns
+//  - re-read until stable, as the interrupt handler may update it mid-read
+uint32_t DLK_MCP2515::MCP2515_RxOverruns(uint8_t rx_num)
+{
+    uint32_t cnt;
+
+    if (rx_num >= MCP2515_N_RXBUFFERS)
+    {
+        return 0;
+    }
+    do
+    {
+        cnt = RxOverruns[rx_num];
+    } while (cnt != RxOverruns[rx_num]);
+    return cnt;
+}
+
+// Setup callback for MCP2515 Rx buffer overruns
+void DLK_MCP2515::MCP2515_OnRxOverrun(void (* callback)(uint8_t))
+{
+    MCP2515_RxOverrunHandler = callback;
+}
+
+// Set software acceptance filter for received CAN messages
+void DLK_MCP2515::MCP2515_SetSoftFilter(const DLK_SoftFilter * filt)
+{
+    bool locked;
+
+    locked = MCP2515_Lock();        // (pointer may not be written atomically)
+    SoftFilter = filt;
+    MCP2515_Unlock(locked);
+}
+
+// Get number of received CAN frames rejected by the software filter
+//  - re-read until stable, as the interrupt handler may update it mid-read
+uint32_t DLK_MCP2515::MCP2515_RxRejects(void)
+{
+    uint32_t cnt;
+
+    do
+    {
+        cnt = RxRejects;
+    } while (cnt != RxRejects);
+    return cnt;
+}
+
+// Read MCP2515 error status and update the error state
+//  - TEC (0x1C) to EFLG (0x2D) is a single READ burst, also getting CANSTAT (at 0x1E)
+//    (instead of separate READs of TEC/REC, EFLG and CANSTAT)
+uint8_t DLK_MCP2515::MCP2515_CheckErrors(MCP2515_ERROR_STATUS * err)
 {
-    const uint8_t ctrlregs[MCP2515_N_TXBUFFERS] = { MCP2515_TXB0CTRL, MCP2515_TXB1CTRL, MCP2515_TXB2CTRL };
-    uint16_t cnt = 0;
-    uint8_t id_data[4];
-    uint8_t rslt;
-    uint8_t txb;
+    uint8_t regs[MCP2515_EFLG - MCP2515_TEC + 1];
+    MCP2515_ERROR_STATUS status;
+    bool locked;
 
-    if (frame->can_dlc > CAN_MAX_MESSAGE_LENGTH)
+    static_assert(sizeof(regs) <= SPI_BURST_MAX, "SPI_BURST_MAX too small for TEC to EFLG burst");
+
+    locked = MCP2515_Lock();
+
+    // bus-off recovery hold-off over - rejoin the CAN bus first
+    if (BusOffHold && BusOffAuto && ((millis() - BusOffStart) >= BusOffDelay))
     {
-        return MCP2515_FAIL;
+        MCP2515_RejoinBus();
     }
 
-   /* MCP2515 Registers for Transmitting CAN Frame
-    --------------------------------------------------------------------------------------
-    | TXBnCTRL | TXBnSIDH | TXBnSIDL | TXBnEID8 | TXBnEID0 | TXBnDLC | TXBnD0 ... TXBnD7 |
-    --------------------------------------------------------------------------------------
-               |<---------------- ID/EID ----------------->|<- DLC ->|<----- Data ------>|
-   */
+    MCP2515_ReadRegisters(MCP2515_TEC, regs, sizeof(regs));
+    ErrPollTime = millis();
 
-    // find first non-pending Tx buffer
-    for (uint8_t i = 0; i < MCP2515_N_TXBUFFERS; ++i)
+    status.tec = regs[MCP2515_TEC - MCP2515_TEC];
+    status.rec = regs[MCP2515_REC - MCP2515_TEC];
+    status.eflg = regs[MCP2515_EFLG - MCP2515_TEC];
+    if ((status.eflg & MCP2515_EFLG_TXBO) || BusOffHold)
     {
-        rslt = MCP2515_ReadRegister(ctrlregs[i]);
-        if ((rslt & TXB_TXREQ_BIT) == 0)
-        {
-            txb = ctrlregs[i];      // found non-pending Tx buffer
-            break;
-        }
+        status.state = ERR_BUSOFF;
+    }
+    else if (status.eflg & (MCP2515_EFLG_TXEP | MCP2515_EFLG_RXEP))
+    {
+        status.state = ERR_PASSIVE;
+    }
+    else if (status.eflg & MCP2515_EFLG_EWARN)
+    {
+        status.state = ERR_WARNING;
+    }
+    else
+    {
+        status.state = ERR_ACTIVE;
     }
-    if ((rslt & TXB_TXREQ_BIT) != 0)    // all Tx buffers were pending
+    MCP2515_UpdateErrorState(&status, regs[(MCP2515_CANSTAT + 0x10) - MCP2515_TEC] & MODE_MASK);
+    MCP2515_CheckRxOverrun(status.eflg);
+
+    MCP2515_Unlock(locked);
+
+    if (err != nullptr)
     {
-        txb = ctrlregs[0];          // TX0 buffer - forced
+        *err = status;
     }
+    return status.state;
+}
 
-    // ensure no pending MCP2515 CAN data transmission for this Tx buffer
-    rslt = MCP2515_ReadRegister(txb);
-    if ((rslt & TXB_TXREQ_BIT) != 0)
+// Count and clear Rx buffer overrun flags of EFLG value 'eflg'
+//  - each set flag is at least one lost CAN frame (further ones are not counted
+//    until the flag is cleared)
+void DLK_MCP2515::MCP2515_CheckRxOverrun(uint8_t eflg)
+{
+    uint8_t ovr;
+
+    ovr = eflg & (MCP2515_EFLG_RX1OVR | MCP2515_EFLG_RX0OVR);
+    if (ovr == 0)
     {
-        // force stop pending MCP2515 CAN data transmission
-        MCP2515_ModifyRegister(txb, TXB_TXREQ_BIT, 0);
-        delay(1);
+        return;
     }
+    MCP2515_ModifyRegister(MCP2515_EFLG, ovr, 0);
 
-    // prepare and populate ID fields
-    if (frame->can_id & CAN_EFF_FLAG)
+    if (ovr & MCP2515_EFLG_RX0OVR)
     {
-        MCP2515_PrepareExtId(id_data, frame->can_id);   // Extended frame
+        RxOverruns[RXB0] = RxOverruns[RXB0] + 1;
     }
-    else
+    if (ovr & MCP2515_EFLG_RX1OVR)
     {
-        MCP2515_PrepareId(id_data, frame->can_id);      // Standard frame
+        RxOverruns[RXB1] = RxOverruns[RXB1] + 1;
     }
-    MCP2515_WriteRegisters(txb + MCP2515_BUF_SIDH, id_data, sizeof(id_data));
+    if (MCP2515_RxOverrunHandler != nullptr)
+    {
+        // RX1OVR, RX0OVR moved to bit positions of RXB1, RXB0
+        MCP2515_RxOverrunHandler((uint8_t)(ovr >> 6));
+    }
+}
 
-    // populate DLC field
-    if (frame->can_id & CAN_RTR_FLAG)
+// Update CAN error state from error status (CANSTAT OPMOD 'mode')
+void DLK_MCP2515::MCP2515_UpdateErrorState(MCP2515_ERROR_STATUS * status, uint8_t mode)
+{
+    if (status->state == ErrState)
     {
-        // indicate is RTR message
-        MCP2515_WriteRegister(txb + MCP2515_BUF_DLC, MCP2515_RTR_MASK | frame->can_dlc);
+        return;
     }
-    else    // non-RTR message
+
+    ErrState = status->state;
+    ErrCount[ErrState] = ErrCount[ErrState] + 1;
+    if (ErrState == ERR_BUSOFF)
     {
-        MCP2515_WriteRegister(txb + MCP2515_BUF_DLC, frame->can_dlc);
+        MCP2515_EnterBusOff(mode);
     }
 
-    // populate CAN data fields
-    MCP2515_WriteRegisters(txb + MCP2515_BUF_DATA0, frame->can_data, frame->can_dlc);
+    if (MCP2515_ErrorHandler != nullptr)
+    {
+        MCP2515_ErrorHandler(ErrState, status);
+    }
+}
 
-    // initiate MCP2515 CAN data transmission
-    MCP2515_ModifyRegister(txb, TXB_TXREQ_BIT, TXB_TXREQ_BIT);
-    // Alternative: Send RTS Instruction for specified Tx buffer
-    //              i.e.
-    //              MCP2515_StartSPI();
-    //              SPI_dev->transfer((MCP2515_RTS_TX0 - 1) + (1 << ((txb >> 4) - 3)));    // RTS Instruction
-    //              MCP2515_EndSPI();
+// Abort all CAN transmissions and hold MCP2515 off the CAN bus (in Configuration mode)
+//  - mode change not waited for (may be inside interrupt handler), there is no CAN
+//    frame in progress to wait for when bus-off
+//  - hold-off doubles for each bus-off soon after rejoining the CAN bus
+void DLK_MCP2515::MCP2515_EnterBusOff(uint8_t mode)
+{
+    TX_ENTRY entry;
+    uint32_t now;
 
-    // check for errors
-    rslt = MCP2515_ReadRegister(txb);
-    if ((rslt & (TXB_ABTF_BIT | TXB_MLOA_BIT | TXB_TXERR_BIT)) != 0)
+    now = millis();
+    if ((BusOffDelay != 0) && ((now - BusOffRejoin) < BusOffMaxMs))
     {
-        return MCP2515_FAIL;
+        BusOffDelay = (BusOffDelay * 2 < BusOffMaxMs) ? (BusOffDelay * 2) : BusOffMaxMs;
+    }
+    else
+    {
+        BusOffDelay = BusOffMinMs;
+    }
+    BusOffStart = now;
+    BusOffHold = true;
+    if (mode != MODE_CONFIG)
+    {
+        BusOffMode = mode;
     }
 
-    // Note: In order for the MCP2515 to consider a CAN data transmission to be
-    //       complete, it *must* see a dominant (low) ACK response from some other
-    //       CAN device on the attached CAN bus!
-    //       This other device(s) *must* be operating at the same CAN speed as this
-    //       sending CAN device!
-    //       If no responding CAN device is on the CAN bus when the MCP2515 does a
-    //       transmission, the MCP2515 will continuously forever repeat the transmission 
-    //       until it gets a response or the MCU aborts the transmission. This is considered
-    //       to be an "Acknowledge Error" and results in a TXERR being set in the TBnCTRL[3]
-    //       register for the Tx buffer being transmitted. Error counts will also be
-    //       indicated in the Transmit Error Counter (TEC) and associated error and warning
-    //       bits in the EFLG register.
+    // ABAT clears TXREQ of all Tx buffers (ABAT itself cleared when rejoining)
+    MCP2515_ModifyRegister(MCP2515_CANCTRL, (MODE_MASK | ABORT_TX), (MODE_CONFIG | ABORT_TX));
 
-    while (1)
+    // aborted Tx buffers completed as failed (not re-queued)
+    TxBufPreempt = 0;
+    MCP2515_HandleTx();
+
+    // fail all queued CAN frames (callbacks may not queue more while bus-off)
+    while (TxQueueCnt > 0)
     {
-        // check for transmission complete
-        rslt = MCP2515_ReadRegister(txb);
-        if ((rslt & TXB_TXREQ_BIT) == 0)
+        entry = TxQueue[0];
+        MCP2515_UnqueueTx(0);
+        MCP2515_STAT_ADD(tx_failures, 1);
+        if (entry.flags & TX_ENTRY_SYNC)
         {
-            break;
+            TxSyncResult = MCP2515_FAIL;
         }
-        delayMicroseconds(10);
-        if (++cnt >= 25000)
+        else if (MCP2515_TxDoneHandler != nullptr)
         {
-            // stop failed MCP2515 CAN data transmission
-            MCP2515_ModifyRegister(txb, TXB_TXREQ_BIT, 0);
-
-            return MCP2515_FAIL;
+            MCP2515_TxDoneHandler(&entry.frame, MCP2515_FAIL);
         }
     }
-    // clear TX0 buffer empty interrupt
-    MCP2515_ModifyRegister(MCP2515_CANINTF, MCP2515_TX0IF, 0);
-
-    return MCP2515_OK;
 }
 
-// Prepare ID field data 
-//  - supports standard 11-bit CAN data frames
-void DLK_MCP2515::MCP2515_PrepareId(uint8_t id_data[], uint32_t can_id)
+// Return to the operation mode before bus-off (not waited for)
+//  - the MCP2515 leaves bus-off after 128 occurrences of 11 recessive bits
+void DLK_MCP2515::MCP2515_RejoinBus(void)
 {
-    uint32_t canid;
-
-    canid = (can_id & CAN_SFF_MASK);
-    id_data[MCP2515_SIDH] = (canid >> 3);
-    id_data[MCP2515_SIDL] = ((canid & 0x07 ) << 5);
+    MCP2515_ModifyRegister(MCP2515_CANCTRL, (MODE_MASK | ABORT_TX), BusOffMode);
+    BusOffHold = false;
+    BusOffRejoin = millis();
+}
 
-    canid = (can_id & 0xffff0000);
-    id_data[MCP2515_EID8] = canid >> 16;    // Data0
-    id_data[MCP2515_EID0] = canid >> 24;    // Data1
+// Poll error state when not reported by error interrupts
+//  - no Int line attached (nor Int pin polled), or waiting to leave error warning/passive
+//    or bus-off (the MCP2515 error interrupt is only for entering them)
+void DLK_MCP2515::MCP2515_ServiceErrors(void)
+{
+    if (((IntPin < 0) || (ErrState != ERR_ACTIVE)) &&
+        ((millis() - ErrPollTime) >= ERR_POLL_MS))
+    {
+        MCP2515_CheckErrors();
+    }
 }
 
-// Prepare Extended ID field data 
-//  - supports extended 29-bit CAN data frames
-void DLK_MCP2515::MCP2515_PrepareExtId(uint8_t id_data[], uint32_t can_id)
+// Get CAN error state
+uint8_t DLK_MCP2515::MCP2515_ErrorState(void)
 {
-    uint32_t canid;
+    return ErrState;
+}
 
-    canid = (can_id & CAN_EFF_MASK);
+// Get number of times CAN error state was entered
+//  - re-read until stable, as the interrupt handler may update it mid-read
+uint32_t DLK_MCP2515::MCP2515_ErrorCount(uint8_t state)
+{
+    uint32_t cnt;
 
-    id_data[MCP2515_EID0] = (canid & 0xFF);
-    id_data[MCP2515_EID8] = (canid >> 8);
+    if (state >= ERR_N_STATES)
+    {
+        return 0;
+    }
+    do
+    {
+        cnt = ErrCount[state];
+    } while (cnt != ErrCount[state]);
+    return cnt;
+}
 
-    canid = (can_id >> 16);
-    id_data[MCP2515_SIDL] = (canid & 0x03);
-    id_data[MCP2515_SIDL] += ((canid & 0x1C) << 3);
-    id_data[MCP2515_SIDL] |= MCP2515_RXB_IDE;
-    id_data[MCP2515_SIDH] = (canid >> 5 );
+// Setup callback for CAN error state changes
+void DLK_MCP2515::MCP2515_OnError(void (* callback)(uint8_t, const MCP2515_ERROR_STATUS *))
+{
+    MCP2515_ErrorHandler = callback;
 }
 
-// Receive CAN data from MCP2515
-/*
-    1) Determine if CAN message has been received
-        - RX Status[7:6] or Read Status[1:0]  (either will indicate message available)
-    2) Determine Rx buffer containing CAN message
-    3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
-    4) Get RTR from RXBnCTRL
-    5) Get DLC from RXBnDLC
-    6) Get CAN data from RXBnD0 to RXBnD7
-    7) Notify MCP2515 that CAN message has been retrieved
-       (clear RXnIF in CANINTF register)
-*/
-uint8_t DLK_MCP2515::MCP2515_Recv(CAN_FRAME * frame)
+// Setup bus-off recovery
+void DLK_MCP2515::MCP2515_SetBusOffRecovery(bool auto_recover, uint16_t min_ms, uint16_t max_ms)
 {
-    uint8_t status;
+    bool locked;
 
-    // 1) Determine if CAN message has been received
-    // 2) Determine Rx buffer containing CAN message
-    status = MCP2515_CheckCAN_Rx();
-    switch (status)
-    {
-        case MCP2515_NO_RX_MSG:
-            return status;
+    locked = MCP2515_Lock();
+    BusOffAuto = auto_recover;
+    BusOffMinMs = min_ms;
+    BusOffMaxMs = (max_ms > min_ms) ? max_ms : min_ms;
+    MCP2515_Unlock(locked);
+}
 
-        case RXM_RXB0_MSG:
-            // 3) Get ID/EID from RXB0SIDH, RXB0SIDL, RXB0EID8, RXB0EID0
-            // 4) Get RTR from RXB0CTRL
-            // 5) Get DLC from RXB0DLC
-            // 6) Get CAN data from RXB0D0 to RXB0D7
-            MCP2515_ReadCAN_Msg(MCP2515_RXB0CTRL, frame);
-            // 7) Notify MCP2515 that CAN message has been retrieved
-            MCP2515_ModifyRegister(MCP2515_CANINTF, MCP2515_RX0IF, 0);
-            frame->can_rxb = RXB0;
-            break;
+// Rejoin the CAN bus after bus-off
+uint8_t DLK_MCP2515::MCP2515_RecoverBusOff(void)
+{
+    bool locked;
 
-        case RXM_RXB1_MSG:
-            // 3) Get ID/EID from RXB1SIDH, RXB1SIDL, RXB1EID8, RXB1EID0
-            // 4) Get RTR from RXB1CTRL
-            // 5) Get DLC from RXB1DLC
-            // 6) Get CAN data from RXB1D0 to RXB1D7
-            MCP2515_ReadCAN_Msg(MCP2515_RXB1CTRL, frame);
-            // 7) Notify MCP2515 that CAN message has been retrieved
-            MCP2515_ModifyRegister(MCP2515_CANINTF, MCP2515_RX1IF, 0);
-            frame->can_rxb = RXB1;
-            break;
+    if (!BusOffHold)
+    {
+        return MCP2515_FAIL;
     }
 
+    locked = MCP2515_Lock();
+    MCP2515_RejoinBus();
+    MCP2515_Unlock(locked);
+    MCP2515_CheckErrors();
+
     return MCP2515_OK;
 }
 
-// 1) Determine if CAN message has been received
-// 2) Determine Rx buffer containing CAN message
-uint8_t DLK_MCP2515::MCP2515_CheckCAN_Rx(void)
+// Service MCP2515 interrupts noted by the deferred mode interrupt handler
+//  - runs with interrupts enabled (in deferred mode the interrupt handler does not
+//    touch the Rx ring buffer or the transmit scheduler, so loop() is their only user)
+//  - Int pin still low means more MCP2515 interrupts arrived before all were cleared
+//    (no new falling edge), so also serviced without the pending flag
+//  - also services a polled Int pin (no interrupt - MCP2515_OnRxPoll() or DLK_SpiBus)
+//  - Int pin high: only a due error state poll or asynchronous transmission timeout
+//    needs SPI operations
+void DLK_MCP2515::MCP2515_Service(void)
 {
-    uint8_t status;
-
-#if 1
-    status = MCP2515_ReadRxStatus() & RXMS_MASK;      // get RX Status
-    if (status == RXM_NO_MSG)
-    {
-        return MCP2515_NO_RX_MSG;
-    }
-    else if (status == RXM_RXBOTH_MSG)
-    {
-        return RXM_RXB0_MSG;    // indicate RXB0 when messages in both Rx buffers
-    }
-    return status;
-#else
-    status = MCP2515_ReadStatus() & (STAT_RX1IF | STAT_RX0IF);      // get Read Status
-    if (status == 0)
-    {
-        return MCP2515_NO_RX_MSG;
-    }
-    else if (status & STAT_RX1IF)
+    if (!IntDeferred)
     {
-        return RXM_RXB0_MSG;
+        return;
     }
-    else if (status & STAT_RX0IF)
+    if (!IntPending && (digitalRead(IntPin) != LOW))
     {
-        return RXM_RXB1_MSG;
-    }
-    else
-    {
-        return RXM_RXB0_MSG;    // indicate RXB0 when messages in both Rx buffers
+        if (MCP2515_PollDue())
+        {
+            MCP2515_ServiceTx();
+        }
+        return;
     }
-#endif
+    IntPending = false;
+
+    MCP2515_ProcessInts();
 }
 
-// 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 (includes IDE bit)
-uint32_t DLK_MCP2515::MCP2515_ReadCAN_ID(uint8_t id_addr)
+// Set up MCP2515 servicing by a DLK_SpiBus service pass (or MCP2515_Service() - Int pin only)
+//  - 'int_pin' >= 0: the Int pin level is polled (serviced as in deferred mode, without
+//    an Int pin interrupt)
+//  - 'int_pin' < 0: the Rx/Tx interrupt flags are polled with READ STATUS
+//  - an MCP2515 with an Int line interrupt keeps it (deferred mode only - the interrupt
+//    handler must leave all SPI operations to the service pass)
+uint8_t DLK_MCP2515::MCP2515_AttachPolled(int int_pin, void (* callback)(CAN_FRAME *))
 {
-    uint8_t id_buf[4];
-    uint32_t id;
+    if (IntSlotNum >= 0)
+    {
+        return IntDeferred ? MCP2515_OK : MCP2515_FAIL;
+    }
 
-    // get ID data
-    MCP2515_ReadRegisters(id_addr, id_buf, sizeof(id_buf));  // RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
+    // disable MCP2515 Rx and error interrupts
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF), 0);
 
-    // accumulate ID
-    id = (id_buf[MCP2515_SIDH] << 3) + (id_buf[MCP2515_SIDL] >> 5);
+    RxRing.Clear();
 
-    // accumulate Extended frame ID
-    if (id_buf[MCP2515_SIDL] & MCP2515_RXB_IDE)
+    // save the Rx callback function (called from the service pass)
+    MCP2515_InterruptHandler = callback;
+    IntPending = false;
+    if (int_pin < 0)
     {
-        id = (id << 2) + (id_buf[MCP2515_SIDL] & 0x03);
-        id = (id << 8) + id_buf[MCP2515_EID8];
-        id = (id << 8) + id_buf[MCP2515_EID0];
-        id |= CAN_EFF_FLAG;             // merge in indication is Extended frame
+        IntPin = -1;
+        IntDeferred = false;
+        return MCP2515_OK;
     }
 
-    return id;
+    // init MCP2515 Int input pin
+    pinMode(int_pin, INPUT_PULLUP);
+    IntPin = int_pin;
+    IntDeferred = true;
+
+    // clear any pending MCP2515 interrupts
+    MCP2515_WriteRegister(MCP2515_CANINTF, 0);
+
+    // enable MCP2515 Rx and error interrupts (drive the Int pin)
+    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF),
+                                            (MCP2515_ERRIF | MCP2515_RX1IF | MCP2515_RX0IF));
+
+    return MCP2515_OK;
 }
 
-// 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 (includes IDE bit)
-// 4) Get RTR from RXBnCTRL (placed into frame->can_id)
-// 5) Get DLC from RXBnDLC
-// 6) Get CAN data from RXBnD0 to RXBnD7
-void DLK_MCP2515::MCP2515_ReadCAN_Msg(uint8_t rxbn_addr, CAN_FRAME * frame)
+// End MCP2515 servicing by a DLK_SpiBus service pass (or Int pin polling)
+//  - an Int line interrupt attached stays attached
+void DLK_MCP2515::MCP2515_DetachPolled(void)
 {
-    uint8_t can_rtr;
+    if ((IntSlotNum >= 0) || (IntPin < 0))
+    {
+        return;
+    }
+
+    // disable all MCP2515 interrupts (asynchronous transmissions now need MCP2515_ServiceTx())
+    MCP2515_WriteRegister(MCP2515_CANINTE, 0);
+    TxIntsEnabled = false;
 
-    // 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
-    frame->can_id = MCP2515_ReadCAN_ID(rxbn_addr + MCP2515_BUF_SIDH);
+    IntPin = -1;
+    IntDeferred = false;
+    IntPending = false;
+}
 
-    // 4) Get RTR from RXBnCTRL
-    can_rtr = MCP2515_ReadRegister(rxbn_addr);
-    if (can_rtr & RXRTR_BIT)
+// Service MCP2515 Tx, Rx and error state from READ STATUS 'status' (no Int pin)
+//  - an idle MCP2515 costs the one READ STATUS (2 bytes) already done, plus the error
+//    state poll every ERR_POLL_MS
+void DLK_MCP2515::MCP2515_PollStatus(uint8_t status)
+{
+    if (TxBufLoaded || TxQueueCnt)
     {
-        frame->can_id |= CAN_RTR_FLAG;      // merge in indication was standard RTR request
+        MCP2515_HandleTx(status);
     }
-
-    // 5) Get DLC (and extended RTR) from RXBnDLC
-    frame->can_dlc = MCP2515_ReadRegister(rxbn_addr + MCP2515_BUF_DLC);
-    if ((frame->can_id & CAN_EFF_FLAG) && (frame->can_dlc & MCP2515_RTR_MASK))
+    if (status & (STAT_RX1IF | STAT_RX0IF))
     {
-        frame->can_id |= CAN_RTR_FLAG;      // merge in indication was extended RTR request
+        // receive all CAN data from MCP2515 into Rx ring buffer
+        //  - RX1IF, RX0IF moved to RX Status[7:6] positions
+        MCP2515_DrainRx((uint8_t)((status & (STAT_RX1IF | STAT_RX0IF)) << 6));
     }
-    frame->can_dlc &= MCP2515_DLC_MASK;
-
-    // 6) Get CAN data from RXBnD0 to RXBnD7
-    MCP2515_ReadRegisters(rxbn_addr + MCP2515_BUF_DATA0, frame->can_data, frame->can_dlc);
+    MCP2515_ServiceErrors();
 }
 
-// Setup callback for MCP2515 receive interrupts
-// Note: Handling of interrupt callbacks from inside a C++ class is tricky!
-//       The interrupt handler attached to the interrupt pin *must* be a static function
-//       (or a non-class function outside of the class)!
-//       To call the application callback, the 'this' pointer to the current
-//       class object must be saved and in the interrupt handler is used to then call
-//       a class function that is then able to call the application callback function.
-//       See: https://www.onetransistor.eu/2019/05/arduino-class-interrupts-and-callbacks.html
-//       See: https://github.com/adafruit/Adafruit_MCP2515
-//       Note: This is only supported with 4 instances with interrupts!
-uint8_t DLK_MCP2515::MCP2515_OnRxInterrupt(int int_pin, void (* callback)(CAN_FRAME *))
+// MCP2515 servicing due without an interrupt
+//  - error state poll due (see MCP2515_ServiceErrors()), or an asynchronous CAN frame
+//    loaded for TX_TIMEOUT_MS (to be aborted by MCP2515_HandleTx())
+bool DLK_MCP2515::MCP2515_PollDue(void)
 {
-    if (digitalPinToInterrupt(int_pin) == NOT_AN_INTERRUPT)
+    if (((IntPin < 0) || (ErrState != ERR_ACTIVE)) && ((millis() - ErrPollTime) >= ERR_POLL_MS))
     {
-        return MCP2515_INVALID_INT;     // not a valid interrupt pin!
+        return true;
+    }
+    for (uint8_t i = TXB0; i < MCP2515_N_TXBUFFERS; ++i)
+    {
+        if ((TxBufLoaded & (1 << i)) && ((millis() - TxBufStart[i]) >= TX_TIMEOUT_MS))
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-#if (MAX_INTS > 0)
-    // init MCP2515 Int input pin
-    pinMode(int_pin, INPUT_PULLUP);
+// Get longest time spent in the MCP2515 Int pin interrupt handler
+//  - re-read until stable, as the interrupt handler may update it mid-read
+uint32_t DLK_MCP2515::MCP2515_IsrMaxTime(void)
+{
+    uint32_t us;
 
-    // notify SPI driver that SPI operations will be occurring inside an interrupt handler
-    SPI_dev->usingInterrupt(digitalPinToInterrupt(int_pin));
+    do
+    {
+        us = IsrMaxTime;
+    } while (us != IsrMaxTime);
+    return us;
+}
 
-    // disable MCP2515 Rx interrupts
-    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_RX1IF | MCP2515_RX0IF), 0);
+// MCP2515 common class-based Int pin handler
+void DLK_MCP2515::MCP2515_HandleInterrupt(void)
+{
+    uint32_t start;
+    uint32_t elapsed;
 
-    MsgNdx = 0;
+    start = micros();
 
-    if (instance1 == nullptr)      // available
+    if (IntDeferred)
     {
-        instance1 = this;
-        // attach MCP2515 Interrupt pin interrupt to static interrupt handler function
-        attachInterrupt(digitalPinToInterrupt(int_pin), MCP2515_OnInterrupt1, LOW);
+        IntPending = true;          // leave SPI operations and callbacks to MCP2515_Service()
     }
-#if (MAX_INTS > 1)
-    else if (instance2 == nullptr) // available
+    else
     {
-        instance2 = this;
-        // attach MCP2515 Interrupt pin interrupt to static interrupt handler function
-        attachInterrupt(digitalPinToInterrupt(int_pin), MCP2515_OnInterrupt2, LOW);
+        IntsDisabled = true;        // already inside interrupt handler
+        MCP2515_ProcessInts();
+        IntsDisabled = false;
     }
-#if (MAX_INTS > 2)
-    else if (instance3 == nullptr) // available
+
+    elapsed = micros() - start;
+    if (elapsed > IsrMaxTime)
     {
-        instance3 = this;
-        // attach MCP2515 Interrupt pin interrupt to static interrupt handler function
-        attachInterrupt(digitalPinToInterrupt(int_pin), MCP2515_OnInterrupt3, LOW);
+        IsrMaxTime = elapsed;
     }
-    else if (instance4 == nullptr) // available
+    MCP2515_STAT_ADD(isr_calls, 1);
+    MCP2515_STAT_ADD(isr_us, elapsed);
+    MCP2515_STAT_MAX(isr_max_us, elapsed);
+}
+
+// Process MCP2515 Tx, Rx and other interrupts
+//  - called from interrupt handler, or from MCP2515_Service() in deferred mode
+void DLK_MCP2515::MCP2515_ProcessInts(void)
+{
+    uint8_t ints;
+    uint8_t txints;
+
+    ints = MCP2515_ReadRegister(MCP2515_CANINTF);
+    txints = ints & (uint8_t)(TxBufLoaded * MCP2515_TX0IF);
+    if (txints)                                         // transmit scheduler Tx interrupt
     {
-        instance4 = this;
-        // attach MCP2515 Interrupt pin interrupt to static interrupt handler function
-        attachInterrupt(digitalPinToInterrupt(int_pin), MCP2515_OnInterrupt4, LOW);
+        MCP2515_HandleTx();                             // (clears its Tx interrupts)
     }
-#endif
-#endif
-    else
-#endif
+    ints &= ~txints;
+    if (ints & (0xff & ~(MCP2515_RX1IF | MCP2515_RX0IF)))   // non-Rx interrupt
     {
-        return MCP2515_NO_AVAIL_INTS;   // all supported interrupt instances already in use!
+        // discard/clear other non-Rx interrupts
+        MCP2515_ModifyRegister(MCP2515_CANINTF, ints & ~(MCP2515_RX1IF | MCP2515_RX0IF), 0);
+    }
+    if (ints & MCP2515_ERRIF)                           // error interrupt
+    {
+        MCP2515_CheckErrors();                          // (after clearing ERRIF - re-set by next change)
     }
 
-    // save the interrupt callback function
-    MCP2515_InterruptHandler = callback;
-
-    // clear any pending MCP2515 interrupts
-    MCP2515_WriteRegister(MCP2515_CANINTF, 0);
-
-    // enable MCP2515 Rx interrupts
-    MCP2515_ModifyRegister(MCP2515_CANINTE, (MCP2515_RX1IF | MCP2515_RX0IF), (MCP2515_RX1IF | MCP2515_RX0IF));
-
-    return MCP2515_OK;
+    if (ints & (MCP2515_RX1IF | MCP2515_RX0IF))         // Rx interrupt
+    {
+        // receive all CAN data from MCP2515 into Rx ring buffer
+        //  - RX1IF, RX0IF moved to RX Status[7:6] positions
+        MCP2515_DrainRx((uint8_t)((ints & (MCP2515_RX1IF | MCP2515_RX0IF)) << 6));
+    }
 }
 
-#if (MAX_INTS > 0)
-// This *must* be a static function to be used in attachInterrupt()
-void DLK_MCP2515::MCP2515_OnInterrupt1(void)
+// Receive all CAN messages from Rx buffers into Rx ring buffer, oldest first
+//  - 'status' is the already known Rx status, then RX STATUS is re-read until both
+//    Rx buffers are empty (at most RX_DRAIN_MAX times, to bound time in interrupt)
+//  - when both Rx buffers are full, both are read before re-reading RX STATUS
+//    (a CAN message arriving meanwhile is newer than both)
+//
+//  SPI cost for a burst of 2 CAN frames:
+//      - READ CANINTF + 2 READ RX BUFFER + RX STATUS = 4 transactions
+//      - (previously 2 interrupts of READ CANINTF + RX STATUS + READ RX BUFFER = 6 transactions)
+void DLK_MCP2515::MCP2515_DrainRx(uint8_t status)
 {
-    instance1->MCP2515_HandleInterrupt();    // invoke class-based handler
-}
+    uint8_t rx_num;
 
-#if (MAX_INTS > 1)
-// This *must* be a static function to be used in attachInterrupt()
-void DLK_MCP2515::MCP2515_OnInterrupt2(void)
-{
-    instance2->MCP2515_HandleInterrupt();    // invoke class-based handler
-}
+    for (uint8_t i = 0; (i < RX_DRAIN_MAX) && (status != MCP2515_NO_RX_MSG); ++i)
+    {
+        rx_num = MCP2515_OldestRxBuf(status);
+        MCP2515_RecvToRing(rx_num);
+        if (status == RXM_RXBOTH_MSG)
+        {
+            // other Rx buffer holds the next oldest CAN message
+            MCP2515_RecvToRing(MCP2515_OldestRxBuf((rx_num == RXB0) ? RXM_RXB1_MSG : RXM_RXB0_MSG));
+        }
 
-#if (MAX_INTS > 2)
-// This *must* be a static function to be used in attachInterrupt()
-void DLK_MCP2515::MCP2515_OnInterrupt3(void)
-{
-    instance3->MCP2515_HandleInterrupt();    // invoke class-based handler
+        status = MCP2515_CheckCAN_Rx();
+    }
 }
 
-// This *must* be a static function to be used in attachInterrupt()
-void DLK_MCP2515::MCP2515_OnInterrupt4(void)
+// Receive CAN message from Rx buffer into Rx ring buffer and notify application
+void DLK_MCP2515::MCP2515_RecvToRing(uint8_t rx_num)
 {
-    instance4->MCP2515_HandleInterrupt();    // invoke class-based handler
-}
-#endif
-#endif
-#endif
+    CAN_FRAME overflow_frame;
+    CAN_FRAME * frame;
 
-// MCP2515 common class-based Int pin handler
-void DLK_MCP2515::MCP2515_HandleInterrupt(void)
-{
-    uint8_t ints;
+    // still read out (clearing RXnIF) into temporary copy when Rx ring buffer full
+    frame = RxRing.Reserve();
+    if (frame == nullptr)
+    {
+        frame = &overflow_frame;
+    }
 
-    ints = MCP2515_ReadRegister(MCP2515_CANINTF);
-    if (ints & (0xff & ~(MCP2515_RX1IF | MCP2515_RX0IF)))   // non-Rx interrupt
+    if (!MCP2515_ReadCAN_Msg(rx_num, frame))
     {
-        MCP2515_ModifyRegister(MCP2515_CANINTF, 0xfc, 0);   // discard/clear non-Rx interrupts
+        RxRejects = RxRejects + 1;  // rejected by software filter (Rx ring buffer place not used)
+        return;
     }
+    MCP2515_STAT_ADD(rx_frames, 1);
 
-    if (ints & (MCP2515_RX1IF | MCP2515_RX0IF))         // Rx interrupt
+    if (frame != &overflow_frame)
     {
-        // receive CAN data from MCP2515
-        if (MCP2515_Recv(&CAN_Frame[MsgNdx]) == MCP2515_OK)
-        {
-            // call application callback
-            MCP2515_InterruptHandler(&CAN_Frame[MsgNdx]);
+        RxRing.Commit();
+    }
+    else
+    {
+        RxRing.Drop();
+    }
 
-            if (++MsgNdx >= FRAME_CNT)
-            {
-                MsgNdx = 0;
-            }
-        }
+    // call application callback
+    if (MCP2515_InterruptHandler != nullptr)
+    {
+        MCP2515_InterruptHandler(frame);
     }
 }
 #endif
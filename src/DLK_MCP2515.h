@@ -20,6 +20,12 @@
 #include "Arduino.h"
 #include "can.h"
 #include "MCP2515.h"
+#include "DLK_RingBuffer.h"
+#include "DLK_BitTiming.h"
+#include "DLK_SoftFilter.h"
+
+class DLK_SpiBus;
+class DLK_CanGateway;
 
 #if defined(ARDUINO_ARCH_RP2040) && defined(ARDUINO_ARCH_MBED_RP2040)
 #error "Unsupported MCU"
@@ -33,8 +39,56 @@
 #define SPI1_NUM    1
 
 #define SPI_DUMMY_BYTE  0x00
+#define SPI_BURST_MAX   18      // max registers in a READ/WRITE burst (TEC to EFLG)
+
+// Rx ring buffer size - must be a power of 2 (may be predefined to override)
+#ifndef FRAME_CNT
+#if defined(__AVR__)
 #define FRAME_CNT       4
+#else
+#define FRAME_CNT       32
+#endif
+#endif
+static_assert((FRAME_CNT >= 2) && (FRAME_CNT <= 128) && ((FRAME_CNT & (FRAME_CNT - 1)) == 0),
+              "FRAME_CNT must be a power of 2 (2 to 128)");
+
+#define RX_DRAIN_MAX    8       // max Rx buffer status checks per Rx interrupt
+#define ACC_OPT_MAX_IDS 64      // max wanted CAN IDs for Rx acceptance optimizer
+#define TX_QUEUE_CNT    8
+#define TX_TIMEOUT_MS   250
+#define TX_WAIT_LOOPS   (TX_TIMEOUT_MS * 100UL) // blocking send wait passes (10 uS each) - without millis()
+#define MODE_TIMEOUT_US 50000   // max wait for mode change (end of CAN frame in progress at 5Kbps)
+#define RESET_TIMEOUT_US 10000  // max wait for reset to complete (oscillator start-up)
+#define ERR_POLL_MS     10      // min time between error state polls (without error interrupt)
+#define BUSOFF_BACKOFF_MIN_MS 100   // bus-off recovery hold-off (doubled for each repeated bus-off)
+#define BUSOFF_BACKOFF_MAX_MS 5000  // max bus-off recovery hold-off
+
+// MCP2515 oscillator frequency (may be predefined to override - see MCP2515_SetOscillator())
+#ifndef MCP2515_OSC_HZ
+#define MCP2515_OSC_HZ  8000000
+#endif
+// per-instance statistics - 0 compiles them away (may be predefined to override)
+#ifndef MCP2515_USE_STATS
+#define MCP2515_USE_STATS   1
+#endif
+
+// SPI transaction trace - 1 compiles it in (may be predefined to override)
+#ifndef MCP2515_USE_TRACE
+#define MCP2515_USE_TRACE   0
+#endif
+// SPI transaction trace size (entries) - must be a power of 2 (may be predefined to override)
+#ifndef TRACE_CNT
+#define TRACE_CNT       64
+#endif
+#define TRACE_VERSION   1       // SPI transaction trace dump format version
+#define TRACE_MARK      0x00    // SPI transaction trace application mark (not an MCP2515 instruction)
 
+#define BT_SAMPLE_POINT 875     // CAN_xxxBPS bit timings sample point (per mille)
+#define BT_SJW          1       // CAN_xxxBPS bit timings synchronization jump width (TQ)
+#define BT_TOLERANCE_PPM 5000   // max CAN_xxxBPS bit rate error
+
+// number of Int lines supported (may be predefined to override)
+#ifndef MAX_INTS
 #ifdef __AVR__              // Nano and Nano Every
 #ifdef ARDUINO_AVR_NANO_EVERY
     #define MAX_INTS    4
@@ -44,11 +98,11 @@
 #endif
 
 #ifdef PHILHOWER_RP2040     // Pi Pico
-    #define MAX_INTS    4
+    #define MAX_INTS    8
 #endif
 
 #ifdef TEENSYDUINO          // Teensy 3.1
-    #define MAX_INTS    4
+    #define MAX_INTS    8
 #endif
 
 #ifdef ESP8266              // ESP8266
@@ -58,6 +112,112 @@
 #ifdef ESP32                // ESP32
     #define MAX_INTS    0   // .usingInterrupt() not supported
 #endif
+#endif
+
+// CAN error states (fault confinement)
+#define ERR_ACTIVE      0       // error active (TEC and REC < 96)
+#define ERR_WARNING     1       // error warning (TEC or REC >= 96)
+#define ERR_PASSIVE     2       // error passive (TEC or REC >= 128)
+#define ERR_BUSOFF      3       // bus-off (TEC > 255) - not on the CAN bus
+#define ERR_N_STATES    4
+
+#define TX_ENTRY_SYNC       0x01    // blocking transmission (no Tx done callback)
+#define TX_RESULT_PENDING   0xff    // blocking transmission not yet completed
+
+/// CAN frame queued for transmission
+typedef struct tx_entry
+{
+    /// transmit order key (priority, then CAN ID arbitration order - lowest first)
+    uint32_t key;
+    /// TX_ENTRY_xxx flags
+    uint8_t flags;
+    /// CAN frame to transmit
+    CAN_FRAME frame;
+} TX_ENTRY;
+
+/// MCP2515 error status
+typedef struct mcp2515_error_status
+{
+    /// CAN error state (ERR_ACTIVE to ERR_BUSOFF)
+    uint8_t state;
+    /// EFLG error flags
+    uint8_t eflg;
+    /// TEC transmit error counter
+    uint8_t tec;
+    /// REC receive error counter
+    uint8_t rec;
+} MCP2515_ERROR_STATUS;
+
+/// MCP2515 statistics (see DLK_MCP2515::MCP2515_GetStats())
+typedef struct mcp2515_stats
+{
+    /// CAN frames received (accepted by the software filter)
+    uint32_t rx_frames;
+    /// CAN frames transmitted
+    uint32_t tx_frames;
+    /// CAN transmissions failed (aborted, timed out or bus-off)
+    uint32_t tx_failures;
+    /// CAN transmissions timed out (TX_TIMEOUT_MS - also counted as failed)
+    uint32_t tx_timeouts;
+    /// SPI transactions
+    uint32_t spi_transactions;
+    /// SPI bytes transferred (instruction, address and data bytes)
+    uint32_t spi_bytes;
+    /// blocking CAN transmissions waited for
+    uint32_t send_waits;
+    /// total time waiting for blocking CAN transmissions (uS)
+    uint32_t send_wait_us;
+    /// longest time waiting for a blocking CAN transmission (uS)
+    uint32_t send_wait_max_us;
+    /// Int pin interrupt handler calls
+    uint32_t isr_calls;
+    /// total time in Int pin interrupt handler (uS)
+    uint32_t isr_us;
+    /// longest time in Int pin interrupt handler (uS)
+    uint32_t isr_max_us;
+} MCP2515_STATS;
+
+/// MCP2515 SPI transaction trace entry
+typedef struct mcp2515_trace_entry
+{
+    /// SPI transaction start time (uS)
+    uint32_t us;
+    /// SPI transaction duration (uS - 0xffff = 0xffff or more)
+    uint16_t dur_us;
+    /// SPI instruction (MCP2515_READ, etc. - TRACE_MARK = application mark)
+    uint8_t instr;
+    /// register address (READ, WRITE, BIT MODIFY - else 0), or application mark tag
+    uint8_t reg;
+    /// SPI transaction length (bytes, including instruction and address)
+    uint8_t len;
+} MCP2515_TRACE_ENTRY;
+
+/// MCP2515 Rx acceptance configuration (all masks, filters and Rx buffer operating modes)
+typedef struct mcp2515_acceptance
+{
+    /// RXM0, RXM1 mask values (standard: ID in bits 10:0, Data0 in bits 23:16,
+    /// Data1 in bits 31:24 - extended: 29-bit ID)
+    uint32_t mask[MCP2515_N_MASKS];
+    /// RXF0 to RXF5 filter values (same layout as mask values)
+    uint32_t filter[MCP2515_N_FILTERS];
+    /// extended masks (bit n = RXMn)
+    uint8_t mask_ext;
+    /// extended frame filters (bit n = RXFn - others are standard frame filters)
+    uint8_t filter_ext;
+    /// RXB0, RXB1 operating modes (RXM_M0 or RXM_M3)
+    uint8_t rx_mode[MCP2515_N_RXBUFFERS];
+} MCP2515_ACCEPTANCE;
+
+/// MCP2515 Rx acceptance optimizer result
+typedef struct mcp2515_accept_result
+{
+    /// number of CAN IDs accepted by the masks and filters (standard and extended)
+    uint32_t accepted;
+    /// number of unwanted CAN IDs accepted
+    uint32_t false_accepts;
+    /// unwanted share of accepted CAN IDs (per mille)
+    uint16_t false_ratio;
+} MCP2515_ACCEPT_RESULT;
 
 /**
  * DLK_MCP2515 Arduino MCP2515 CAN library class. Version: "V1.0.5 11/29/2023"
@@ -92,7 +252,7 @@ class DLK_MCP2515
          *
          * \param reg: the starting MCP2515 register (0x00 to 0x7d) to read from
          * \param values: place to store the MCP2515 registers values read
-         * \param cnt: the number of consecutive MCP2515 registers to read from
+         * \param cnt: the number of consecutive MCP2515 registers to read from (up to \ref SPI_BURST_MAX)
          *
          *  \return None.
          */
@@ -113,7 +273,7 @@ class DLK_MCP2515
          *
          * \param reg: the starting MCP2515 register (0x00 to 0x7d) to write to
          * \param vals: the values to write to the MCP2515 registers
-         * \param cnt: the number of consecutive MCP2515 registers to write to
+         * \param cnt: the number of consecutive MCP2515 registers to write to (up to \ref SPI_BURST_MAX)
          *
          *  \return None.
          */
@@ -145,6 +305,8 @@ class DLK_MCP2515
          * Reset the MCP2515 device.
          *
          *  \return None.
+         *
+         *  \note Waits until the MCP2515 reports Configuration mode (up to \ref RESET_TIMEOUT_US).
          */
         void MCP2515_Reset(void);
 
@@ -171,6 +333,8 @@ class DLK_MCP2515
          * \return   int8_t
          * \return   MCP2515_FAIL = the MCP2515 failed to change to specified mode
          * \return   MCP2515_OK = the MCP2515 mode setting was successful
+         *
+         *  \note Waits until CANSTAT reports the new mode (up to \ref MODE_TIMEOUT_US).
          */
         uint8_t MCP2515_SetMode(uint8_t newMode);
 
@@ -184,11 +348,54 @@ class DLK_MCP2515
          *                   or CAN_1000KBPS)
          *
          * \return   int8_t
-         * \return   MCP2515_FAIL = the MCP2515 failed to change to configuration mode
+         * \return   MCP2515_FAIL = the MCP2515 failed to change to configuration mode,
+         *           or the CAN speed is not possible with the MCP2515 oscillator
          * \return   MCP2515_OK = the MCP2515 CAN speed setting was successful
+         *
+         *  \note Uses the bit timing calculated at compile time for the MCP2515 oscillator
+         *        (see \ref MCP2515_SetOscillator), with a sample point of \ref BT_SAMPLE_POINT.
          */
         uint8_t MCP2515_SetBitrate(uint8_t canSpeed);
 
+        /**
+         * Set MCP2515 oscillator (crystal) frequency used for CAN speeds.
+         *
+         * \param osc_hz: the MCP2515 oscillator frequency (8000000, 16000000 or 20000000)
+         *
+         * \return   int8_t
+         * \return   MCP2515_FAIL = no CAN speed bit timings for the oscillator frequency
+         *           (use \ref MCP2515_SetBitTiming), oscillator frequency unchanged
+         * \return   MCP2515_OK = the MCP2515 oscillator frequency setting was successful
+         *
+         *  \note Call before \ref MCP2515_Init (default is \ref MCP2515_OSC_HZ).
+         */
+        uint8_t MCP2515_SetOscillator(uint32_t osc_hz);
+
+        /**
+         * Set specified MCP2515 CAN bit timing.
+         *
+         * \param bt: the MCP2515 CAN bit timing to set (e.g. from \ref MCP2515_CalcBitTiming)
+         *
+         * \return   int8_t
+         * \return   MCP2515_FAIL = the MCP2515 failed to change to configuration mode,
+         *           or no bit timing
+         * \return   MCP2515_OK = the MCP2515 CAN bit timing setting was successful
+         */
+        uint8_t MCP2515_SetBitTiming(const MCP2515_BITTIMING * bt);
+
+        /**
+         * Get MCP2515 CAN bit timing used for specified CAN speed.
+         *
+         * \param canSpeed: the MCP2515 CAN bus speed (CAN_5KBPS to CAN_1000KBPS)
+         * \param bt: the place to store the CAN bit timing (achieved bit rate, bit rate
+         *            error and sample point, CNFn register values)
+         *
+         * \return   int8_t
+         * \return   MCP2515_FAIL = the CAN speed is not possible with the MCP2515 oscillator
+         * \return   MCP2515_OK = the MCP2515 CAN bit timing is available
+         */
+        uint8_t MCP2515_GetBitTiming(uint8_t canSpeed, MCP2515_BITTIMING * bt);
+
         /**
          * Set specified MCP2515 Rx buffer operating mode.
          *
@@ -255,6 +462,49 @@ class DLK_MCP2515
          */
         void MCP2515_SetExtMask(uint8_t mask_num, uint32_t mask_id);
 
+        /**
+         * Set all MCP2515 masks, filters and Rx buffer operating modes at once.
+         *
+         * \param acc: the MCP2515 Rx acceptance configuration to set
+         *
+         * \return   int8_t
+         * \return   MCP2515_SET_MODE_FAIL = the MCP2515 failed to change mode
+         * \return   MCP2515_OK = the MCP2515 Rx acceptance setting was successful
+         *
+         *  \note Uses a single Configuration mode entry and 3 register bursts (RXF0 to
+         *        RXF2, RXF3 to RXF5, RXM0 and RXM1) instead of a Configuration mode entry
+         *        and exit for each mask and filter.
+         */
+        uint8_t MCP2515_ConfigureAcceptance(const MCP2515_ACCEPTANCE * acc);
+
+        /**
+         * Calculate MCP2515 masks and filters accepting the fewest unwanted CAN IDs
+         * for a set of wanted CAN IDs.
+         *
+         * \param ids: the wanted CAN IDs (with CAN_EFF_FLAG for extended CAN IDs)
+         * \param cnt: the number of wanted CAN IDs (up to \ref ACC_OPT_MAX_IDS)
+         * \param acc: the place to store the Rx acceptance configuration
+         *             (for \ref MCP2515_ConfigureAcceptance)
+         * \param result: the place to store the accepted CAN ID counts (may be nullptr)
+         *
+         * \return   int8_t
+         * \return   MCP2515_FAIL = no or too many wanted CAN IDs
+         * \return   MCP2515_OK = the Rx acceptance configuration was calculated
+         *
+         *  \note RXB0 gets RXM0 with RXF0 and RXF1, RXB1 gets RXM1 with RXF2 to RXF5.
+         *        Mask bits are cleared one at a time (always the one costing the fewest
+         *        extra accepted CAN IDs) until the wanted CAN IDs fit in the filters,
+         *        trying every split of the wanted CAN IDs between RXB0 and RXB1 and
+         *        keeping the one accepting the fewest CAN IDs overall. A standard and an
+         *        extended filter sharing a mask only compare the standard ID bits.
+         *
+         *  \note Does not use the MCP2515 (may be called before \ref MCP2515_Init).
+         *        Needs about 12 bytes of stack per wanted CAN ID (\ref ACC_OPT_MAX_IDS).
+         */
+        static uint8_t MCP2515_OptimizeAcceptance(const uint32_t ids[], uint8_t cnt,
+                                                  MCP2515_ACCEPTANCE * acc,
+                                                  MCP2515_ACCEPT_RESULT * result);
+
         /**
          * Initialize MCP2515 device.
          *
@@ -264,11 +514,23 @@ class DLK_MCP2515
          *                   CAN_100KBPS, CAN_125KBPS, CAN_200KBPS, CAN_250KBPS, CAN_500KBPS,
          *                   or CAN_1000KBPS)
          *
-         * \return   MCP2515_FAIL = the MCP2515 failed to change to configuration mode
+         * \return   MCP2515_FAIL = the MCP2515 failed to change to configuration mode,
+         *           or the CAN speed is not possible with the MCP2515 oscillator
          * \return   MCP2515_OK = the MCP2515 initialization was successful
          */
         uint8_t MCP2515_Init(uint8_t canSpeed);
 
+        /**
+         * Initialize MCP2515 device with specified CAN bit timing.
+         *
+         * \param bt: the MCP2515 CAN bit timing to use (e.g. from \ref MCP2515_CalcBitTiming)
+         *
+         * \return   MCP2515_FAIL = the MCP2515 failed to change to configuration mode,
+         *           or no bit timing
+         * \return   MCP2515_OK = the MCP2515 initialization was successful
+         */
+        uint8_t MCP2515_Init(const MCP2515_BITTIMING * bt);
+
         /**
          * Send Standard CAN frame data to MCP2515 for CAN transmission.
          *
@@ -280,6 +542,9 @@ class DLK_MCP2515
          * \return      - 'len' was incorrect
          * \return      - CAN transmission error occurred
          * \return      - CAN transmission failed (i.e. no other CAN device on CAN bus)
+         * \return      - another blocking send in progress (e.g. sent from a callback)
+         * \return   MCP2515_ALLTXBUSY = Tx queue full, CAN frame not sent
+         * \return   MCP2515_BUS_OFF = MCP2515 bus-off, CAN frame not sent (or aborted)
          * \return   MCP2515_OK = the MCP2515 CAN transmission was successful
          */
         uint8_t MCP2515_Send(uint32_t id, uint8_t len, uint8_t * can_msg);
@@ -295,6 +560,9 @@ class DLK_MCP2515
          * \return      - 'len' was incorrect
          * \return      - CAN transmission error occurred
          * \return      - CAN transmission failed (i.e. no other CAN device on CAN bus)
+         * \return      - another blocking send in progress (e.g. sent from a callback)
+         * \return   MCP2515_ALLTXBUSY = Tx queue full, CAN frame not sent
+         * \return   MCP2515_BUS_OFF = MCP2515 bus-off, CAN frame not sent (or aborted)
          * \return   MCP2515_OK = the MCP2515 CAN transmission was successful
          */
         uint8_t MCP2515_Xsend(uint32_t id, uint8_t len, uint8_t * can_msg);
@@ -309,6 +577,9 @@ class DLK_MCP2515
          * \return      - 'len' was incorrect
          * \return      - CAN transmission error occurred
          * \return      - CAN transmission failed (i.e. no other CAN device on CAN bus)
+         * \return      - another blocking send in progress (e.g. sent from a callback)
+         * \return   MCP2515_ALLTXBUSY = Tx queue full, CAN frame not sent
+         * \return   MCP2515_BUS_OFF = MCP2515 bus-off, CAN frame not sent (or aborted)
          * \return   MCP2515_OK = the MCP2515 CAN transmission was successful
          */
         uint8_t MCP2515_RtrSend(uint16_t id, uint8_t len);
@@ -323,20 +594,80 @@ class DLK_MCP2515
          * \return      - 'len' was incorrect
          * \return      - CAN transmission error occurred
          * \return      - CAN transmission failed (i.e. no other CAN device on CAN bus)
+         * \return      - another blocking send in progress (e.g. sent from a callback)
+         * \return   MCP2515_ALLTXBUSY = Tx queue full, CAN frame not sent
+         * \return   MCP2515_BUS_OFF = MCP2515 bus-off, CAN frame not sent (or aborted)
          * \return   MCP2515_OK = the MCP2515 CAN transmission was successful
          */
         uint8_t MCP2515_ExtRtrSend(uint32_t id, uint8_t len);
 
+        /**
+         * Queue CAN frame for non-blocking (asynchronous) CAN transmission.
+         *
+         * \param frame: the CAN frame to send (copied into the Tx queue)
+         * \param prio: the transmit priority (TXP_P0 (default) to TXP_P3 (highest)) {optional}
+         *
+         * \return   MCP2515_FAIL = 'can_dlc' of CAN frame was incorrect
+         * \return   MCP2515_ALLTXBUSY = Tx queue full, CAN frame not queued
+         * \return   MCP2515_BUS_OFF = MCP2515 bus-off, CAN frame not queued
+         * \return   MCP2515_OK = CAN frame queued for CAN transmission
+         *
+         *  \note CAN frames are transmitted in order of priority, then CAN ID (CAN bus
+         *        arbitration order), then queued order. The highest priority CAN frames
+         *        are kept in the Tx buffers, with their TXP priorities set accordingly;
+         *        a lower priority loaded CAN frame is aborted and re-queued to make room.
+         *        Tx buffers are refilled from the Tx interrupt (if \ref MCP2515_OnRxInterrupt
+         *        is used) or by calling \ref MCP2515_ServiceTx.
+         */
+        uint8_t MCP2515_SendAsync(CAN_FRAME * frame, uint8_t prio = TXP_P0);
+
+        /**
+         * Service asynchronous CAN transmissions - report completed CAN frames,
+         * abort timed out CAN frames and refill free Tx buffers from the Tx queue.
+         *
+         *  \return None.
+         *
+         *  \note Call periodically from loop() (always needed without Rx interrupt
+         *        usage and for Tx timeouts of \ref TX_TIMEOUT_MS).
+         *
+         *  \note Also polls the error state (see \ref MCP2515_CheckErrors) every
+         *        \ref ERR_POLL_MS when no Int line is attached or the MCP2515 is not
+         *        error active, which also ends bus-off recovery hold-offs.
+         */
+        void MCP2515_ServiceTx(void);
+
+        /**
+         * Get number of asynchronous CAN frames not yet completed.
+         *
+         * \return   uint8_t = the number of queued and transmitting CAN frames
+         */
+        uint8_t MCP2515_TxPending(void);
+
+        /**
+         * Setup callback for asynchronous CAN transmission completion.
+         *
+         * \param callback: the application callback function to call with each completed
+         *                  CAN frame and its result (MCP2515_OK or MCP2515_FAIL)
+         *
+         *  \return None.
+         *
+         *  \note The callback may be called from the interrupt handler with interrupts
+         *        disabled and may queue further CAN frames with \ref MCP2515_SendAsync.
+         *
+         *  \note On bus-off, all queued and loaded CAN frames are completed as failed.
+         */
+        void MCP2515_OnTxDone(void (* callback)(CAN_FRAME *, uint8_t));
+
         /*
             1) Determine if CAN message has been received
                 - RX Status[7:6] or Read Status[1:0]  (either will indicate message available)
             2) Determine Rx buffer containing CAN message
-            3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
-            4) Get RTR from RXBnCTRL
-            5) Get DLC from RXBnDLC
-            6) Get CAN data from RXBnD0 to RXBnD7
-            7) Notify MCP2515 that CAN message has been retrieved
-               (clear RXnIF in CANINTF register)
+            3) Get ID/EID and RTR from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0
+            4) Get DLC (and extended RTR) from RXBnDLC
+            5) Get CAN data from RXBnD0 to RXBnD7
+            6) Notify MCP2515 that CAN message has been retrieved
+               (RXnIF in CANINTF register auto-cleared when ~CS raised)
+            - steps 3) to 6) are a single READ RX BUFFER instruction transaction
         */
         /**
          * Retrieve CAN data from MCP2515 device.
@@ -345,6 +676,9 @@ class DLK_MCP2515
          *
          * \return   MCP2515_NO_RX_MSG = no CAN message available
          * \return   MCP2515_OK = the MCP2515 CAN message retrieval was successful
+         *
+         *  \note CAN messages rejected by the software filter (\ref MCP2515_SetSoftFilter)
+         *        are discarded and counted in \ref MCP2515_RxRejects.
          */
         uint8_t MCP2515_Recv(CAN_FRAME * frame);
 
@@ -353,15 +687,310 @@ class DLK_MCP2515
          *
          * \param int_pin: the interrupt pin for MCP2515 receive interrupts 
          * \param callback: the application callback function to call on receive interrupts
+         *                  (may be nullptr)
+         * \param deferred: true = interrupt handler only notes the interrupt, all SPI
+         *                  operations and callbacks are done by \ref MCP2515_Service \n
+         *                  false = all done inside interrupt handler
          *
          * \return   int8_t
          * \return   MCP2515_FAIL = could not attach Rx interrupt 
          * \return   MCP2515_OK = Rx interrupt attachment successful
          *
          *  \note MCP2515_FAIL return due to not a valid interrupt pin \b int_pin or
-         *        all supported interrupt instances (2) already in use.
+         *        all supported Int lines (\ref MAX_INTS) already in use.
+         *
+         *  \note Without Int line interrupts (\ref MAX_INTS 0, e.g. ESP8266 and ESP32),
+         *        the Int pin is polled instead (\ref MCP2515_OnRxPoll) in either mode, so
+         *        \ref MCP2515_Service must be called from loop().
+         *
+         *  \note Any Int line already attached by this MCP2515 is released first.
+         *
+         *  \note Received CAN frames are stored in the Rx ring buffer (\ref FRAME_CNT
+         *        frames) to be retrieved with \ref MCP2515_Pop. The callback gets the
+         *        stored CAN frame (valid until popped), or a temporary copy of it if the
+         *        Rx ring buffer was full (counted in \ref MCP2515_RxOverflows).
+         *
+         *  \note In deferred mode, the Int pin interrupt is falling edge triggered (so it
+         *        stays quiet until the MCP2515 interrupts are serviced) and the callbacks
+         *        are called from \ref MCP2515_Service (not from inside an interrupt).
+         */
+        uint8_t MCP2515_OnRxInterrupt(int int_pin, void (* callback)(CAN_FRAME *), bool deferred = false);
+
+        /**
+         * Setup callback for MCP2515 receive interrupts on the Int line of another MCP2515
+         * (wired-OR Int outputs).
+         *
+         * \param owner: the MCP2515 already attached to the Int line with \ref MCP2515_OnRxInterrupt
+         * \param callback: the application callback function to call on receive interrupts
+         *                  (may be nullptr)
+         *
+         * \return   int8_t
+         * \return   MCP2515_FAIL = could not share Rx interrupt
+         * \return   MCP2515_OK = Rx interrupt sharing successful
+         *
+         *  \note Uses the deferred mode of \b owner. The one interrupt handler of the
+         *        Int line services every MCP2515 sharing it.
+         */
+        uint8_t MCP2515_ShareRxInterrupt(DLK_MCP2515 * owner, void (* callback)(CAN_FRAME *));
+
+        /**
+         * Setup callback for MCP2515 receive with the Int pin polled (no interrupt).
+         *
+         * \param int_pin: the MCP2515 Int pin (any digital input pin)
+         * \param callback: the application callback function to call with each received
+         *                  CAN frame (may be nullptr)
+         *
+         * \return   MCP2515_INVALID_INT = no Int pin \b int_pin
+         * \return   MCP2515_OK = Int pin polling set up
+         *
+         *  \note \ref MCP2515_Service reads the Int pin and only when it is low reads and
+         *        drains the MCP2515 (Rx, Tx and error interrupts), so an idle MCP2515 costs
+         *        no SPI operations. Received CAN frames go into the Rx ring buffer and the
+         *        callback as with \ref MCP2515_OnRxInterrupt in deferred mode.
+         *
+         *  \note Any Int line already attached by this MCP2515 is released first.
+         */
+        uint8_t MCP2515_OnRxPoll(int int_pin, void (* callback)(CAN_FRAME *));
+
+        /**
+         * Release MCP2515 interrupts and the Int line attached.
+         *
+         * \return   MCP2515_FAIL = no Int line attached
+         * \return   MCP2515_OK = Int line released
+         *
+         *  \note The Int line is free for reuse once no MCP2515 shares it.
+         *
+         *  \note Also ends polling of the Int pin (\ref MCP2515_OnRxPoll).
+         */
+        uint8_t MCP2515_DetachInterrupt(void);
+
+        /**
+         * Service MCP2515 interrupts noted by the deferred mode interrupt handler.
+         *  - call often from loop()
+         *
+         *  \return None.
+         *
+         *  \note Does nothing unless \ref MCP2515_OnRxInterrupt was called with
+         *        \b deferred true, or the Int pin is polled (\ref MCP2515_OnRxPoll or a
+         *        \ref DLK_SpiBus).
+         *
+         *  \note While the Int pin is high, only checks for a due error state poll or
+         *        asynchronous transmission timeout (no SPI operations otherwise).
+         */
+        void MCP2515_Service(void);
+
+        /**
+         * Get longest time spent in the MCP2515 Int pin interrupt handler.
+         *
+         * \return   uint32_t = the worst-case interrupt handler time (uS)
+         */
+        uint32_t MCP2515_IsrMaxTime(void);
+
+        /**
+         * Get statistics snapshot.
+         *
+         * \param stats: the place to store the statistics
+         *
+         * \return   MCP2515_FAIL = statistics not compiled in (\ref MCP2515_USE_STATS 0)
+         * \return   MCP2515_OK = the statistics were stored
+         *
+         *  \note The snapshot is taken with interrupts disabled (consistent with the
+         *        interrupt handler).
+         */
+        uint8_t MCP2515_GetStats(MCP2515_STATS * stats);
+
+        /**
+         * Reset all statistics to zero.
+         *
+         *  \return None.
+         */
+        void MCP2515_ResetStats(void);
+
+        /**
+         * Start or stop recording SPI transactions in the SPI transaction trace.
+         *
+         * \param on: true = record SPI transactions (default), false = stop recording
+         *
+         *  \return None.
+         *
+         *  \note The SPI transaction trace keeps the last \ref TRACE_CNT SPI transactions.
+         *        Only compiled in with \ref MCP2515_USE_TRACE 1.
+         */
+        void MCP2515_TraceEnable(bool on);
+
+        /**
+         * Add application mark to the SPI transaction trace (e.g. before an API call,
+         * to see the SPI transactions it makes).
+         *
+         * \param tag: the application mark tag
+         *
+         *  \return None.
+         */
+        void MCP2515_TraceMark(uint8_t tag);
+
+        /**
+         * Write SPI transaction trace in compact binary form, oldest first, then clear it.
+         *
+         * \param out: where to write the SPI transaction trace (e.g. Serial)
+         *
+         * \return   uint16_t = the number of SPI transaction trace entries written
+         *
+         *  \note Decode with extras/trace/mcp2515_trace.py. Nothing is written unless
+         *        compiled in with \ref MCP2515_USE_TRACE 1.
          */
-        uint8_t MCP2515_OnRxInterrupt(int int_pin, void (* callback)(CAN_FRAME *));
+        uint16_t MCP2515_TraceDump(Print & out);
+
+        /**
+         * Get number of received CAN frames in the Rx ring buffer.
+         *
+         * \return   uint8_t = the number of CAN frames available to \ref MCP2515_Pop
+         */
+        uint8_t MCP2515_Available(void);
+
+        /**
+         * Retrieve oldest received CAN frame from the Rx ring buffer.
+         *
+         * \param frame: the place to store the received CAN message
+         *
+         * \return   MCP2515_NO_RX_MSG = no CAN message available
+         * \return   MCP2515_OK = the CAN message retrieval was successful
+         *
+         *  \note Safe against the Rx interrupt handler without disabling interrupts.
+         */
+        uint8_t MCP2515_Pop(CAN_FRAME * frame);
+
+        /**
+         * Get number of received CAN frames lost due to the Rx ring buffer being full.
+         *
+         * \return   uint32_t = the number of lost CAN frames
+         */
+        uint32_t MCP2515_RxOverflows(void);
+
+        /**
+         * Get number of MCP2515 Rx buffer overruns (CAN frames lost in the MCP2515).
+         *
+         * \param rx_num: the Rx buffer number (RXB0 or RXB1)
+         *
+         * \return   uint32_t = the number of Rx buffer overruns (each at least one lost CAN frame)
+         *
+         *  \note With rollover, RXB0 only overruns if RXB1 is also full, so overruns are
+         *        usually counted for RXB1. Overrun flags (EFLG RXnOVR) are read and cleared
+         *        on error interrupts, by \ref MCP2515_CheckErrors and by \ref MCP2515_Recv
+         *        when both Rx buffers are full.
+         */
+        uint32_t MCP2515_RxOverruns(uint8_t rx_num);
+
+        /**
+         * Setup callback for MCP2515 Rx buffer overruns.
+         *
+         * \param callback: the application callback function to call with the overrun
+         *                  Rx buffers (bit n = RXBn) (may be nullptr)
+         *
+         *  \return None.
+         *
+         *  \note The callback may be called from the interrupt handler with interrupts
+         *        disabled.
+         */
+        void MCP2515_OnRxOverrun(void (* callback)(uint8_t));
+
+        /**
+         * Get highest number of CAN frames ever waiting in the Rx ring buffer.
+         *
+         * \return   uint8_t = the Rx ring buffer high water mark (of \ref FRAME_CNT)
+         */
+        uint8_t MCP2515_RxHighWater(void);
+
+        /**
+         * Set software acceptance filter checked for each received CAN message (after
+         * the MCP2515 hardware masks and filters), before it is stored or its callback called.
+         *
+         * \param filt: the software filter to use (nullptr = accept all)
+         *
+         *  \return None.
+         *
+         *  \note The same software filter may be used by several MCP2515s. Rejected CAN
+         *        messages only cost reading their ID (not their data bytes), except on
+         *        the Pi Pico.
+         */
+        void MCP2515_SetSoftFilter(const DLK_SoftFilter * filt);
+
+        /**
+         * Get number of received CAN frames rejected by the software filter.
+         *
+         * \return   uint32_t = the number of rejected CAN frames
+         */
+        uint32_t MCP2515_RxRejects(void);
+
+        /**
+         * Read MCP2515 error status and update the error state.
+         *
+         * \param err: the place to store the error status (may be nullptr) {optional}
+         *
+         * \return   uint8_t = the CAN error state (ERR_ACTIVE to ERR_BUSOFF)
+         *
+         *  \note Reads TEC, REC and EFLG with a single READ burst (TEC to EFLG).
+         *        Called by the interrupt handler on MCP2515 error interrupts (ERRIF),
+         *        only needed by the application to get TEC, REC and EFLG values.
+         *
+         *  \note Entering bus-off aborts all CAN transmissions (see \ref MCP2515_OnTxDone)
+         *        and holds the MCP2515 off the CAN bus in Configuration mode until the
+         *        bus-off recovery hold-off ends (see \ref MCP2515_SetBusOffRecovery).
+         */
+        uint8_t MCP2515_CheckErrors(MCP2515_ERROR_STATUS * err = nullptr);
+
+        /**
+         * Get CAN error state (as last read, without any SPI operations).
+         *
+         * \return   uint8_t = the CAN error state (ERR_ACTIVE to ERR_BUSOFF)
+         */
+        uint8_t MCP2515_ErrorState(void);
+
+        /**
+         * Get number of times CAN error state was entered.
+         *
+         * \param state: the CAN error state (ERR_ACTIVE (recoveries) to ERR_BUSOFF)
+         *
+         * \return   uint32_t = the number of times the CAN error state was entered
+         */
+        uint32_t MCP2515_ErrorCount(uint8_t state);
+
+        /**
+         * Setup callback for CAN error state changes.
+         *
+         * \param callback: the application callback function to call with each new
+         *                  CAN error state and the error status (may be nullptr)
+         *
+         *  \return None.
+         *
+         *  \note The callback may be called from the interrupt handler with interrupts
+         *        disabled.
+         */
+        void MCP2515_OnError(void (* callback)(uint8_t, const MCP2515_ERROR_STATUS *));
+
+        /**
+         * Setup bus-off recovery.
+         *
+         * \param auto_recover: true = rejoin the CAN bus after the hold-off (default) \n
+         *                      false = stay off the CAN bus until \ref MCP2515_RecoverBusOff
+         * \param min_ms: the hold-off after a single bus-off {optional}
+         * \param max_ms: the max hold-off {optional}
+         *
+         *  \return None.
+         *
+         *  \note The hold-off doubles (up to \b max_ms) for each bus-off within \b max_ms
+         *        of rejoining the CAN bus. After rejoining, the MCP2515 still waits for
+         *        128 occurrences of 11 recessive bits before leaving bus-off.
+         */
+        void MCP2515_SetBusOffRecovery(bool auto_recover, uint16_t min_ms = BUSOFF_BACKOFF_MIN_MS,
+                                       uint16_t max_ms = BUSOFF_BACKOFF_MAX_MS);
+
+        /**
+         * Rejoin the CAN bus after bus-off, ending any bus-off recovery hold-off.
+         *
+         * \return   MCP2515_FAIL = not held off the CAN bus
+         * \return   MCP2515_OK = rejoined the CAN bus
+         */
+        uint8_t MCP2515_RecoverBusOff(void);
 
     private:
         /// the SPI port to use (SPI0_NUM or SPI1_NUM)
@@ -369,12 +998,21 @@ class DLK_MCP2515
 
         /// Pointer to SPI device
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266) || defined(ESP32)
-        SPIClass * SPI_dev;
+        SPIClass * SPI_dev = nullptr;
 #endif
 #ifdef PHILHOWER_RP2040
-        SPIClassRP2040 * SPI_dev;
+        SPIClassRP2040 * SPI_dev = nullptr;
 #endif
 
+        /// SPI transaction held by a DLK_SpiBus service pass (no beginTransaction/endTransaction)
+        bool SpiHeld = false;
+
+        /// the DLK_SpiBus scheduler services this MCP2515 (uses the private members below)
+        friend class DLK_SpiBus;
+
+        /// the DLK_CanGateway services this MCP2515 (uses IntPin, IntDeferred and MCP2515_PollDue())
+        friend class DLK_CanGateway;
+
         /// Flag for SPI initialization
 #if defined(__AVR__) || defined(TEENSYDUINO) || defined(ESP8266)
         static bool SPI_initted;
@@ -393,32 +1031,201 @@ class DLK_MCP2515
         /// SPI configuration settings
         SPISettings SPI_Settings;
 
+        /// SPI interface speed (bps) of SPI configuration settings
+        uint32_t SPI_speed;
+
+        /// MCP2515 oscillator frequency (Hz)
+        uint32_t OscHz = MCP2515_OSC_HZ;
+
         /// pointers to DLK_MCP2515 class using private static class variables for interrupts usage
 #if (MAX_INTS > 0)
-        static DLK_MCP2515 * instance1;
-#if (MAX_INTS > 1)
-        static DLK_MCP2515 * instance2;
-#if (MAX_INTS > 2)
-        static DLK_MCP2515 * instance3;
-        static DLK_MCP2515 * instance4;
-#endif
-#endif
+        /// first DLK_MCP2515 attached to each Int line slot (others sharing it chained by IntNext)
+        static DLK_MCP2515 * IntSlot[MAX_INTS];
+
+        /// released Int line slots available for reuse
+        static uint8_t IntFreeSlot[MAX_INTS];
+
+        /// number of released Int line slots in IntFreeSlot[]
+        static uint8_t IntFreeCnt;
+
+        /// number of Int line slots ever used
+        static uint8_t IntUsedCnt;
 #endif
 
-        /// storage for received CAN messages
-        CAN_FRAME CAN_Frame[FRAME_CNT];
+        /// Int line slot attached (-1 = none)
+        int8_t IntSlotNum = -1;
+
+        /// next DLK_MCP2515 sharing the same Int line
+        DLK_MCP2515 * IntNext = nullptr;
+
+        /// storage for received CAN messages (filled by Rx interrupt handler)
+        DLK_RingBuffer<CAN_FRAME, FRAME_CNT> RxRing;
+
+        /// software acceptance filter (nullptr = accept all)
+        const DLK_SoftFilter * SoftFilter = nullptr;
+
+        /// number of received CAN frames rejected by software filter
+        volatile uint32_t RxRejects = 0;
+
+        /// number of Rx buffer overruns (EFLG RXnOVR) of each Rx buffer
+        volatile uint32_t RxOverruns[MCP2515_N_RXBUFFERS] = { 0 };
 
-        /// next index for storage for received CAN messages
-        uint8_t MsgNdx = 0;
+        /// Rx buffer overrun callback function
+        void (* MCP2515_RxOverrunHandler)(uint8_t);
+
+        /// CAN message in RXB1 arrived before the one in RXB0 (RXB0 read while RXB1 was full)
+        bool RxB1Older = false;
 
         /// Rx interrupt callback function
         void (* MCP2515_InterruptHandler)(CAN_FRAME *);
 
-        /// Initiate MCP2515 SPI transaction
-        inline void MCP2515_StartSPI(void);
+        /// MCP2515 Int pin (-1 = no interrupt attached, nor Int pin polled by a DLK_SpiBus)
+        int IntPin = -1;
+
+        /// Int pin interrupt processing deferred to MCP2515_Service()
+        bool IntDeferred = false;
+
+        /// Int pin interrupt noted, waiting for MCP2515_Service()
+        volatile bool IntPending = false;
+
+        /// longest time spent in Int pin interrupt handler (uS)
+        volatile uint32_t IsrMaxTime = 0;
+
+#if MCP2515_USE_STATS
+        /// statistics (updated inside SPI transactions or critical sections)
+        MCP2515_STATS Stats = { };
+#endif
+
+#if MCP2515_USE_TRACE
+        static_assert((TRACE_CNT & (TRACE_CNT - 1)) == 0, "TRACE_CNT must be a power of 2");
+
+        /// SPI transaction trace (ring of last TRACE_CNT SPI transactions)
+        MCP2515_TRACE_ENTRY Trace[TRACE_CNT];
+
+        /// next SPI transaction trace entry to write
+        uint16_t TraceHead = 0;
+
+        /// number of SPI transaction trace entries
+        uint16_t TraceCnt = 0;
+
+        /// SPI transactions recorded in trace
+        bool TraceOn = true;
+
+        /// SPI transaction in progress start time (uS), instruction and register
+        uint32_t TraceStart;
+        uint8_t TraceInstr;
+        uint8_t TraceReg;
+
+        /// Add entry to SPI transaction trace
+        void MCP2515_TraceAdd(uint8_t instr, uint8_t reg, uint8_t len, uint32_t start);
+#endif
+
+        /// queue of CAN frames waiting for transmission (in transmit order)
+        TX_ENTRY TxQueue[TX_QUEUE_CNT];
+
+        /// number of CAN frames in Tx queue
+        volatile uint8_t TxQueueCnt = 0;
+
+        /// CAN frames loaded into Tx buffers
+        TX_ENTRY TxBuf[MCP2515_N_TXBUFFERS];
+
+        /// Tx buffers (bit n = TXBn) loaded by the transmit scheduler
+        volatile uint8_t TxBufLoaded = 0;
+
+        /// Tx buffer (bit n = TXBn) aborted to make room for a higher priority CAN frame
+        uint8_t TxBufPreempt = 0;
+
+        /// result of blocking transmission (TX_RESULT_PENDING = blocking send in progress)
+        volatile uint8_t TxSyncResult = MCP2515_OK;
+
+        /// Tx buffers transmit order rank (TXP * 3 + n - higher is sent first)
+        uint8_t TxBufRank[MCP2515_N_TXBUFFERS];
+
+        /// Tx buffers TXP priority last written
+        uint8_t TxBufTxp[MCP2515_N_TXBUFFERS];
+
+        /// Tx buffers asynchronous load time (mS)
+        uint32_t TxBufStart[MCP2515_N_TXBUFFERS];
+
+        /// Tx interrupts enabled for asynchronous transmission
+        bool TxIntsEnabled = false;
+
+        /// asynchronous Tx completion callback function
+        void (* MCP2515_TxDoneHandler)(CAN_FRAME *, uint8_t);
+
+        /// CAN error state (ERR_ACTIVE to ERR_BUSOFF)
+        volatile uint8_t ErrState = ERR_ACTIVE;
+
+        /// number of times each CAN error state was entered
+        volatile uint32_t ErrCount[ERR_N_STATES] = { 0 };
+
+        /// last error state poll time (mS)
+        uint32_t ErrPollTime = 0;
+
+        /// CAN error state change callback function
+        void (* MCP2515_ErrorHandler)(uint8_t, const MCP2515_ERROR_STATUS *);
+
+        /// held off the CAN bus (in Configuration mode) after bus-off
+        volatile bool BusOffHold = false;
 
-        /// Terminate MCP2515 SPI transaction
-        inline void MCP2515_EndSPI(void);
+        /// rejoin the CAN bus after bus-off hold-off
+        bool BusOffAuto = true;
+
+        /// operation mode to restore when rejoining the CAN bus
+        uint8_t BusOffMode = MODE_NORMAL;
+
+        /// bus-off hold-off min and max (mS)
+        uint16_t BusOffMinMs = BUSOFF_BACKOFF_MIN_MS;
+        uint16_t BusOffMaxMs = BUSOFF_BACKOFF_MAX_MS;
+
+        /// current bus-off hold-off (mS - 0 = no recent bus-off)
+        uint32_t BusOffDelay = 0;
+
+        /// bus-off hold-off start and CAN bus rejoin times (mS)
+        uint32_t BusOffStart = 0;
+        uint32_t BusOffRejoin = 0;
+
+        /// interrupts already disabled (inside interrupt handler or critical section)
+        static volatile bool IntsDisabled;
+
+        /// Enter critical section (interrupts disabled) if not already in one
+        inline bool MCP2515_Lock(void);
+
+        /// Exit critical section entered by MCP2515_Lock()
+        inline void MCP2515_Unlock(bool locked);
+
+        /// Initialize MCP2515 device with CNF3, CNF2, CNF1 register values
+        uint8_t MCP2515_InitCnf(uint8_t cnf[]);
+
+        /// Get CNF3, CNF2, CNF1 register values for CAN speed with MCP2515 oscillator
+        uint8_t MCP2515_LookupBitTiming(uint8_t canSpeed, uint8_t cnf[]);
+
+        /// Write CNF3, CNF2, CNF1 register values (in Configuration mode, then restore mode)
+        uint8_t MCP2515_WriteBitTiming(uint8_t cnf[]);
+
+        /// Update CAN error state from error status (CANSTAT OPMOD 'mode')
+        void MCP2515_UpdateErrorState(MCP2515_ERROR_STATUS * status, uint8_t mode);
+
+        /// Count and clear Rx buffer overrun flags of EFLG value 'eflg'
+        void MCP2515_CheckRxOverrun(uint8_t eflg);
+
+        /// Abort all CAN transmissions and hold MCP2515 off the CAN bus
+        void MCP2515_EnterBusOff(uint8_t mode);
+
+        /// Return to the operation mode before bus-off
+        void MCP2515_RejoinBus(void);
+
+        /// Poll error state when not reported by error interrupts
+        void MCP2515_ServiceErrors(void);
+
+        /// Wait until MCP2515 operation mode (CANSTAT OPMOD) is 'mode', up to 'timeout_us' uS
+        bool MCP2515_WaitMode(uint8_t mode, uint32_t timeout_us);
+
+        /// Initiate MCP2515 SPI transaction of instruction 'instr' (at register 'reg')
+        inline void MCP2515_StartSPI(uint8_t instr, uint8_t reg);
+
+        /// Terminate MCP2515 SPI transaction of 'bytes' bytes
+        inline void MCP2515_EndSPI(uint8_t bytes);
 
         /// Prepare ID field data
         ///  - supports standard 11-bit CAN data frames
@@ -449,32 +1256,90 @@ class DLK_MCP2515
         ///  - RTR (Remote Transmission Request) supported
         uint8_t MCP2515_SendMessage(CAN_FRAME * frame);
 
+        /// Load ID, DLC and CAN data of CAN frame into specified Tx buffer (TXB0 to TXB2)
+        ///  - single LOAD TX BUFFER instruction transaction
+        void MCP2515_LoadTxBuffer(uint8_t tx_num, CAN_FRAME * frame);
+
+        /// Request transmission of specified Tx buffers (bit n = TXBn)
+        ///  - single RTS instruction byte
+        void MCP2515_RequestToSend(uint8_t tx_bits);
+
+        /// Get transmit order key of CAN frame (priority, then CAN ID arbitration order)
+        uint32_t MCP2515_TxKey(CAN_FRAME * frame, uint8_t prio);
+
+        /// Insert CAN frame into Tx queue in transmit order
+        void MCP2515_QueueTx(TX_ENTRY * entry, bool ahead);
+
+        /// Remove CAN frame from Tx queue
+        void MCP2515_UnqueueTx(uint8_t ndx);
+
+        /// Select rank of free Tx buffer between Tx buffer ranks 'lo' and 'hi'
+        uint8_t MCP2515_SelectTxRank(uint8_t freebits, int8_t lo, int8_t hi);
+
+        /// Load queued CAN frames into free Tx buffers, keeping transmit order
+        void MCP2515_FillTx(void);
+
+        /// Report completed and abort timed out asynchronous CAN frames, then refill Tx buffers
+        ///  - called with interrupts disabled
+        void MCP2515_HandleTx(void);
+
+        /// MCP2515_HandleTx() with READ STATUS 'status' already read
+        void MCP2515_HandleTx(uint8_t status);
+
         /// 1) Determine if CAN message has been received \n
-        /// 2) Determine Rx buffer containing CAN message
+        /// 2) Determine Rx buffer(s) containing CAN message
         uint8_t MCP2515_CheckCAN_Rx(void);
 
-        /// 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 (includes IDE bit)
-        uint32_t MCP2515_ReadCAN_ID(uint8_t id_addr);
+        /// Select Rx buffer holding the oldest CAN message for Rx status 'status'
+        uint8_t MCP2515_OldestRxBuf(uint8_t status);
+
+        /// Receive CAN message from Rx buffer into Rx ring buffer and notify application
+        void MCP2515_RecvToRing(uint8_t rx_num);
+
+        /// Receive all CAN messages from Rx buffers into Rx ring buffer, oldest first
+        void MCP2515_DrainRx(uint8_t status);
+
+        /// 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 field data (includes IDE and SRR bits)
+        uint32_t MCP2515_ParseCAN_ID(const uint8_t id_data[]);
 
-        /// 3) Get ID/EID from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 (includes IDE bit) \n
-        /// 4) Get RTR from RXBnCTRL \n
-        /// 5) Get DLC from RXBnDLC \n
-        /// 6) Get CAN data from RXBnD0 to RXBnD7
-        void MCP2515_ReadCAN_Msg(uint8_t rxbn_addr, CAN_FRAME * frame);
+        /// 3) Get ID/EID and RTR from RXBnSIDH, RXBnSIDL, RXBnEID8, RXBnEID0 \n
+        /// 4) Get DLC (and extended RTR) from RXBnDLC \n
+        /// 5) Get CAN data from RXBnD0 to RXBnD7 \n
+        /// 6) Notify MCP2515 that CAN message has been retrieved \n
+        ///  - single READ RX BUFFER instruction transaction (RXnIF auto-cleared) \n
+        ///  - returns false if rejected by software filter (data bytes not read)
+        bool MCP2515_ReadCAN_Msg(uint8_t rx_num, CAN_FRAME * frame);
 
         /// MCP2515 Int pin handler
         void MCP2515_HandleInterrupt(void);
 
-        /// MCP2515 Int pin handler
+        /// Process MCP2515 Tx, Rx and other interrupts
+        void MCP2515_ProcessInts(void);
+
+        /// Set up servicing by a DLK_SpiBus (Int pin 'int_pin' polled, or READ STATUS polled if < 0)
+        uint8_t MCP2515_AttachPolled(int int_pin, void (* callback)(CAN_FRAME *));
+
+        /// End servicing by a DLK_SpiBus
+        void MCP2515_DetachPolled(void);
+
+        /// Service MCP2515 Tx, Rx and error state from READ STATUS 'status' (no Int pin)
+        void MCP2515_PollStatus(uint8_t status);
+
+        /// Servicing due without an interrupt (error state poll, or Tx timeout)
+        bool MCP2515_PollDue(void);
+
 #if (MAX_INTS > 0)
-        static void MCP2515_OnInterrupt1(void);
-#if (MAX_INTS > 1)
-        static void MCP2515_OnInterrupt2(void);
-#if (MAX_INTS > 2)
-        static void MCP2515_OnInterrupt3(void);
-        static void MCP2515_OnInterrupt4(void);
-#endif
-#endif
+        /// MCP2515 Int pin handler for Int line slot N
+        template <uint8_t N>
+        static void MCP2515_OnInterrupt(void);
+
+        /// table of MCP2515 Int pin handlers for Int line slots Ns...
+        template <uint8_t... Ns>
+        struct IntHandlers;
+
+        /// IntHandlers<0, 1, ... N - 1> generator (Table)
+        template <uint8_t N, uint8_t... Ns>
+        struct IntHandlersOf;
 #endif
 };
 #endif  // __DLK_MCP2515_H__
@@ -0,0 +1,402 @@
+/** \file DLK_ObdResponder.h */
+/*
+ * NAME: DLK_ObdResponder.h
+ *
+ * WHAT:
+ *  Header file for table-driven OBD-II (SAE J1979) service/PID responder class.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  The application's table of (mode, PID) entries is kept in flash (PROGMEM), sorted by
+ *  mode then PID - checked at compile time with \ref ObdTableSorted() in a static_assert.
+ *  Each entry replies with a static payload (in flash) or the payload built by its
+ *  handler function.
+ *
+ *  Begin() builds a 256-bit supported-PID bitmap for each mode with PIDs (01, 02, 05, 06,
+ *  08, 09), so each request is looked up in constant time: a bit test, plus the count of
+ *  bits below the PID to index the table (no search).
+ *
+ *  The "supported PIDs" replies (PIDs 0x00, 0x20, 0x40, ... 0xE0) are generated from the
+ *  bitmap, any table entries for them only mark the mode (or next range) supported.
+ *
+ *  The modes without PIDs (03, 04, 07, 0A) have a single table entry (PID 0), and their
+ *  replies have no PID byte.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_OBDRESPONDER_H__
+#define __DLK_OBDRESPONDER_H__
+
+#include <Arduino.h>
+
+#define OBD_MODE_CNT        0x10    // modes (service IDs) 0x00-0x0F
+
+// modes with PIDs (bit per mode)
+#define OBD_PID_MODES       ((1 << 0x01) | (1 << 0x02) | (1 << 0x05) | (1 << 0x06) | (1 << 0x08) | (1 << 0x09))
+
+// max number of modes with PIDs in table (may be predefined to override)
+#ifndef OBD_MAP_CNT
+#if defined(__AVR__)
+#define OBD_MAP_CNT         3
+#else
+#define OBD_MAP_CNT         6
+#endif
+#endif
+
+// max reply length, mode and PID bytes included (may be predefined to override - up to 255)
+#ifndef OBD_REPLY_MAX
+#if defined(__AVR__)
+#define OBD_REPLY_MAX       32
+#else
+#define OBD_REPLY_MAX       255
+#endif
+#endif
+
+#define OBD_RESPONSE_BIT    0x40    // positive response mode bit
+#define OBD_NEG_RESPONSE    0x7F    // negative response service ID
+#define OBD_NRC_UNSUPPORTED 0x12    // negative response code (sub-function not supported)
+#define OBD_NOT_SUPPORTED   0xFF    // handler result for negative response
+
+/// OBD-II reply table entry (see DLK_ObdResponder::Begin())
+typedef struct obd_pid
+{
+    /// mode (service ID 0x01-0x0F)
+    uint8_t mode;
+    /// PID (0 for modes without PIDs)
+    uint8_t pid;
+    /// static payload length
+    uint8_t len;
+    /// static payload after mode/PID bytes (in flash - PROGMEM), when no handler
+    const uint8_t * data;
+    /// handler building payload after mode/PID bytes (max OBD_REPLY_MAX - 2), returning
+    /// its length or OBD_NOT_SUPPORTED (nullptr = static payload)
+    uint8_t (* handler)(uint8_t mode, uint8_t pid, uint8_t * payload);
+} OBD_PID;
+
+/**
+ * Check at compile time that OBD-II reply table is sorted by mode then PID (no duplicates).
+ *
+ * \param table: the reply table (constexpr)
+ * \param i: the entry to start at {optional}
+ *
+ * \return   true = table sorted
+ * \return   false = table not sorted
+ */
+template <uint16_t N>
+constexpr bool ObdTableSorted(const OBD_PID (&table)[N], uint16_t i = 1)
+{
+    return (i >= N) ||
+           ((((table[i - 1].mode << 8) | table[i - 1].pid) < ((table[i].mode << 8) | table[i].pid)) &&
+            ObdTableSorted(table, i + 1));
+}
+
+/**
+ * Table-driven OBD-II service/PID responder.
+ */
+class DLK_ObdResponder
+{
+    static_assert((OBD_REPLY_MAX >= 8) && (OBD_REPLY_MAX <= 255), "OBD_REPLY_MAX must be 8 to 255");
+    static_assert((OBD_MAP_CNT >= 1) && (OBD_MAP_CNT < 0xFF), "OBD_MAP_CNT must be 1 to 254");
+
+    public:
+        DLK_ObdResponder(void)
+        {
+            Begin(nullptr, 0);
+        }
+
+        /**
+         * Setup reply table (build supported-PID bitmaps).
+         *
+         * \param table: the reply table (in flash - PROGMEM, kept in use - not copied)
+         * \param cnt: the number of entries
+         *
+         * \return   true = reply table set
+         * \return   false = table not sorted by mode then PID, invalid mode or payload length,
+         *                   more than one entry (or PID not 0) for a mode without PIDs, or more
+         *                   than \ref OBD_MAP_CNT modes with PIDs - no replies
+         *
+         *  \note Resets the request counters.
+         */
+        bool Begin(const OBD_PID * table, uint16_t cnt)
+        {
+            OBD_PID entry;
+            uint16_t key = 0;
+            uint8_t maps = 0;
+
+            Table = table;
+            Requests = 0;
+            Negatives = 0;
+            Clear();
+            if ((cnt > 0x7FFF) || ((cnt > 0) && (table == nullptr)))
+            {
+                return false;
+            }
+
+            for (uint16_t i = 0; i < cnt; ++i)
+            {
+                memcpy_P(&entry, &table[i], sizeof(entry));
+                if ((entry.mode >= OBD_MODE_CNT) || (entry.len > OBD_REPLY_MAX - 2) ||
+                    ((i > 0) && (((entry.mode << 8) | entry.pid) <= key)))
+                {
+                    Clear();
+                    return false;
+                }
+                key = (entry.mode << 8) | entry.pid;
+
+                if (Base[entry.mode] < 0)
+                {
+                    Base[entry.mode] = i;       // first entry of mode
+                    if (OBD_PID_MODES & (1 << entry.mode))
+                    {
+                        if (maps >= OBD_MAP_CNT)
+                        {
+                            Clear();
+                            return false;
+                        }
+                        Map[entry.mode] = maps++;
+                    }
+                }
+                if (Map[entry.mode] == OBD_NO_MAP)
+                {
+                    if ((entry.pid != 0) || (Base[entry.mode] != i))
+                    {
+                        Clear();
+                        return false;           // mode without PIDs - single entry
+                    }
+                }
+                else
+                {
+                    Bits[Map[entry.mode]][entry.pid >> 5] |= 1UL << (entry.pid & 0x1F);
+                }
+            }
+            Cnt = cnt;
+            return true;
+        }
+
+        /**
+         * Get number of table entries.
+         *
+         * \return   uint16_t = the number of entries (0 = no table set)
+         */
+        uint16_t Count(void) const
+        {
+            return Cnt;
+        }
+
+        /**
+         * Check if mode/PID is supported.
+         *
+         * \param mode: the mode (service ID)
+         * \param pid: the PID (not used for modes without PIDs)
+         *
+         * \return   true = replied to (positive response, unless refused by handler)
+         * \return   false = not supported
+         */
+        bool Supported(uint8_t mode, uint8_t pid) const
+        {
+            if ((mode >= OBD_MODE_CNT) || (Base[mode] < 0))
+            {
+                return false;
+            }
+            if (Map[mode] == OBD_NO_MAP)
+            {
+                return true;
+            }
+            if ((pid & 0x1F) == 0)
+            {
+                return (pid == 0) || AnyFrom(Map[mode], pid + 1);
+            }
+            return Test(Map[mode], pid);
+        }
+
+        /**
+         * Build reply to request.
+         *
+         * \param mode: the mode (service ID) requested
+         * \param pid: the PID requested (not used for modes without PIDs)
+         * \param reply: the place to store the reply (\ref OBD_REPLY_MAX bytes)
+         *
+         * \return   uint8_t = the reply length - positive response (mode | 0x40, PID, payload),
+         *           or negative response (0x7F, mode, 0x12) when not supported
+         */
+        uint8_t Respond(uint8_t mode, uint8_t pid, uint8_t * reply)
+        {
+            OBD_PID entry;
+            uint8_t slot;
+            uint8_t hdr;
+            uint8_t len;
+            int16_t idx;
+
+            Requests++;
+            if (!Supported(mode, pid))
+            {
+                return Negative(mode, reply);
+            }
+            slot = Map[mode];
+            reply[0] = OBD_RESPONSE_BIT | mode;
+            if (slot == OBD_NO_MAP)
+            {
+                hdr = 1;                        // no PID byte
+                idx = Base[mode];
+            }
+            else
+            {
+                hdr = 2;
+                reply[1] = pid;
+                if ((pid & 0x1F) == 0)
+                {
+                    SupportedPids(slot, pid, &reply[2]);
+                    return 2 + 4;
+                }
+                idx = Base[mode] + Rank(slot, pid);
+            }
+
+            memcpy_P(&entry, &Table[idx], sizeof(entry));
+            if (entry.handler != nullptr)
+            {
+                len = entry.handler(mode, pid, &reply[hdr]);
+                if ((len == OBD_NOT_SUPPORTED) || (len > OBD_REPLY_MAX - hdr))
+                {
+                    return Negative(mode, reply);
+                }
+            }
+            else
+            {
+                len = (entry.data != nullptr) ? entry.len : 0;
+                memcpy_P(&reply[hdr], entry.data, len);
+            }
+            return hdr + len;
+        }
+
+        /**
+         * Get number of requests replied to (positive and negative).
+         *
+         * \return   uint32_t = the number of requests
+         */
+        uint32_t RequestCount(void) const
+        {
+            return Requests;
+        }
+
+        /**
+         * Get number of negative responses.
+         *
+         * \return   uint32_t = the number of requests not supported
+         */
+        uint32_t NegativeCount(void) const
+        {
+            return Negatives;
+        }
+
+    private:
+        /// Map of mode without PIDs
+        static constexpr uint8_t OBD_NO_MAP = 0xFF;
+
+        /// Clear table lookup (no modes supported)
+        void Clear(void)
+        {
+            Cnt = 0;
+            for (uint8_t mode = 0; mode < OBD_MODE_CNT; ++mode)
+            {
+                Base[mode] = -1;
+                Map[mode] = OBD_NO_MAP;
+            }
+            memset(Bits, 0, sizeof(Bits));
+        }
+
+        /// Check PID bit of bitmap
+        bool Test(uint8_t slot, uint8_t pid) const
+        {
+            return (Bits[slot][pid >> 5] >> (pid & 0x1F)) & 1;
+        }
+
+        /// Check for any PID bit of bitmap from 'pid' up
+        bool AnyFrom(uint8_t slot, uint16_t pid) const
+        {
+            if (pid > 0xFF)
+            {
+                return false;
+            }
+            if (Bits[slot][pid >> 5] >> (pid & 0x1F))
+            {
+                return true;
+            }
+            for (uint8_t w = (pid >> 5) + 1; w < 8; ++w)
+            {
+                if (Bits[slot][w])
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Number of PID bits of bitmap below 'pid' (table index of PID from first of mode)
+        uint8_t Rank(uint8_t slot, uint8_t pid) const
+        {
+            uint8_t w = pid >> 5;
+            uint8_t cnt = __builtin_popcountl(Bits[slot][w] & ((1UL << (pid & 0x1F)) - 1));
+
+            while (w > 0)
+            {
+                cnt += __builtin_popcountl(Bits[slot][--w]);
+            }
+            return cnt;
+        }
+
+        /// Supported PIDs bitmask of range after 'pid' (MSB first - last bit = next range)
+        void SupportedPids(uint8_t slot, uint8_t pid, uint8_t * mask) const
+        {
+            uint32_t bits = 0;
+
+            for (uint8_t i = 1; i < 32; ++i)
+            {
+                if (Test(slot, pid + i))
+                {
+                    bits |= 1UL << (32 - i);
+                }
+            }
+            if (AnyFrom(slot, pid + 33))
+            {
+                bits |= 1;                      // next range supported
+            }
+            mask[0] = (uint8_t)(bits >> 24);
+            mask[1] = (uint8_t)(bits >> 16);
+            mask[2] = (uint8_t)(bits >> 8);
+            mask[3] = (uint8_t)bits;
+        }
+
+        /// Negative response
+        uint8_t Negative(uint8_t mode, uint8_t * reply)
+        {
+            Negatives++;
+            reply[0] = OBD_NEG_RESPONSE;
+            reply[1] = mode;
+            reply[2] = OBD_NRC_UNSUPPORTED;
+            return 3;
+        }
+
+        /// reply table (in flash)
+        const OBD_PID * Table = nullptr;
+
+        /// number of table entries
+        uint16_t Cnt = 0;
+
+        /// first table entry of each mode (-1 = mode not supported)
+        int16_t Base[OBD_MODE_CNT];
+
+        /// supported-PID bitmap of each mode (OBD_NO_MAP = mode without PIDs)
+        uint8_t Map[OBD_MODE_CNT];
+
+        /// supported-PID bitmaps (bit per PID)
+        uint32_t Bits[OBD_MAP_CNT][8];
+
+        /// requests replied to
+        uint32_t Requests = 0;
+
+        /// negative responses
+        uint32_t Negatives = 0;
+};
+
+#endif  // __DLK_OBDRESPONDER_H__
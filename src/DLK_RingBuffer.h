@@ -0,0 +1,172 @@
+/** \file DLK_RingBuffer.h */
+/*
+ * NAME: DLK_RingBuffer.h
+ *
+ * WHAT:
+ *  Header file for single-producer/single-consumer ring buffer template class.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Lock-free - the producer (e.g. interrupt handler) only writes the 'Head' count
+ *  and the consumer (e.g. loop()) only writes the 'Tail' count, so no interrupt
+ *  disabling is needed as long as there is only one of each.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_RINGBUFFER_H__
+#define __DLK_RINGBUFFER_H__
+
+#include <stdint.h>
+
+/// compiler memory barrier (order slot data access and head/tail count updates)
+#define RING_BARRIER()  __asm__ __volatile__("" ::: "memory")
+
+/**
+ * Single-producer/single-consumer ring buffer of \b CNT items of type \b T.
+ *
+ * \b CNT must be a power of 2 (2 to 128).
+ */
+template <typename T, uint8_t CNT>
+class DLK_RingBuffer
+{
+    static_assert((CNT >= 2) && (CNT <= 128) && ((CNT & (CNT - 1)) == 0), "CNT must be a power of 2 (2 to 128)");
+
+    public:
+        /**
+         * Get place for next item to add (producer).
+         *
+         * \return   T * = the place to store the item, then call \ref Commit \n
+         *           nullptr = ring buffer full (call \ref Drop if item is discarded)
+         */
+        T * Reserve(void)
+        {
+            if ((uint8_t)(Head - Tail) >= CNT)
+            {
+                return nullptr;
+            }
+            return &Items[Head & (CNT - 1)];
+        }
+
+        /**
+         * Add item stored at place from \ref Reserve to ring buffer (producer).
+         *
+         *  \return None.
+         */
+        void Commit(void)
+        {
+            RING_BARRIER();
+            Head = Head + 1;
+            if ((uint8_t)(Head - Tail) > HighWater)
+            {
+                HighWater = (uint8_t)(Head - Tail);
+            }
+        }
+
+        /**
+         * Count item discarded due to ring buffer full (producer).
+         *
+         *  \return None.
+         */
+        void Drop(void)
+        {
+            Overflows = Overflows + 1;
+        }
+
+        /**
+         * Add copy of item to ring buffer (producer).
+         *
+         * \param item: the item to add
+         *
+         * \return   true = item added
+         * \return   false = ring buffer full (overflow counted)
+         */
+        bool Push(const T & item)
+        {
+            T * slot = Reserve();
+
+            if (slot == nullptr)
+            {
+                Drop();
+                return false;
+            }
+            *slot = item;
+            Commit();
+            return true;
+        }
+
+        /**
+         * Get number of items in ring buffer (consumer).
+         *
+         * \return   uint8_t = the number of items available
+         */
+        uint8_t Available(void) const
+        {
+            return (uint8_t)(Head - Tail);
+        }
+
+        /**
+         * Remove oldest item from ring buffer (consumer).
+         *
+         * \param item: the place to store the removed item
+         *
+         * \return   true = item removed
+         * \return   false = ring buffer empty
+         */
+        bool Pop(T * item)
+        {
+            if (Head == Tail)
+            {
+                return false;
+            }
+            RING_BARRIER();
+            *item = Items[Tail & (CNT - 1)];
+            RING_BARRIER();
+            Tail = Tail + 1;
+            return true;
+        }
+
+        /**
+         * Get oldest item in ring buffer without removing it (consumer).
+         *
+         * \return   T * = the oldest item (valid until removed) \n
+         *           nullptr = ring buffer empty
+         */
+        T * Peek(void)
+        {
+            if (Head == Tail)
+            {
+                return nullptr;
+            }
+            RING_BARRIER();
+            return &Items[Tail & (CNT - 1)];
+        }
+
+        /**
+         * Remove all items from ring buffer (consumer).
+         *
+         *  \return None.
+         */
+        void Clear(void)
+        {
+            Tail = Head;
+        }
+
+        /// number of items not added due to ring buffer full
+        volatile uint32_t Overflows = 0;
+
+        /// highest number of items ever in ring buffer
+        volatile uint8_t HighWater = 0;
+
+    private:
+        /// ring buffer items storage
+        T Items[CNT];
+
+        /// free-running count of added items (only written by producer)
+        volatile uint8_t Head = 0;
+
+        /// free-running count of removed items (only written by consumer)
+        volatile uint8_t Tail = 0;
+};
+
+#endif  // __DLK_RINGBUFFER_H__
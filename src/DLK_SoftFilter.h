@@ -0,0 +1,222 @@
+/** \file DLK_SoftFilter.h */
+/*
+ * NAME: DLK_SoftFilter.h
+ *
+ * WHAT:
+ *  Header file for software CAN ID acceptance filter class.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Second stage behind the MCP2515 hardware masks and filters (2 masks, 6 filters):
+ *  standard 11-bit IDs are looked up in a 2048-bit bitmap, extended 29-bit IDs in a
+ *  small open addressing hash set (\ref SOFT_FILTER_EXT_CNT IDs).
+ *
+ *  Change the filter only while it is not attached to a receiving MCP2515 (or with
+ *  interrupts disabled), as the Rx interrupt handler may be checking it.
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_SOFTFILTER_H__
+#define __DLK_SOFTFILTER_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "can.h"
+
+// max number of extended IDs in software filter - must be a power of 2 (may be predefined to override)
+#ifndef SOFT_FILTER_EXT_CNT
+#define SOFT_FILTER_EXT_CNT     32
+#endif
+
+/**
+ * Software CAN ID acceptance filter.
+ */
+class DLK_SoftFilter
+{
+    static_assert((SOFT_FILTER_EXT_CNT >= 2) && (SOFT_FILTER_EXT_CNT <= 256) &&
+                  ((SOFT_FILTER_EXT_CNT & (SOFT_FILTER_EXT_CNT - 1)) == 0),
+                  "SOFT_FILTER_EXT_CNT must be a power of 2 (2 to 256)");
+
+    public:
+        DLK_SoftFilter(void)
+        {
+            Clear();
+        }
+
+        /**
+         * Remove all CAN IDs (reject all CAN frames).
+         *
+         *  \return None.
+         */
+        void Clear(void)
+        {
+            memset(Std, 0, sizeof(Std));
+            memset(Ext, 0, sizeof(Ext));
+            ExtCnt = 0;
+            AllExt = false;
+        }
+
+        /**
+         * Accept standard CAN ID.
+         *
+         * \param id: the standard 11-bit CAN ID
+         *
+         *  \return None.
+         */
+        void AddStd(uint16_t id)
+        {
+            id &= CAN_SFF_MASK;
+            Std[id >> 3] |= (uint8_t)(1 << (id & 7));
+        }
+
+        /**
+         * Accept range of standard CAN IDs.
+         *
+         * \param first: the first standard 11-bit CAN ID
+         * \param last: the last standard 11-bit CAN ID
+         *
+         *  \return None.
+         */
+        void AddStdRange(uint16_t first, uint16_t last)
+        {
+            for (uint16_t id = first; (id <= last) && (id <= CAN_SFF_MASK); ++id)
+            {
+                AddStd(id);
+            }
+        }
+
+        /**
+         * Stop accepting standard CAN ID.
+         *
+         * \param id: the standard 11-bit CAN ID
+         *
+         *  \return None.
+         */
+        void RemoveStd(uint16_t id)
+        {
+            id &= CAN_SFF_MASK;
+            Std[id >> 3] &= (uint8_t)~(1 << (id & 7));
+        }
+
+        /**
+         * Accept extended CAN ID.
+         *
+         * \param id: the extended 29-bit CAN ID
+         *
+         * \return   true = CAN ID accepted
+         * \return   false = no room for CAN ID (\ref SOFT_FILTER_EXT_CNT)
+         */
+        bool AddExt(uint32_t id)
+        {
+            uint32_t key = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+            uint8_t i = Hash(key);
+
+            for (uint16_t n = 0; n < SOFT_FILTER_EXT_CNT; ++n)
+            {
+                if (Ext[i] == key)
+                {
+                    return true;        // already there
+                }
+                if (Ext[i] == 0)
+                {
+                    Ext[i] = key;
+                    ExtCnt++;
+                    return true;
+                }
+                i = (i + 1) & (SOFT_FILTER_EXT_CNT - 1);
+            }
+            return false;
+        }
+
+        /**
+         * Accept all extended CAN IDs (only filter standard CAN IDs).
+         *
+         *  \return None.
+         */
+        void AddAllExt(void)
+        {
+            AllExt = true;
+        }
+
+        /**
+         * Get number of extended CAN IDs accepted.
+         *
+         * \return   uint16_t = the number of extended CAN IDs
+         */
+        uint16_t ExtCount(void) const
+        {
+            return ExtCnt;
+        }
+
+        /**
+         * Check if CAN frame is accepted.
+         *
+         * \param can_id: the CAN ID of the CAN frame (with EFF/RTR flags)
+         *
+         * \return   true = CAN frame accepted
+         * \return   false = CAN frame rejected
+         */
+        bool Accept(uint32_t can_id) const
+        {
+            uint32_t key;
+            uint8_t i;
+
+            if (!(can_id & CAN_EFF_FLAG))
+            {
+                can_id &= CAN_SFF_MASK;
+                return (Std[can_id >> 3] & (uint8_t)(1 << (can_id & 7))) != 0;
+            }
+
+            if (AllExt)
+            {
+                return true;
+            }
+            key = (can_id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+            i = Hash(key);
+            // linear probe until found or an empty place (no IDs are ever removed)
+            for (uint16_t n = 0; n < SOFT_FILTER_EXT_CNT; ++n)
+            {
+                if (Ext[i] == key)
+                {
+                    return true;
+                }
+                if (Ext[i] == 0)
+                {
+                    return false;
+                }
+                i = (i + 1) & (SOFT_FILTER_EXT_CNT - 1);
+            }
+            return false;
+        }
+
+    private:
+        /// log base 2 of power of 2 \b n
+        static constexpr uint8_t Log2(uint16_t n)
+        {
+            return (n > 1) ? (uint8_t)(1 + Log2(n >> 1)) : 0;
+        }
+
+        /// hash set place for extended CAN ID key (multiplicative hash, top log2(CNT) bits)
+        static uint8_t Hash(uint32_t key)
+        {
+            constexpr uint8_t shift = 32 - Log2(SOFT_FILTER_EXT_CNT);
+
+            return (uint8_t)((uint32_t)(key * 0x9E3779B1UL) >> shift);
+        }
+
+        /// standard CAN IDs bitmap (bit n = CAN ID n accepted)
+        uint8_t Std[(CAN_SFF_MASK + 1) / 8];
+
+        /// extended CAN IDs hash set (CAN ID | CAN_EFF_FLAG, 0 = empty place)
+        uint32_t Ext[SOFT_FILTER_EXT_CNT];
+
+        /// number of extended CAN IDs in hash set
+        uint16_t ExtCnt;
+
+        /// accept all extended CAN IDs
+        bool AllExt;
+};
+
+#endif  // __DLK_SOFTFILTER_H__
@@ -0,0 +1,269 @@
+/** \file DLK_SpiBus.h */
+/*
+ * NAME: DLK_SpiBus.h
+ *
+ * WHAT:
+ *  Header file for shared SPI bus scheduler class for several MCP2515s on one SPI port.
+ *
+ * SPECIAL CONSIDERATIONS:
+ *  Each Service() pass holds one SPI transaction (beginTransaction() with the SPI settings
+ *  shared by all MCP2515s attached) for all its SPI operations and services each attached
+ *  MCP2515 at most once, starting one MCP2515 further on each pass (round-robin):
+ *   1) MCP2515s with an Int pin (deferred mode Int line interrupt, or Int pin polled)
+ *      whose Int pin is low or interrupt noted - idle ones cost no SPI at all
+ *   2) MCP2515s without an Int pin - READ STATUS of all of them back to back (once every
+ *      poll interval), then servicing of those with Rx/Tx flags set
+ *
+ *  Received CAN frames are stored in the Rx ring buffer of each MCP2515 (\ref
+ *  DLK_MCP2515::MCP2515_Pop) and the callbacks are called from Service(), with the SPI
+ *  transaction held (keep them short). Asynchronous transmissions (\ref
+ *  DLK_MCP2515::MCP2515_SendAsync) are completed by Service().
+ *
+ * AUTHOR:
+ *  D.L. Karmann
+ *
+ */
+#ifndef __DLK_SPIBUS_H__
+#define __DLK_SPIBUS_H__
+
+#include "DLK_MCP2515.h"
+
+// max number of MCP2515s on one SPI bus scheduler (may be predefined to override)
+#ifndef SPI_BUS_MAX_DEVS
+#define SPI_BUS_MAX_DEVS    8
+#endif
+
+/**
+ * Shared SPI bus scheduler for several MCP2515s on one SPI port.
+ */
+class DLK_SpiBus
+{
+    public:
+        DLK_SpiBus(void)
+        {
+        }
+
+        /**
+         * Attach MCP2515 to be serviced by the SPI bus scheduler.
+         *
+         * \param mcp: the MCP2515 (after \ref DLK_MCP2515::MCP2515_Init)
+         * \param callback: the application callback function to call with each received
+         *                  CAN frame (may be nullptr) {optional}
+         * \param int_pin: the MCP2515 Int pin to poll (-1 = no Int pin - poll the MCP2515
+         *                 with READ STATUS) {optional}
+         *
+         * \return   MCP2515_FAIL = SPI bus scheduler full (\ref SPI_BUS_MAX_DEVS), MCP2515
+         *                          already attached or not initialized, on another SPI port
+         *                          or with other SPI settings (speed or mode), or Int line
+         *                          interrupt not in deferred mode
+         * \return   MCP2515_OK = MCP2515 attached
+         *
+         *  \note An MCP2515 with an Int line interrupt (\ref DLK_MCP2515::MCP2515_OnRxInterrupt
+         *        with \b deferred true) keeps its Int pin and callback (\b callback and
+         *        \b int_pin are not used).
+         *
+         *  \note A polled Int pin needs no interrupt (usable without \ref MAX_INTS Int lines).
+         */
+        uint8_t Attach(DLK_MCP2515 * mcp, void (* callback)(CAN_FRAME *) = nullptr, int int_pin = -1)
+        {
+            if ((mcp == nullptr) || (Cnt >= SPI_BUS_MAX_DEVS) || (mcp->SPI_dev == nullptr))
+            {
+                return MCP2515_FAIL;
+            }
+            for (uint8_t i = 0; i < Cnt; ++i)
+            {
+                if (Devs[i] == mcp)
+                {
+                    return MCP2515_FAIL;        // already attached
+                }
+            }
+            if ((Cnt > 0) && ((mcp->SPI_dev != Devs[0]->SPI_dev) || (mcp->HW_CS_pin != Devs[0]->HW_CS_pin) ||
+                              (mcp->SPI_speed != Devs[0]->SPI_speed)))
+            {
+                return MCP2515_FAIL;            // another SPI port (or SPI mode or speed)
+            }
+            if (mcp->MCP2515_AttachPolled(int_pin, callback) != MCP2515_OK)
+            {
+                return MCP2515_FAIL;
+            }
+            Devs[Cnt++] = mcp;
+            return MCP2515_OK;
+        }
+
+        /**
+         * Stop servicing MCP2515 by the SPI bus scheduler.
+         *
+         * \param mcp: the MCP2515 attached
+         *
+         * \return   MCP2515_FAIL = MCP2515 not attached
+         * \return   MCP2515_OK = MCP2515 detached
+         *
+         *  \note Asynchronous transmissions then need \ref DLK_MCP2515::MCP2515_ServiceTx.
+         */
+        uint8_t Detach(DLK_MCP2515 * mcp)
+        {
+            for (uint8_t i = 0; i < Cnt; ++i)
+            {
+                if (Devs[i] == mcp)
+                {
+                    mcp->MCP2515_DetachPolled();
+                    for (--Cnt; i < Cnt; ++i)
+                    {
+                        Devs[i] = Devs[i + 1];
+                    }
+                    if (Next >= Cnt)
+                    {
+                        Next = 0;
+                    }
+                    return MCP2515_OK;
+                }
+            }
+            return MCP2515_FAIL;
+        }
+
+        /**
+         * Set min time between READ STATUS polls of the MCP2515s without an Int pin.
+         *
+         * \param us: the poll interval (uS - 0 = every Service() pass)
+         *
+         *  \return None.
+         *
+         *  \note Both Rx buffers of an MCP2515 fill in 2 CAN frame times (about 220 uS
+         *        at 1 Mbps), so polling less often can overrun them.
+         */
+        void SetPollInterval(uint16_t us)
+        {
+            PollUs = us;
+        }
+
+        /**
+         * Get number of MCP2515s attached.
+         *
+         * \return   uint8_t = the number of MCP2515s
+         */
+        uint8_t Count(void) const
+        {
+            return Cnt;
+        }
+
+        /**
+         * Service the attached MCP2515s (one round-robin pass).
+         *  - call often from loop()
+         *
+         * \return   uint8_t = the number of MCP2515s that had Rx/Tx/error work
+         */
+        uint8_t Service(void)
+        {
+            uint8_t status[SPI_BUS_MAX_DEVS];
+            uint8_t busy = 0;
+            DLK_MCP2515 * mcp;
+
+            if (Cnt == 0)
+            {
+                return 0;
+            }
+
+            // 1) MCP2515s with Int pin low (or interrupt noted) - just a pin read for idle ones
+            for (uint8_t n = 0; n < Cnt; ++n)
+            {
+                mcp = Devs[(Next + n) % Cnt];
+                if (mcp->IntPin < 0)
+                {
+                    continue;
+                }
+                if (mcp->IntPending || (digitalRead(mcp->IntPin) == LOW))
+                {
+                    Hold();
+                    mcp->MCP2515_Service();
+                    busy++;
+                }
+                else if (mcp->MCP2515_PollDue())
+                {
+                    Hold();
+                    mcp->MCP2515_ServiceTx();
+                }
+            }
+
+            // 2) MCP2515s without Int pin - READ STATUS of all, then service those needing it
+            if ((PollUs == 0) || ((uint32_t)(micros() - PollTime) >= PollUs))
+            {
+                PollTime = micros();
+                for (uint8_t n = 0; n < Cnt; ++n)
+                {
+                    mcp = Devs[(Next + n) % Cnt];
+                    if (mcp->IntPin < 0)
+                    {
+                        Hold();
+                        status[n] = mcp->MCP2515_ReadStatus();
+                    }
+                }
+                for (uint8_t n = 0; n < Cnt; ++n)
+                {
+                    mcp = Devs[(Next + n) % Cnt];
+                    if (mcp->IntPin < 0)
+                    {
+                        if (status[n] & (STAT_TX2IF | STAT_TX1IF | STAT_TX0IF | STAT_RX1IF | STAT_RX0IF))
+                        {
+                            busy++;
+                        }
+                        mcp->MCP2515_PollStatus(status[n]);
+                    }
+                }
+            }
+
+            Release();
+            Next = (Next + 1 < Cnt) ? Next + 1 : 0;
+            return busy;
+        }
+
+    private:
+        /// Begin the SPI transaction of the service pass (if not yet begun)
+        void Hold(void)
+        {
+            if (Held)
+            {
+                return;
+            }
+            Devs[0]->SPI_dev->beginTransaction(Devs[0]->SPI_Settings);
+            for (uint8_t i = 0; i < Cnt; ++i)
+            {
+                Devs[i]->SpiHeld = true;
+            }
+            Held = true;
+        }
+
+        /// End the SPI transaction of the service pass (if begun)
+        void Release(void)
+        {
+            if (!Held)
+            {
+                return;
+            }
+            for (uint8_t i = 0; i < Cnt; ++i)
+            {
+                Devs[i]->SpiHeld = false;
+            }
+            Devs[0]->SPI_dev->endTransaction();
+            Held = false;
+        }
+
+        /// MCP2515s attached
+        DLK_MCP2515 * Devs[SPI_BUS_MAX_DEVS];
+
+        /// number of MCP2515s attached
+        uint8_t Cnt = 0;
+
+        /// MCP2515 serviced first on next pass (round-robin)
+        uint8_t Next = 0;
+
+        /// SPI transaction of the service pass begun
+        bool Held = false;
+
+        /// min time between READ STATUS polls (uS - 0 = every pass)
+        uint16_t PollUs = 0;
+
+        /// last READ STATUS poll time (uS)
+        uint32_t PollTime = 0;
+};
+
+#endif  // __DLK_SPIBUS_H__
@@ -39,6 +39,9 @@
 /// IDE: Extended Identifier Flag bit (RXBnSIDL: RECEIVE BUFFER n STANDARD IDENTIFIER REGISTER LOW)
 #define MCP2515_RXB_IDE         0x08
 
+/// SRR: Standard Frame Remote Transmit Request bit (RXBnSIDL: RECEIVE BUFFER n STANDARD IDENTIFIER REGISTER LOW)
+#define MCP2515_RXB_SRR         0x10
+
 /// DLC[3:0]: Data Length Code bits (RXBnDLC: RECEIVE BUFFER n DATA LENGTH CODE REGISTER)
 #define MCP2515_DLC_MASK        0x0F
 
@@ -310,6 +313,9 @@
 #define CLKOUT_PS8      0x03       // System Clock/8
 #define CLKOUT_MASK     CLKOUT_PS8
 
+// CANCTRL: CAN CONTROL REGISTER value after reset (REQOP = Configuration, CLKEN, CLKPRE = /8)
+#define CANCTRL_RESET   (MODE_CONFIG | CLKOUT_ENABLE | CLKOUT_PS8)
+
 // BFPCTRL: RXnBF PIN CONTROL AND STATUS REGISTER
 #define B1BFS_BIT       0x20
 #define B0BFS_BIT       0x10
@@ -420,6 +426,7 @@
 #define MCP2515_SET_MODE_FAIL   4
 #define MCP2515_INVALID_INT     5
 #define MCP2515_NO_AVAIL_INTS   6
+#define MCP2515_BUS_OFF         7
 
 #define CAN_STDID               0
 #define CAN_EXTID               1